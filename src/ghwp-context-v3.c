@@ -30,6 +30,18 @@ GHWPContextV3 *ghwp_context_v3_new (GInputStream *stream)
     return context;
 }
 
+void ghwp_context_v3_set_cancellable (GHWPContextV3 *context,
+                                      GCancellable  *cancellable)
+{
+    g_return_if_fail (GHWP_IS_CONTEXT_V3 (context));
+
+    if (cancellable)
+        g_object_ref (cancellable);
+    if (context->cancellable)
+        g_object_unref (context->cancellable);
+    context->cancellable = cancellable;
+}
+
 gboolean ghwp_context_v3_read_uint8 (GHWPContextV3 *context, guint8 *i)
 {
     g_return_val_if_fail (context != NULL, FALSE);
@@ -37,7 +49,7 @@ gboolean ghwp_context_v3_read_uint8 (GHWPContextV3 *context, guint8 *i)
     gboolean is_success = FALSE;
     is_success = g_input_stream_read_all (context->stream, i, 1,
                                           &context->bytes_read,
-                                          NULL, NULL);
+                                          context->cancellable, NULL);
     if ((is_success == FALSE) ||
         (context->bytes_read != 1) ||
         (context->bytes_read == 0))
@@ -57,7 +69,7 @@ gboolean ghwp_context_v3_read_uint16 (GHWPContextV3 *context, guint16 *i)
     gboolean is_success = FALSE;
     is_success = g_input_stream_read_all (context->stream, i, 2,
                                           &context->bytes_read,
-                                          NULL, NULL);
+                                          context->cancellable, NULL);
     if ((is_success == FALSE) ||
         (context->bytes_read != 2) ||
         (context->bytes_read == 0))
@@ -78,7 +90,7 @@ gboolean ghwp_context_v3_read_uint32 (GHWPContextV3 *context, guint32 *i)
     gboolean is_success = FALSE;
     is_success = g_input_stream_read_all (context->stream, i, 4,
                                           &context->bytes_read,
-                                          NULL, NULL);
+                                          context->cancellable, NULL);
     if ((is_success == FALSE) ||
         (context->bytes_read != 4) ||
         (context->bytes_read == 0))
@@ -99,7 +111,7 @@ gboolean ghwp_context_v3_read (GHWPContextV3 *context, void *buffer, gsize count
     gboolean is_success = FALSE;
     is_success = g_input_stream_read_all (context->stream, buffer, count,
                                           &context->bytes_read,
-                                          NULL, NULL);
+                                          context->cancellable, NULL);
     if ((is_success == FALSE) || (context->bytes_read == 0))
     {
         g_input_stream_close (context->stream, NULL, NULL);
@@ -118,7 +130,7 @@ gboolean ghwp_context_v3_skip (GHWPContextV3 *context, guint16 count)
 
     is_success = g_input_stream_read_all (context->stream, buf, (gsize) count,
                                           &context->bytes_read,
-                                          NULL, NULL);
+                                          context->cancellable, NULL);
     g_free (buf);
 
     if ((is_success == FALSE) || (context->bytes_read != (gsize) count))
@@ -140,6 +152,8 @@ static void ghwp_context_v3_finalize (GObject *object)
 {
     GHWPContextV3 *context = GHWP_CONTEXT_V3(object);
     g_object_unref (context->stream);
+    if (context->cancellable)
+        g_object_unref (context->cancellable);
 	G_OBJECT_CLASS (ghwp_context_v3_parent_class)->finalize (object);
 }
 
@@ -45,11 +45,15 @@ struct _GHWPContextV3
 {
 	GObject       parent_instance;
     GInputStream *stream;
+    GCancellable *cancellable;
     gsize         bytes_read;
 };
 
 GType          ghwp_context_v3_get_type    (void) G_GNUC_CONST;
 GHWPContextV3 *ghwp_context_v3_new         (GInputStream  *stream);
+void           ghwp_context_v3_set_cancellable
+                                           (GHWPContextV3 *context,
+                                            GCancellable  *cancellable);
 gboolean       ghwp_context_v3_read_uint8  (GHWPContextV3 *context,
                                             guint8        *i);
 gboolean       ghwp_context_v3_read_uint16 (GHWPContextV3 *context,
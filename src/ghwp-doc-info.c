@@ -0,0 +1,588 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4; tab-width: 4 -*- */
+/*
+ * ghwp-doc-info.c
+ *
+ * Copyright (C) 2013 Hodong Kim <cogniti@gmail.com>
+ *
+ * This library is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * This software have been developed with reference to
+ * the HWP file format open specification by Hancom, Inc.
+ * http://www.hancom.co.kr/userofficedata.userofficedataList.do?menuFlag=3
+ * 한글과컴퓨터의 한/글 문서 파일(.hwp) 공개 문서를 참고하여 개발하였습니다.
+ */
+
+#include <string.h>
+
+#include "ghwp.h"
+#include "ghwp-doc-info.h"
+
+#define _g_array_free0(var) ((var == NULL) ? NULL : (var = (g_array_free (var, TRUE), NULL)))
+
+/* HWPTAG_ID_MAPPINGS 의 순서 */
+enum {
+    ID_BIN_DATA     = 0,
+    ID_FACE_NAMES   = 1, /* 언어별로 7개 */
+    ID_BORDER_FILLS = 8,
+    ID_CHAR_SHAPES  = 9,
+    ID_TAB_DEFS     = 10,
+    ID_NUMBERINGS   = 11,
+    ID_BULLETS      = 12,
+    ID_PARA_SHAPES  = 13,
+    ID_STYLES       = 14,
+    ID_MAPPINGS_LEN = 18
+};
+
+/*
+ * 모든 항목은 ID 순서대로 고정 크기 구조체 배열에 저장한다.
+ * 글꼴 이름은 언어 구분 없이 한 배열에 두고, 언어별 시작 위치를
+ * face_offsets 에 둔다. 문자열은 strings 에 모아 한 번에 해제한다.
+ */
+struct _GHWPDocInfo
+{
+    gint32        id_mappings[ID_MAPPINGS_LEN];
+    GArray       *bin_data;
+    GArray       *face_names;
+    guint         face_counts[GHWP_LANG_COUNT];
+    guint         face_offsets[GHWP_LANG_COUNT];
+    GHWPLanguage  face_lang;
+    GArray       *char_shapes;
+    GArray       *para_shapes;
+    GArray       *border_fills;
+    GArray       *styles;
+    GStringChunk *strings;
+    gsize         strings_size; /* strings 에 넣은 바이트 수, 중복 포함 */
+    GString      *buf; /* UTF-16LE -> UTF-8 변환에 재사용 */
+};
+
+typedef struct
+{
+    const guint8 *p;
+    const guint8 *end;
+} Reader;
+
+/* 레코드가 짧으면 0 을 읽는다. 버전에 따라 뒷부분 필드가 없을 수 있다. */
+static inline guint8 _read_u8 (Reader *r)
+{
+    if (r->end - r->p < 1) {
+        r->p = r->end;
+        return 0;
+    }
+    return *r->p++;
+}
+
+static inline guint16 _read_u16 (Reader *r)
+{
+    guint16 v;
+
+    if (r->end - r->p < 2) {
+        r->p = r->end;
+        return 0;
+    }
+    v = (guint16) (r->p[0] | (r->p[1] << 8));
+    r->p += 2;
+    return v;
+}
+
+static inline guint32 _read_u32 (Reader *r)
+{
+    guint32 v;
+
+    if (r->end - r->p < 4) {
+        r->p = r->end;
+        return 0;
+    }
+    v = (guint32) r->p[0]         | ((guint32) r->p[1] << 8) |
+        ((guint32) r->p[2] << 16) | ((guint32) r->p[3] << 24);
+    r->p += 4;
+    return v;
+}
+
+static inline gsize _read_left (Reader *r)
+{
+    return (gsize) (r->end - r->p);
+}
+
+/* WORD 길이 + WCHAR 배열을 읽어 strings 에 넣는다. 같은 이름은 공유한다. */
+static const gchar *_read_string (GHWPDocInfo *info, Reader *r)
+{
+    guint16 len = _read_u16 (r);
+    guint16 i;
+
+    if ((gsize) len * 2 > _read_left (r))
+        len = (guint16) (_read_left (r) / 2);
+
+    g_string_truncate (info->buf, 0);
+
+    for (i = 0; i < len; i++) {
+        gunichar c = _read_u16 (r);
+        /* surrogate pair */
+        if (c >= 0xd800 && c < 0xdc00 && i + 1 < len) {
+            gunichar c2 = (gunichar) (r->p[0] | (r->p[1] << 8));
+            if (c2 >= 0xdc00 && c2 < 0xe000) {
+                r->p += 2;
+                i++;
+                c = 0x10000 + ((c - 0xd800) << 10) + (c2 - 0xdc00);
+            }
+        }
+        g_string_append_unichar (info->buf, c);
+    }
+
+    info->strings_size += info->buf->len + 1;
+    return g_string_chunk_insert_const (info->strings, info->buf->str);
+}
+
+/* ID_MAPPINGS 의 개수로 배열 공간을 미리 잡는다 */
+static void _reserve (GArray *array, gint32 n)
+{
+    if (n > 0 && array->len == 0) {
+        g_array_set_size (array, (guint) n);
+        g_array_set_size (array, 0);
+    }
+}
+
+static void _parse_id_mappings (GHWPDocInfo *info, Reader *r)
+{
+    guint i;
+    gint32 n_faces = 0;
+
+    for (i = 0; i < ID_MAPPINGS_LEN && _read_left (r) >= 4; i++)
+        info->id_mappings[i] = (gint32) _read_u32 (r);
+
+    for (i = 0; i < GHWP_LANG_COUNT; i++)
+        n_faces += MAX (info->id_mappings[ID_FACE_NAMES + i], 0);
+
+    _reserve (info->bin_data,     info->id_mappings[ID_BIN_DATA]);
+    _reserve (info->face_names,   n_faces);
+    _reserve (info->border_fills, info->id_mappings[ID_BORDER_FILLS]);
+    _reserve (info->char_shapes,  info->id_mappings[ID_CHAR_SHAPES]);
+    _reserve (info->para_shapes,  info->id_mappings[ID_PARA_SHAPES]);
+    _reserve (info->styles,       info->id_mappings[ID_STYLES]);
+}
+
+static void _parse_bin_data (GHWPDocInfo *info, Reader *r)
+{
+    GHWPBinData bin;
+
+    memset (&bin, 0, sizeof (GHWPBinData));
+
+    bin.attr = _read_u16 (r);
+
+    if (GHWP_BIN_DATA_TYPE (&bin) == GHWP_BIN_DATA_TYPE_LINK) {
+        bin.abs_path = _read_string (info, r);
+        bin.rel_path = _read_string (info, r);
+    } else {
+        bin.bin_id = _read_u16 (r);
+        if (GHWP_BIN_DATA_TYPE (&bin) == GHWP_BIN_DATA_TYPE_EMBEDDING)
+            bin.extension = _read_string (info, r);
+    }
+
+    g_array_append_val (info->bin_data, bin);
+}
+
+static void _parse_face_name (GHWPDocInfo *info, Reader *r)
+{
+    GHWPFaceName face;
+
+    memset (&face, 0, sizeof (GHWPFaceName));
+
+    face.attr = _read_u8 (r);
+    face.name = _read_string (info, r);
+    /* 대체 글꼴 */
+    if (face.attr & 0x80) {
+        face.alt_type = _read_u8 (r);
+        face.alt_name = _read_string (info, r);
+    }
+    /* 글꼴 유형 정보 */
+    if (face.attr & 0x40) {
+        guint i;
+        for (i = 0; i < sizeof (face.panose); i++)
+            face.panose[i] = _read_u8 (r);
+    }
+    /* 기본 글꼴 */
+    if (face.attr & 0x20)
+        face.base_name = _read_string (info, r);
+
+    /* 글꼴은 한글, 영문, 한자, ... 순서로 나온다.
+     * ID_MAPPINGS 의 언어별 개수가 찬 경우 다음 언어로 넘어간다. */
+    while (info->face_lang < GHWP_LANG_COUNT - 1 &&
+           info->face_counts[info->face_lang] >=
+           (guint) MAX (info->id_mappings[ID_FACE_NAMES + info->face_lang], 0)) {
+        info->face_lang++;
+        info->face_offsets[info->face_lang] = info->face_names->len;
+    }
+
+    g_array_append_val (info->face_names, face);
+    info->face_counts[info->face_lang]++;
+}
+
+static void _parse_border_line (Reader *r, GHWPBorderLine *line)
+{
+    line->type  = _read_u8 (r);
+    line->width = _read_u8 (r);
+    line->color = _read_u32 (r);
+}
+
+static void _parse_border_fill (GHWPDocInfo *info, Reader *r)
+{
+    GHWPBorderFill fill;
+    guint          i;
+
+    memset (&fill, 0, sizeof (GHWPBorderFill));
+
+    fill.attr = _read_u16 (r);
+    /* 스펙에는 선 종류 4개, 굵기 4개, 색 4개 순서로 되어 있으나
+     * 실제 파일은 선마다 종류, 굵기, 색이 붙어 있다. */
+    for (i = 0; i < 4; i++)
+        _parse_border_line (r, &fill.borders[i]);
+    _parse_border_line (r, &fill.diagonal);
+
+    fill.fill_type = _read_u32 (r);
+    if (fill.fill_type & GHWP_BORDER_FILL_TYPE_COLOR) {
+        fill.face_color  = _read_u32 (r);
+        fill.hatch_color = _read_u32 (r);
+        fill.hatch_style = (gint32) _read_u32 (r);
+    }
+
+    g_array_append_val (info->border_fills, fill);
+}
+
+static void _parse_char_shape (GHWPDocInfo *info, Reader *r)
+{
+    GHWPCharShape shape;
+    guint         i;
+
+    memset (&shape, 0, sizeof (GHWPCharShape));
+
+    for (i = 0; i < GHWP_LANG_COUNT; i++)
+        shape.face_ids[i]  = _read_u16 (r);
+    for (i = 0; i < GHWP_LANG_COUNT; i++)
+        shape.ratios[i]    = _read_u8 (r);
+    for (i = 0; i < GHWP_LANG_COUNT; i++)
+        shape.spacings[i]  = (gint8) _read_u8 (r);
+    for (i = 0; i < GHWP_LANG_COUNT; i++)
+        shape.rel_sizes[i] = _read_u8 (r);
+    for (i = 0; i < GHWP_LANG_COUNT; i++)
+        shape.offsets[i]   = (gint8) _read_u8 (r);
+
+    shape.base_size       = (gint32) _read_u32 (r);
+    shape.attr            = _read_u32 (r);
+    shape.shadow_x        = (gint8) _read_u8 (r);
+    shape.shadow_y        = (gint8) _read_u8 (r);
+    shape.text_color      = _read_u32 (r);
+    shape.underline_color = _read_u32 (r);
+    shape.shade_color     = _read_u32 (r);
+    shape.shadow_color    = _read_u32 (r);
+    shape.border_fill_id  = _read_u16 (r);
+    shape.strike_color    = _read_u32 (r);
+
+    g_array_append_val (info->char_shapes, shape);
+}
+
+static void _parse_para_shape (GHWPDocInfo *info, Reader *r)
+{
+    GHWPParaShape shape;
+    guint         i;
+
+    memset (&shape, 0, sizeof (GHWPParaShape));
+
+    shape.attr1          = _read_u32 (r);
+    shape.left_margin    = (gint32) _read_u32 (r);
+    shape.right_margin   = (gint32) _read_u32 (r);
+    shape.indent         = (gint32) _read_u32 (r);
+    shape.prev_spacing   = (gint32) _read_u32 (r);
+    shape.next_spacing   = (gint32) _read_u32 (r);
+    shape.line_spacing   = (gint32) _read_u32 (r);
+    shape.tab_def_id     = _read_u16 (r);
+    shape.numbering_id   = _read_u16 (r);
+    shape.border_fill_id = _read_u16 (r);
+    for (i = 0; i < 4; i++)
+        shape.border_offsets[i] = (gint16) _read_u16 (r);
+    shape.attr2          = _read_u32 (r);
+    shape.attr3          = _read_u32 (r);
+    /* 5.0.2.5 부터 줄 간격이 여기에 다시 나온다 */
+    if (_read_left (r) >= 4)
+        shape.line_spacing = (gint32) _read_u32 (r);
+
+    g_array_append_val (info->para_shapes, shape);
+}
+
+static void _parse_style (GHWPDocInfo *info, Reader *r)
+{
+    GHWPStyle style;
+
+    memset (&style, 0, sizeof (GHWPStyle));
+
+    style.name          = _read_string (info, r);
+    style.en_name       = _read_string (info, r);
+    style.attr          = _read_u8 (r);
+    style.next_style_id = _read_u8 (r);
+    style.lang_id       = (gint16) _read_u16 (r);
+    style.para_shape_id = _read_u16 (r);
+    style.char_shape_id = _read_u16 (r);
+
+    g_array_append_val (info->styles, style);
+}
+
+GHWPDocInfo *ghwp_doc_info_new (void)
+{
+    GHWPDocInfo *info = g_slice_new0 (GHWPDocInfo);
+
+    info->bin_data     = g_array_new (FALSE, FALSE, sizeof (GHWPBinData));
+    info->face_names   = g_array_new (FALSE, FALSE, sizeof (GHWPFaceName));
+    info->char_shapes  = g_array_new (FALSE, FALSE, sizeof (GHWPCharShape));
+    info->para_shapes  = g_array_new (FALSE, FALSE, sizeof (GHWPParaShape));
+    info->border_fills = g_array_new (FALSE, FALSE, sizeof (GHWPBorderFill));
+    info->styles       = g_array_new (FALSE, FALSE, sizeof (GHWPStyle));
+    info->strings      = g_string_chunk_new (1024);
+    info->buf          = g_string_sized_new (64);
+
+    return info;
+}
+
+void ghwp_doc_info_free (GHWPDocInfo *info)
+{
+    if (info == NULL)
+        return;
+
+    _g_array_free0 (info->bin_data);
+    _g_array_free0 (info->face_names);
+    _g_array_free0 (info->char_shapes);
+    _g_array_free0 (info->para_shapes);
+    _g_array_free0 (info->border_fills);
+    _g_array_free0 (info->styles);
+    g_string_chunk_free (info->strings);
+    g_string_free (info->buf, TRUE);
+    g_slice_free (GHWPDocInfo, info);
+}
+
+/**
+ * ghwp_doc_info_parse_record:
+ * @info: a #GHWPDocInfo
+ * @tag_id: tag of the DocInfo record
+ * @data: record payload
+ * @len: length of @data in bytes
+ *
+ * Decodes one DocInfo record into @info.  Records must be passed in
+ * stream order since IDs are assigned by position.  Unknown tags are
+ * ignored.
+ */
+void ghwp_doc_info_parse_record (GHWPDocInfo  *info,
+                                 guint16       tag_id,
+                                 const guint8 *data,
+                                 gsize         len)
+{
+    g_return_if_fail (info != NULL);
+
+    Reader r;
+
+    r.p   = data;
+    r.end = data + len;
+
+    switch (tag_id) {
+    case GHWP_TAG_ID_MAPPINGS:
+        _parse_id_mappings (info, &r);
+        break;
+    case GHWP_TAG_BIN_DATA:
+        _parse_bin_data (info, &r);
+        break;
+    case GHWP_TAG_FACE_NAME:
+        _parse_face_name (info, &r);
+        break;
+    case GHWP_TAG_BORDER_FILL:
+        _parse_border_fill (info, &r);
+        break;
+    case GHWP_TAG_CHAR_SHAPE:
+        _parse_char_shape (info, &r);
+        break;
+    case GHWP_TAG_PARA_SHAPE:
+        _parse_para_shape (info, &r);
+        break;
+    case GHWP_TAG_STYLE:
+        _parse_style (info, &r);
+        break;
+    default:
+        break;
+    }
+}
+
+guint ghwp_doc_info_get_n_bin_data (GHWPDocInfo *info)
+{
+    g_return_val_if_fail (info != NULL, 0);
+    return info->bin_data->len;
+}
+
+/**
+ * ghwp_doc_info_get_bin_data:
+ * @info: a #GHWPDocInfo
+ * @id: BinData ID as referenced by pictures, starting at 1
+ *
+ * Return value: (transfer none): the BinData entry, or %NULL if @id is 0
+ *     or out of range
+ */
+const GHWPBinData *ghwp_doc_info_get_bin_data (GHWPDocInfo *info, guint id)
+{
+    g_return_val_if_fail (info != NULL, NULL);
+
+    if (id == 0 || id > info->bin_data->len)
+        return NULL;
+
+    return &g_array_index (info->bin_data, GHWPBinData, id - 1);
+}
+
+guint ghwp_doc_info_get_n_face_names (GHWPDocInfo *info, GHWPLanguage lang)
+{
+    g_return_val_if_fail (info != NULL, 0);
+    g_return_val_if_fail (lang < GHWP_LANG_COUNT, 0);
+
+    return info->face_counts[lang];
+}
+
+/**
+ * ghwp_doc_info_get_face_name:
+ * @info: a #GHWPDocInfo
+ * @lang: language group of the face
+ * @id: face ID as used by #GHWPCharShape.face_ids
+ *
+ * Return value: (transfer none): the face name, or %NULL if @id is out
+ *     of range
+ */
+const GHWPFaceName *
+ghwp_doc_info_get_face_name (GHWPDocInfo *info, GHWPLanguage lang, guint id)
+{
+    g_return_val_if_fail (info != NULL, NULL);
+    g_return_val_if_fail (lang < GHWP_LANG_COUNT, NULL);
+
+    if (id >= info->face_counts[lang])
+        return NULL;
+
+    return &g_array_index (info->face_names, GHWPFaceName,
+                           info->face_offsets[lang] + id);
+}
+
+guint ghwp_doc_info_get_n_char_shapes (GHWPDocInfo *info)
+{
+    g_return_val_if_fail (info != NULL, 0);
+    return info->char_shapes->len;
+}
+
+/**
+ * ghwp_doc_info_get_char_shape:
+ * @info: a #GHWPDocInfo
+ * @id: character shape ID
+ *
+ * Return value: (transfer none): the character shape, or %NULL if @id is
+ *     out of range
+ */
+const GHWPCharShape *ghwp_doc_info_get_char_shape (GHWPDocInfo *info, guint id)
+{
+    g_return_val_if_fail (info != NULL, NULL);
+
+    if (id >= info->char_shapes->len)
+        return NULL;
+
+    return &g_array_index (info->char_shapes, GHWPCharShape, id);
+}
+
+guint ghwp_doc_info_get_n_para_shapes (GHWPDocInfo *info)
+{
+    g_return_val_if_fail (info != NULL, 0);
+    return info->para_shapes->len;
+}
+
+/**
+ * ghwp_doc_info_get_para_shape:
+ * @info: a #GHWPDocInfo
+ * @id: paragraph shape ID
+ *
+ * Return value: (transfer none): the paragraph shape, or %NULL if @id is
+ *     out of range
+ */
+const GHWPParaShape *ghwp_doc_info_get_para_shape (GHWPDocInfo *info, guint id)
+{
+    g_return_val_if_fail (info != NULL, NULL);
+
+    if (id >= info->para_shapes->len)
+        return NULL;
+
+    return &g_array_index (info->para_shapes, GHWPParaShape, id);
+}
+
+guint ghwp_doc_info_get_n_border_fills (GHWPDocInfo *info)
+{
+    g_return_val_if_fail (info != NULL, 0);
+    return info->border_fills->len;
+}
+
+/**
+ * ghwp_doc_info_get_border_fill:
+ * @info: a #GHWPDocInfo
+ * @id: border/fill ID as stored in the file, starting at 1
+ *
+ * Return value: (transfer none): the border/fill, or %NULL if @id is 0 or
+ *     out of range
+ */
+const GHWPBorderFill *
+ghwp_doc_info_get_border_fill (GHWPDocInfo *info, guint id)
+{
+    g_return_val_if_fail (info != NULL, NULL);
+
+    /* 테두리/배경 ID 는 1 부터 시작한다 */
+    if (id == 0 || id > info->border_fills->len)
+        return NULL;
+
+    return &g_array_index (info->border_fills, GHWPBorderFill, id - 1);
+}
+
+guint ghwp_doc_info_get_n_styles (GHWPDocInfo *info)
+{
+    g_return_val_if_fail (info != NULL, 0);
+    return info->styles->len;
+}
+
+/**
+ * ghwp_doc_info_get_style:
+ * @info: a #GHWPDocInfo
+ * @id: style ID
+ *
+ * Return value: (transfer none): the style, or %NULL if @id is out of range
+ */
+const GHWPStyle *ghwp_doc_info_get_style (GHWPDocInfo *info, guint id)
+{
+    g_return_val_if_fail (info != NULL, NULL);
+
+    if (id >= info->styles->len)
+        return NULL;
+
+    return &g_array_index (info->styles, GHWPStyle, id);
+}
+
+/* private
+ * 대략적인 메모리 사용량. 문자열은 중복을 없애기 전의 크기로 센다. */
+gsize _ghwp_doc_info_get_memory_usage (GHWPDocInfo *info)
+{
+    g_return_val_if_fail (info != NULL, 0);
+
+    return sizeof (GHWPDocInfo) +
+           info->bin_data->len     * sizeof (GHWPBinData) +
+           info->face_names->len   * sizeof (GHWPFaceName) +
+           info->char_shapes->len  * sizeof (GHWPCharShape) +
+           info->para_shapes->len  * sizeof (GHWPParaShape) +
+           info->border_fills->len * sizeof (GHWPBorderFill) +
+           info->styles->len       * sizeof (GHWPStyle) +
+           info->strings_size +
+           info->buf->allocated_len;
+}
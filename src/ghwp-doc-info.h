@@ -0,0 +1,209 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4; tab-width: 4 -*- */
+/*
+ * ghwp-doc-info.h
+ *
+ * Copyright (C) 2013 Hodong Kim <cogniti@gmail.com>
+ *
+ * This library is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * This software have been developed with reference to
+ * the HWP file format open specification by Hancom, Inc.
+ * http://www.hancom.co.kr/userofficedata.userofficedataList.do?menuFlag=3
+ * 한글과컴퓨터의 한/글 문서 파일(.hwp) 공개 문서를 참고하여 개발하였습니다.
+ */
+
+#ifndef __GHWP_DOC_INFO_H__
+#define __GHWP_DOC_INFO_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/**
+ * GHWPLanguage:
+ * @GHWP_LANG_HANGUL: 한글
+ * @GHWP_LANG_LATIN: 영문
+ * @GHWP_LANG_HANJA: 한자
+ * @GHWP_LANG_JAPANESE: 일어
+ * @GHWP_LANG_OTHER: 기타
+ * @GHWP_LANG_SYMBOL: 기호
+ * @GHWP_LANG_USER: 사용자
+ * @GHWP_LANG_COUNT: number of languages
+ *
+ * Language groups used by face names and character shapes.
+ */
+typedef enum
+{
+    GHWP_LANG_HANGUL,
+    GHWP_LANG_LATIN,
+    GHWP_LANG_HANJA,
+    GHWP_LANG_JAPANESE,
+    GHWP_LANG_OTHER,
+    GHWP_LANG_SYMBOL,
+    GHWP_LANG_USER,
+    GHWP_LANG_COUNT
+} GHWPLanguage;
+
+typedef struct _GHWPDocInfo    GHWPDocInfo;
+typedef struct _GHWPBinData    GHWPBinData;
+typedef struct _GHWPFaceName   GHWPFaceName;
+typedef struct _GHWPCharShape  GHWPCharShape;
+typedef struct _GHWPParaShape  GHWPParaShape;
+typedef struct _GHWPBorderLine GHWPBorderLine;
+typedef struct _GHWPBorderFill GHWPBorderFill;
+typedef struct _GHWPStyle      GHWPStyle;
+
+/* 색상은 COLORREF(0x00bbggrr) 그대로 둔다. */
+
+/* HWPTAG_BIN_DATA, 문자열은 GHWPDocInfo 가 소유한다 */
+struct _GHWPBinData
+{
+    guint16      attr;
+    guint16      bin_id;     /* 링크가 아닌 경우 */
+    const gchar *extension;  /* 임베딩인 경우, "jpg", "png" 등 */
+    const gchar *abs_path;   /* 링크인 경우 */
+    const gchar *rel_path;   /* 링크인 경우 */
+};
+
+#define GHWP_BIN_DATA_TYPE(bin)        ((bin)->attr & 0x000f)
+#define GHWP_BIN_DATA_TYPE_LINK        0
+#define GHWP_BIN_DATA_TYPE_EMBEDDING   1
+#define GHWP_BIN_DATA_TYPE_STORAGE     2
+/* 0: 저장소 기본값을 따름, 1: 압축, 2: 압축 안 함 */
+#define GHWP_BIN_DATA_COMPRESSION(bin) (((bin)->attr >> 4) & 0x0003)
+
+/* HWPTAG_FACE_NAME, 문자열은 GHWPDocInfo 가 소유한다 */
+struct _GHWPFaceName
+{
+    const gchar *name;
+    const gchar *alt_name;
+    const gchar *base_name;
+    guint8       attr;
+    guint8       alt_type;
+    guint8       panose[10];
+};
+
+/* HWPTAG_CHAR_SHAPE */
+struct _GHWPCharShape
+{
+    guint16 face_ids[GHWP_LANG_COUNT];
+    guint8  ratios[GHWP_LANG_COUNT];
+    gint8   spacings[GHWP_LANG_COUNT];
+    guint8  rel_sizes[GHWP_LANG_COUNT];
+    gint8   offsets[GHWP_LANG_COUNT];
+    gint32  base_size;      /* HWPUNIT, 1000 = 10pt */
+    guint32 attr;
+    gint8   shadow_x;
+    gint8   shadow_y;
+    guint16 border_fill_id; /* 5.0.2.1 이상 */
+    guint32 text_color;
+    guint32 underline_color;
+    guint32 shade_color;
+    guint32 shadow_color;
+    guint32 strike_color;   /* 5.0.3.0 이상 */
+};
+
+#define GHWP_CHAR_SHAPE_ITALIC(shape) (((shape)->attr & 0x01) != 0)
+#define GHWP_CHAR_SHAPE_BOLD(shape)   (((shape)->attr & 0x02) != 0)
+
+/* HWPTAG_PARA_SHAPE */
+struct _GHWPParaShape
+{
+    guint32 attr1;
+    gint32  left_margin;
+    gint32  right_margin;
+    gint32  indent;
+    gint32  prev_spacing;
+    gint32  next_spacing;
+    gint32  line_spacing;
+    guint16 tab_def_id;
+    guint16 numbering_id;
+    guint16 border_fill_id;
+    gint16  border_offsets[4]; /* left, right, top, bottom */
+    guint32 attr2;             /* 5.0.1.7 이상 */
+    guint32 attr3;             /* 5.0.2.5 이상 */
+};
+
+struct _GHWPBorderLine
+{
+    guint8  type;
+    guint8  width;
+    guint32 color;
+};
+
+/* HWPTAG_BORDER_FILL, 채우기는 단색만 읽는다 */
+struct _GHWPBorderFill
+{
+    guint16        attr;
+    GHWPBorderLine borders[4]; /* left, right, top, bottom */
+    GHWPBorderLine diagonal;
+    guint32        fill_type;
+    guint32        face_color;
+    guint32        hatch_color;
+    gint32         hatch_style;
+};
+
+#define GHWP_BORDER_FILL_TYPE_COLOR 0x00000001
+
+/* HWPTAG_STYLE, 문자열은 GHWPDocInfo 가 소유한다 */
+struct _GHWPStyle
+{
+    const gchar *name;
+    const gchar *en_name;
+    guint8       attr;
+    guint8       next_style_id;
+    gint16       lang_id;
+    guint16      para_shape_id;
+    guint16      char_shape_id;
+};
+
+GHWPDocInfo          *ghwp_doc_info_new             (void);
+void                  ghwp_doc_info_free            (GHWPDocInfo  *info);
+void                  ghwp_doc_info_parse_record    (GHWPDocInfo  *info,
+                                                     guint16       tag_id,
+                                                     const guint8 *data,
+                                                     gsize         len);
+guint                 ghwp_doc_info_get_n_bin_data  (GHWPDocInfo  *info);
+const GHWPBinData    *ghwp_doc_info_get_bin_data    (GHWPDocInfo  *info,
+                                                     guint         id);
+guint                 ghwp_doc_info_get_n_face_names
+                                                    (GHWPDocInfo  *info,
+                                                     GHWPLanguage  lang);
+const GHWPFaceName   *ghwp_doc_info_get_face_name   (GHWPDocInfo  *info,
+                                                     GHWPLanguage  lang,
+                                                     guint         id);
+guint                 ghwp_doc_info_get_n_char_shapes
+                                                    (GHWPDocInfo  *info);
+const GHWPCharShape  *ghwp_doc_info_get_char_shape  (GHWPDocInfo  *info,
+                                                     guint         id);
+guint                 ghwp_doc_info_get_n_para_shapes
+                                                    (GHWPDocInfo  *info);
+const GHWPParaShape  *ghwp_doc_info_get_para_shape  (GHWPDocInfo  *info,
+                                                     guint         id);
+guint                 ghwp_doc_info_get_n_border_fills
+                                                    (GHWPDocInfo  *info);
+const GHWPBorderFill *ghwp_doc_info_get_border_fill (GHWPDocInfo  *info,
+                                                     guint         id);
+guint                 ghwp_doc_info_get_n_styles    (GHWPDocInfo  *info);
+const GHWPStyle      *ghwp_doc_info_get_style       (GHWPDocInfo  *info,
+                                                     guint         id);
+/* private */
+gsize                 _ghwp_doc_info_get_memory_usage
+                                                    (GHWPDocInfo  *info);
+
+G_END_DECLS
+
+#endif /* __GHWP_DOC_INFO_H__ */
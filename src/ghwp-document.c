@@ -28,23 +28,61 @@
 #include <string.h>
 
 #include "config.h"
+
+#ifdef HAVE_GDK_PIXBUF
+#include <gdk-pixbuf/gdk-pixbuf.h>
+#endif
+
 #include "ghwp-document.h"
+#include "ghwp-file-v5.h"
+#include "ghwp-lru-cache.h"
+#include "ghwp-font.h"
+
+/* 풀어 놓은 그림을 합쳐 이 크기까지 캐시한다 */
+#define GHWP_DOCUMENT_IMAGE_CACHE_SIZE (64 * 1024 * 1024)
 
 G_DEFINE_TYPE (GHWPDocument, ghwp_document, G_TYPE_OBJECT);
 
 /* private function */
 static void   ghwp_document_finalize               (GObject      *obj);
 
+enum {
+    PAGE_ADDED,
+    LOAD_PROGRESS,
+    LAST_SIGNAL
+};
+
+static guint signals[LAST_SIGNAL] = { 0 };
+
 #define _g_array_free0(var) ((var == NULL) ? NULL : (var = (g_array_free (var, TRUE), NULL)))
 #define _g_free0(var) (var = (g_free (var), NULL))
 #define _g_object_unref0(var) ((var == NULL) ? NULL : (var = (g_object_unref (var), NULL)))
 #define _g_error_free0(var) ((var == NULL) ? NULL : (var = (g_error_free (var), NULL)))
 
-static gpointer _g_object_ref0 (gpointer obj)
+static void _g_object_unref_element (gpointer element)
 {
-    return obj ? g_object_ref (obj) : NULL;
+    GObject **object = element;
+    _g_object_unref0 (*object);
 }
 
+static void _ghwp_weak_ref_free (gpointer data)
+{
+    g_weak_ref_clear (data);
+    g_slice_free (GWeakRef, data);
+}
+
+/* 다 읽은 구역 하나가 차지하는 doc->paragraphs, doc->page_ranges 의 범위.
+ * 버린 구역은 문단 칸이 NULL 이고 link 도 NULL 이다. */
+typedef struct
+{
+    guint  first_paragraph;
+    guint  n_paragraphs;
+    guint  first_page;
+    guint  n_pages;
+    gsize  cost;
+    GList *link; /* resident_sections 안의 자리 */
+} SectionEntry;
+
 /**
  * ghwp_document_new_from_uri:
  * @uri: uri of the file to load
@@ -52,7 +90,9 @@ static gpointer _g_object_ref0 (gpointer obj)
  * 
  * Creates a new #GHWPDocument.  If %NULL is returned, then @error will be
  * set. Possible errors include those in the #GHWP_ERROR and #G_FILE_ERROR
- * domains.
+ * domains.  The document is read with %GHWP_LOAD_CHAR_SHAPES for drawing
+ * pages; to get only the text, open a #GHWPFile and call
+ * ghwp_file_get_document().
  * 
  * Return value: A newly created #GHWPDocument, or %NULL
  **/
@@ -79,13 +119,291 @@ ghwp_document_new_from_filename (const gchar *filename, GError **error)
 
     if (*error) return NULL;
 
+    /* 페이지를 그리려고 여는 것이므로 글자 모양도 읽는다 */
+    ghwp_file_set_load_flags (file, GHWP_LOAD_CHAR_SHAPES);
     return ghwp_file_get_document (file, error);
 }
 
+typedef struct
+{
+    GFile               *file;
+    GHWPProgressCallback progress_callback;
+    gpointer             progress_data;
+} LoadData;
+
+typedef struct
+{
+    GTask        *task;
+    GHWPDocument *doc;
+    guint         n_done;
+    guint         n_total;
+    guint64       bytes_done;
+    guint64       bytes_total;
+} ProgressData;
+
+typedef struct
+{
+    GHWPDocument *doc;
+    guint         n_page;
+} PageAddedData;
+
+static void _load_data_free (LoadData *data)
+{
+    _g_object_unref0 (data->file);
+    g_slice_free (LoadData, data);
+}
+
+static void _progress_data_free (ProgressData *data)
+{
+    _g_object_unref0 (data->task);
+    _g_object_unref0 (data->doc);
+    g_slice_free (ProgressData, data);
+}
+
+static void _page_added_data_free (PageAddedData *data)
+{
+    _g_object_unref0 (data->doc);
+    g_slice_free (PageAddedData, data);
+}
+
+/* 작업 스레드에서 context 의 loop 로 넘긴다. g_main_context_invoke 는
+ * context 를 아무도 돌리지 않으면 현재 스레드에서 실행하므로 쓰지 않는다. */
+static void _ghwp_document_idle_add (GMainContext  *context,
+                                     GSourceFunc    func,
+                                     gpointer       data,
+                                     GDestroyNotify notify)
+{
+    GSource *source = g_idle_source_new ();
+    g_source_set_priority (source, G_PRIORITY_DEFAULT);
+    g_source_set_callback (source, func, data, notify);
+    g_source_attach (source, context);
+    g_source_unref (source);
+}
+
+/* 호출한 쪽의 main context 에서 실행된다 */
+static gboolean _ghwp_document_progress_idle (gpointer user_data)
+{
+    ProgressData *data = user_data;
+    LoadData     *load = g_task_get_task_data (data->task);
+
+    load->progress_callback (data->doc, data->n_done, data->n_total,
+                             data->bytes_done, data->bytes_total,
+                             load->progress_data);
+
+    return FALSE;
+}
+
+/* 작업 스레드에서 호출된다 */
+static void _ghwp_document_load_progress (GHWPDocument *doc,
+                                          guint         n_done,
+                                          guint         n_total,
+                                          guint64       bytes_done,
+                                          guint64       bytes_total,
+                                          gpointer      user_data)
+{
+    GTask        *task = G_TASK (user_data);
+    LoadData     *load = g_task_get_task_data (task);
+    ProgressData *data;
+
+    if (load->progress_callback == NULL)
+        return;
+
+    data              = g_slice_new (ProgressData);
+    data->task        = g_object_ref (task);
+    data->doc         = g_object_ref (doc);
+    data->n_done      = n_done;
+    data->n_total     = n_total;
+    data->bytes_done  = bytes_done;
+    data->bytes_total = bytes_total;
+
+    _ghwp_document_idle_add (g_task_get_context (task),
+                             _ghwp_document_progress_idle,
+                             data,
+                             (GDestroyNotify) _progress_data_free);
+}
+
+static void _ghwp_document_load_thread (GTask        *task,
+                                        gpointer      source_object,
+                                        gpointer      task_data,
+                                        GCancellable *cancellable)
+{
+    LoadData     *load  = task_data;
+    GHWPFile     *file  = NULL;
+    GHWPDocument *doc   = NULL;
+    GError       *error = NULL;
+    gchar        *path  = g_file_get_path (load->file);
+
+    if (path) {
+        file = ghwp_file_new_from_filename (path, &error);
+        _g_free0 (path);
+    } else {
+        /* 로컬 파일이 아닌 경우 */
+        GFileInputStream *stream = g_file_read (load->file, cancellable,
+                                                &error);
+        if (stream) {
+            file = ghwp_file_new_from_stream (G_INPUT_STREAM (stream),
+                                              cancellable, &error);
+            _g_object_unref0 (stream);
+        }
+    }
+
+    if (file == NULL) {
+        g_task_return_error (task, error);
+        return;
+    }
+
+    /* doc 이 file 의 참조를 가진다 */
+    doc       = ghwp_document_new ();
+    doc->file = file;
+
+    _ghwp_document_set_signal_context (doc, g_task_get_context (task));
+    ghwp_file_set_load_flags (file, GHWP_LOAD_CHAR_SHAPES);
+    _ghwp_file_set_cancellable (file, cancellable);
+    _ghwp_file_set_progress_callback (file, _ghwp_document_load_progress,
+                                      task);
+    _ghwp_file_load_document (file, doc, &error);
+    _ghwp_file_set_progress_callback (file, NULL, NULL);
+    _ghwp_file_set_cancellable (file, NULL);
+    _ghwp_document_set_signal_context (doc, NULL);
+
+    if (error) {
+        _g_object_unref0 (doc);
+        g_task_return_error (task, error);
+        return;
+    }
+
+    g_task_return_pointer (task, doc, g_object_unref);
+}
+
+/**
+ * ghwp_document_new_from_file_async:
+ * @file: a #GFile to load
+ * @cancellable: (allow-none): optional #GCancellable object, %NULL to ignore
+ * @progress_callback: (allow-none): function to call with progress
+ *     information, or %NULL
+ * @progress_data: user data to pass to @progress_callback
+ * @callback: a #GAsyncReadyCallback to call when the document is loaded
+ * @user_data: the data to pass to @callback
+ *
+ * Asynchronously loads a #GHWPDocument.  Parsing runs in a worker thread;
+ * @progress_callback, @callback and the #GHWPDocument::page-added signal
+ * are invoked in the thread-default main context of the caller.
+ * Cancelling @cancellable stops the worker at the next record it reads.
+ * The document is read with %GHWP_LOAD_CHAR_SHAPES.
+ *
+ * The document is passed to @progress_callback before its body is
+ * parsed.  From then on ghwp_document_get_n_pages() and
+ * ghwp_document_get_page() may be used to show pages that are already
+ * complete while the rest of the document is still loading.
+ *
+ * When the operation is finished, @callback will be called.  You can then
+ * call ghwp_document_new_from_file_finish() to get the result.
+ */
+void ghwp_document_new_from_file_async (GFile               *file,
+                                        GCancellable        *cancellable,
+                                        GHWPProgressCallback progress_callback,
+                                        gpointer             progress_data,
+                                        GAsyncReadyCallback  callback,
+                                        gpointer             user_data)
+{
+    g_return_if_fail (G_IS_FILE (file));
+
+    GTask    *task;
+    LoadData *load;
+
+    load                    = g_slice_new0 (LoadData);
+    load->file              = g_object_ref (file);
+    load->progress_callback = progress_callback;
+    load->progress_data     = progress_data;
+
+    task = g_task_new (NULL, cancellable, callback, user_data);
+    g_task_set_task_data (task, load, (GDestroyNotify) _load_data_free);
+    g_task_run_in_thread (task, _ghwp_document_load_thread);
+    g_object_unref (task);
+}
+
+/**
+ * ghwp_document_new_from_file_finish:
+ * @result: a #GAsyncResult
+ * @error: (allow-none): Return location for an error, or %NULL
+ *
+ * Finishes an operation started with ghwp_document_new_from_file_async().
+ *
+ * Return value: (transfer full): A newly created #GHWPDocument, or %NULL
+ */
+GHWPDocument *ghwp_document_new_from_file_finish (GAsyncResult *result,
+                                                  GError      **error)
+{
+    g_return_val_if_fail (g_task_is_valid (result, NULL), NULL);
+
+    return g_task_propagate_pointer (G_TASK (result), error);
+}
+
+/**
+ * ghwp_document_get_n_pages:
+ * @doc: a #GHWPDocument
+ *
+ * Returns the number of pages available so far.  While @doc is loading
+ * this grows as pages are completed; it is safe to call from any thread.
+ *
+ * Return value: the number of pages
+ */
 guint ghwp_document_get_n_pages (GHWPDocument *doc)
 {
-    g_return_val_if_fail (doc != NULL, 0U);
-    return doc->pages->len;
+    g_return_val_if_fail (GHWP_IS_DOCUMENT (doc), 0U);
+
+    guint n_pages;
+
+    g_mutex_lock (&doc->priv->lock);
+    n_pages = doc->page_ranges->len;
+    g_mutex_unlock (&doc->priv->lock);
+
+    return n_pages;
+}
+
+/* lock 을 잡은 상태에서 부른다. 범위의 문단으로 페이지를 새로 만든다. */
+static GHWPPage *_ghwp_document_make_page (GHWPDocument *doc, guint n_page)
+{
+    const GHWPPageRange *range;
+    GHWPPage            *page;
+    guint                i;
+
+    range = &g_array_index (doc->page_ranges, GHWPPageRange, n_page);
+    page  = ghwp_page_new ();
+
+    for (i = 0; i < range->n_paragraphs; i++) {
+        GHWPParagraph *paragraph;
+        gboolean       last      = i + 1 == range->n_paragraphs;
+        guint          first_row = i == 0 ? range->first_row : 0;
+
+        paragraph = _ghwp_document_peek_paragraph (doc,
+                                                   range->first_paragraph + i);
+        /* 버린 구역을 다시 읽지 못했다 */
+        if (paragraph == NULL) {
+            g_object_unref (page);
+            return NULL;
+        }
+
+        /* 글자도 표도 없는 문단은 그릴 것이 없다 */
+        if (paragraph->ghwp_text == NULL && paragraph->table == NULL)
+            continue;
+
+        ghwp_page_add_paragraph (page, paragraph);
+        if (last && range->end_row != G_MAXUINT)
+            ghwp_page_set_table_rows (page, paragraph, first_row,
+                                      range->end_row - first_row);
+        else if (first_row > 0)
+            ghwp_page_set_table_rows (page, paragraph, first_row, G_MAXUINT);
+    }
+
+    /* 첫 페이지를 만들 때는 DocInfo 를 다 읽었다 */
+    if (doc->priv->fonts == NULL)
+        doc->priv->fonts = _ghwp_font_set_new (doc->doc_info);
+    _ghwp_page_set_font_set (page, doc->priv->fonts);
+    if (doc->file)
+        _ghwp_page_set_stats (page, doc->file->priv->stats);
+
+    return page;
 }
 
 /**
@@ -93,16 +411,774 @@ guint ghwp_document_get_n_pages (GHWPDocument *doc)
  * @doc: a #GHWPDocument
  * @n_page: the index of the page to get
  *
- * Returns a #GHWPPage representing the page at index
+ * Returns a #GHWPPage representing the page at index.  Pages that have
+ * been counted by ghwp_document_get_n_pages() are complete and are not
+ * modified by the loader any more.
  *
- * Returns: (transfer none): a #GHWPPage
- *     DO NOT FREE the page.
+ * @doc only keeps where each page starts and ends; the #GHWPPage is
+ * made on the first request and shared while someone holds it.  If the
+ * section of the page was dropped to stay within
+ * ghwp_document_set_section_cache_size(), it is parsed again first.
+ *
+ * Returns: (transfer full): a #GHWPPage, or %NULL if @n_page is out of
+ *     range.  Free with g_object_unref().
  */
 GHWPPage *ghwp_document_get_page (GHWPDocument *doc, gint n_page)
 {
-    g_return_val_if_fail (doc != NULL, NULL);
-    GHWPPage *page = g_array_index (doc->pages, GHWPPage *, (guint) n_page);
-    return _g_object_ref0 (page);
+    g_return_val_if_fail (GHWP_IS_DOCUMENT (doc), NULL);
+
+    GHWPPage *page = NULL;
+    GWeakRef *ref;
+
+    g_mutex_lock (&doc->priv->lock);
+    if (n_page >= 0 && (guint) n_page < doc->page_ranges->len) {
+        ref = g_hash_table_lookup (doc->priv->live_pages,
+                                   GINT_TO_POINTER (n_page));
+        if (ref)
+            page = g_weak_ref_get (ref);
+
+        if (page == NULL) {
+            page = _ghwp_document_make_page (doc, (guint) n_page);
+            if (page) {
+                ref = g_slice_new (GWeakRef);
+                g_weak_ref_init (ref, page);
+                g_hash_table_replace (doc->priv->live_pages,
+                                      GINT_TO_POINTER (n_page), ref);
+            }
+        }
+    }
+    g_mutex_unlock (&doc->priv->lock);
+
+    return page;
+}
+
+/**
+ * ghwp_document_get_doc_info:
+ * @doc: a #GHWPDocument
+ *
+ * Returns the face names, character shapes, paragraph shapes,
+ * border/fills and styles decoded from the DocInfo stream.  They are
+ * complete before any page is added, so this may be used while @doc is
+ * still loading.  Only HWP v5 documents fill it in.
+ *
+ * Return value: (transfer none): a #GHWPDocInfo owned by @doc
+ */
+GHWPDocInfo *ghwp_document_get_doc_info (GHWPDocument *doc)
+{
+    g_return_val_if_fail (GHWP_IS_DOCUMENT (doc), NULL);
+    return doc->doc_info;
+}
+
+typedef struct
+{
+    const guint8 *data;
+    gsize         size;
+    gsize         pos;
+} PngReader;
+
+static cairo_status_t _png_read (void          *closure,
+                                 unsigned char *data,
+                                 unsigned int   length)
+{
+    PngReader *reader = closure;
+
+    if (reader->size - reader->pos < length)
+        return CAIRO_STATUS_READ_ERROR;
+
+    memcpy (data, reader->data + reader->pos, length);
+    reader->pos += length;
+    return CAIRO_STATUS_SUCCESS;
+}
+
+#ifdef HAVE_GDK_PIXBUF
+/* GdkPixbuf 는 RGB(A) 순서이고 알파를 곱하지 않았다. cairo 는 알파를
+ * 곱한 ARGB 를 네이티브 순서의 32 비트로 둔다. */
+static cairo_surface_t *_ghwp_document_surface_from_pixbuf (GdkPixbuf *pixbuf)
+{
+    gint             width      = gdk_pixbuf_get_width (pixbuf);
+    gint             height     = gdk_pixbuf_get_height (pixbuf);
+    gint             n_channels = gdk_pixbuf_get_n_channels (pixbuf);
+    gint             src_stride = gdk_pixbuf_get_rowstride (pixbuf);
+    const guint8    *src        = gdk_pixbuf_get_pixels (pixbuf);
+    gboolean         has_alpha  = gdk_pixbuf_get_has_alpha (pixbuf);
+    cairo_surface_t *surface;
+    guint8          *dst;
+    gint             dst_stride;
+    gint             x, y;
+
+    surface = cairo_image_surface_create (has_alpha ? CAIRO_FORMAT_ARGB32
+                                                    : CAIRO_FORMAT_RGB24,
+                                          width, height);
+    if (cairo_surface_status (surface) != CAIRO_STATUS_SUCCESS)
+        return surface;
+
+    cairo_surface_flush (surface);
+    dst        = cairo_image_surface_get_data (surface);
+    dst_stride = cairo_image_surface_get_stride (surface);
+
+    for (y = 0; y < height; y++) {
+        const guint8 *s = src + y * src_stride;
+        guint32      *d = (guint32 *) (dst + y * dst_stride);
+
+        for (x = 0; x < width; x++, s += n_channels) {
+            guint a = has_alpha ? s[3] : 0xff;
+            guint r = (s[0] * a + 127) / 255;
+            guint g = (s[1] * a + 127) / 255;
+            guint b = (s[2] * a + 127) / 255;
+
+            d[x] = (a << 24) | (r << 16) | (g << 8) | b;
+        }
+    }
+
+    cairo_surface_mark_dirty (surface);
+    return surface;
+}
+
+/* JPEG, BMP, GIF 처럼 cairo 가 풀지 못하는 것은 GdkPixbuf 로 푼다 */
+static cairo_surface_t *
+_ghwp_document_decode_pixbuf (GBytes *bytes, GError **error)
+{
+    GdkPixbufLoader *loader = gdk_pixbuf_loader_new ();
+    GdkPixbuf       *pixbuf;
+    cairo_surface_t *surface = NULL;
+    const guint8    *data;
+    gsize            size;
+    GError          *tmp_error = NULL;
+
+    data = g_bytes_get_data (bytes, &size);
+
+    if (gdk_pixbuf_loader_write (loader, data, size, &tmp_error)) {
+        if (gdk_pixbuf_loader_close (loader, &tmp_error)) {
+            pixbuf = gdk_pixbuf_loader_get_pixbuf (loader);
+            if (pixbuf)
+                surface = _ghwp_document_surface_from_pixbuf (pixbuf);
+        }
+    } else {
+        /* write 가 실패해도 close 는 불러야 한다 */
+        gdk_pixbuf_loader_close (loader, NULL);
+    }
+    g_object_unref (loader);
+
+    if (tmp_error) {
+        g_set_error (error, GHWP_ERROR,
+                     g_error_matches (tmp_error, GDK_PIXBUF_ERROR,
+                                      GDK_PIXBUF_ERROR_UNKNOWN_TYPE) ?
+                         GHWP_ERROR_INVALID : GHWP_ERROR_DAMAGED,
+                     "%s", tmp_error->message);
+        g_error_free (tmp_error);
+        return NULL;
+    }
+
+    if (surface == NULL) {
+        g_set_error_literal (error, GHWP_ERROR, GHWP_ERROR_DAMAGED,
+                             "cannot decode image");
+        return NULL;
+    }
+
+    if (cairo_surface_status (surface) != CAIRO_STATUS_SUCCESS) {
+        g_set_error_literal (error, GHWP_ERROR, GHWP_ERROR_DAMAGED,
+                             cairo_status_to_string (
+                                 cairo_surface_status (surface)));
+        cairo_surface_destroy (surface);
+        return NULL;
+    }
+
+    return surface;
+}
+#endif
+
+/* PNG 는 cairo 로 바로 풀고, 나머지는 GdkPixbuf 가 있을 때만 푼다 */
+static cairo_surface_t *
+_ghwp_document_decode_image (GBytes *bytes, GError **error)
+{
+    static const guint8 signature_png[] = {
+        0x89, 0x50, 0x4e, 0x47, 0x0d, 0x0a, 0x1a, 0x0a
+    };
+    cairo_surface_t *surface;
+    PngReader        reader;
+
+    reader.data = g_bytes_get_data (bytes, &reader.size);
+    reader.pos  = 0;
+
+    if (reader.size < sizeof (signature_png) ||
+        memcmp (reader.data, signature_png, sizeof (signature_png)) != 0) {
+#ifdef HAVE_GDK_PIXBUF
+        return _ghwp_document_decode_pixbuf (bytes, error);
+#else
+        g_set_error_literal (error, GHWP_ERROR, GHWP_ERROR_INVALID,
+                             "unsupported image format");
+        return NULL;
+#endif
+    }
+
+    surface = cairo_image_surface_create_from_png_stream (_png_read, &reader);
+
+    if (cairo_surface_status (surface) != CAIRO_STATUS_SUCCESS) {
+        g_set_error_literal (error, GHWP_ERROR, GHWP_ERROR_DAMAGED,
+                             cairo_status_to_string (
+                                 cairo_surface_status (surface)));
+        cairo_surface_destroy (surface);
+        return NULL;
+    }
+
+    return surface;
+}
+
+/**
+ * ghwp_document_get_image:
+ * @doc: a #GHWPDocument
+ * @bin_id: BinData ID of the image, starting at 1
+ * @error: (allow-none): Return location for an error, or %NULL
+ *
+ * Returns the embedded image @bin_id as a cairo image surface.  The image
+ * is read and decoded the first time it is requested and kept in a
+ * size-bounded cache shared by all pages of @doc; see
+ * ghwp_document_set_image_cache_size().  PNG images are always decoded;
+ * other formats such as JPEG, BMP and GIF only when libghwp was built with
+ * gdk-pixbuf, and otherwise fail with %GHWP_ERROR_INVALID.
+ * Safe to call from any thread, including while @doc is loading.
+ *
+ * Return value: (transfer full): a #cairo_surface_t, or %NULL.  Free with
+ *     cairo_surface_destroy().
+ */
+cairo_surface_t *ghwp_document_get_image (GHWPDocument *doc,
+                                          guint         bin_id,
+                                          GError      **error)
+{
+    g_return_val_if_fail (GHWP_IS_DOCUMENT (doc), NULL);
+
+    cairo_surface_t   *surface;
+    const GHWPBinData *bin;
+    GHWPFileV5        *file;
+    GBytes            *bytes;
+    gboolean           compressed;
+    guint16            storage_id = (guint16) bin_id;
+
+    surface = _ghwp_lru_cache_lookup (doc->priv->image_cache,
+                                      GUINT_TO_POINTER (bin_id));
+    if (surface)
+        return surface;
+
+    if (!GHWP_IS_FILE_V5 (doc->file)) {
+        g_set_error_literal (error, GHWP_ERROR, GHWP_ERROR_INVALID,
+                             "document has no embedded images");
+        return NULL;
+    }
+
+    file       = GHWP_FILE_V5 (doc->file);
+    bin        = ghwp_doc_info_get_bin_data (doc->doc_info, bin_id);
+    compressed = file->is_compress;
+
+    if (bin) {
+        if (GHWP_BIN_DATA_TYPE (bin) == GHWP_BIN_DATA_TYPE_LINK) {
+            g_set_error_literal (error, GHWP_ERROR, GHWP_ERROR_INVALID,
+                                 "linked images are not supported");
+            return NULL;
+        }
+        storage_id = bin->bin_id;
+        if (GHWP_BIN_DATA_COMPRESSION (bin) == 1)
+            compressed = TRUE;
+        else if (GHWP_BIN_DATA_COMPRESSION (bin) == 2)
+            compressed = FALSE;
+    }
+
+    bytes = ghwp_file_v5_get_bin_data (file, storage_id, compressed, error);
+    if (bytes == NULL)
+        return NULL;
+
+    surface = _ghwp_document_decode_image (bytes, error);
+    g_bytes_unref (bytes);
+
+    if (surface == NULL)
+        return NULL;
+
+    _ghwp_lru_cache_insert (doc->priv->image_cache,
+                            GUINT_TO_POINTER (bin_id),
+                            cairo_surface_reference (surface),
+                            (gsize) cairo_image_surface_get_stride (surface) *
+                            (gsize) cairo_image_surface_get_height (surface));
+    return surface;
+}
+
+/**
+ * ghwp_document_set_image_cache_size:
+ * @doc: a #GHWPDocument
+ * @max_bytes: memory budget for decoded images
+ *
+ * Sets how many bytes of decoded image data @doc keeps.  The least
+ * recently used images are dropped first.  The default is 64 MiB.
+ */
+void ghwp_document_set_image_cache_size (GHWPDocument *doc, gsize max_bytes)
+{
+    g_return_if_fail (GHWP_IS_DOCUMENT (doc));
+    _ghwp_lru_cache_set_max_cost (doc->priv->image_cache, max_bytes);
+}
+
+/* 이하 구역 함수들은 doc->priv->lock 을 잡은 상태에서 부른다 */
+
+static gsize _ghwp_document_section_cost (GHWPDocument       *doc,
+                                          const SectionEntry *section)
+{
+    gsize text   = 0;
+    gsize models = 0;
+    guint i;
+
+    for (i = 0; i < section->n_paragraphs; i++) {
+        GHWPParagraph *paragraph;
+        paragraph = g_array_index (doc->paragraphs, GHWPParagraph *,
+                                   section->first_paragraph + i);
+        if (paragraph)
+            _ghwp_paragraph_add_memory_usage (paragraph, &text, &models);
+    }
+
+    return text + models;
+}
+
+/* 구역의 문단을 놓는다. 밖에서 참조를 가진 페이지는 그대로 쓸 수 있다. */
+static void _ghwp_document_evict_section (GHWPDocument *doc, guint index)
+{
+    SectionEntry *section;
+    guint         i;
+
+    section = &g_array_index (doc->priv->sections, SectionEntry, index);
+
+    for (i = 0; i < section->n_paragraphs; i++)
+        _g_object_unref0 (g_array_index (doc->paragraphs, GHWPParagraph *,
+                                         section->first_paragraph + i));
+
+    g_queue_delete_link (&doc->priv->resident_sections, section->link);
+    section->link = NULL;
+    doc->priv->section_cost -= section->cost;
+    section->cost = 0;
+}
+
+/* 가장 최근에 쓴 구역은 예산을 넘어도 남긴다 */
+static void _ghwp_document_trim_sections (GHWPDocument *doc)
+{
+    GHWPDocumentPrivate *priv = doc->priv;
+
+    while (priv->section_cache_size > 0 &&
+           priv->section_cost > priv->section_cache_size &&
+           priv->resident_sections.length > 1)
+        _ghwp_document_evict_section (doc, GPOINTER_TO_UINT (
+                                  g_queue_peek_tail (&priv->resident_sections)));
+}
+
+static void _ghwp_document_keep_section (GHWPDocument *doc, guint index)
+{
+    SectionEntry *section;
+
+    section = &g_array_index (doc->priv->sections, SectionEntry, index);
+    section->cost = _ghwp_document_section_cost (doc, section);
+    doc->priv->section_cost += section->cost;
+    g_queue_push_head (&doc->priv->resident_sections, GUINT_TO_POINTER (index));
+    section->link = doc->priv->resident_sections.head;
+
+    _ghwp_document_trim_sections (doc);
+}
+
+/* 다시 읽은 구역이 처음 읽었을 때와 같은 페이지로 나뉘었는지 본다.
+ * page_ranges 의 문단 번호는 구역 안에서 센 것이다. 빈 페이지(글자나
+ * 표가 없는 구역, 넘친 첫 문단 앞)의 first_paragraph 는 의미가 없다. */
+static gboolean _ghwp_document_section_matches (GHWPDocument       *doc,
+                                                const SectionEntry *section,
+                                                GArray             *paragraphs,
+                                                GArray             *page_ranges)
+{
+    guint i;
+
+    if (paragraphs->len != section->n_paragraphs ||
+        page_ranges->len != section->n_pages)
+        return FALSE;
+
+    for (i = 0; i < page_ranges->len; i++) {
+        const GHWPPageRange *a, *b;
+
+        a = &g_array_index (page_ranges, GHWPPageRange, i);
+        b = &g_array_index (doc->page_ranges, GHWPPageRange,
+                            section->first_page + i);
+        if (a->n_paragraphs != b->n_paragraphs ||
+            (a->n_paragraphs > 0 &&
+             a->first_paragraph + section->first_paragraph !=
+                 b->first_paragraph) ||
+            a->first_row != b->first_row ||
+            a->end_row != b->end_row)
+            return FALSE;
+    }
+
+    return TRUE;
+}
+
+/* 버린 구역을 파일에서 다시 읽어 빈 칸을 채운다. 구역은 항상 새 페이지에서
+ * 시작하므로 다시 읽어도 처음과 같은 페이지로 나뉜다. */
+static gboolean _ghwp_document_reload_section (GHWPDocument *doc, guint index)
+{
+    SectionEntry *section;
+    GArray       *paragraphs;
+    GArray       *page_ranges;
+    GError       *error = NULL;
+    guint         i;
+
+    section     = &g_array_index (doc->priv->sections, SectionEntry, index);
+    paragraphs  = g_array_new (FALSE, FALSE, sizeof (GHWPParagraph *));
+    page_ranges = g_array_new (FALSE, FALSE, sizeof (GHWPPageRange));
+    g_array_set_clear_func (paragraphs, _g_object_unref_element);
+
+    if (_ghwp_file_load_section (doc->file, index, paragraphs, page_ranges,
+                                 &error) &&
+        !_ghwp_document_section_matches (doc, section, paragraphs,
+                                         page_ranges))
+        g_set_error (&error, GHWP_ERROR, GHWP_ERROR_DAMAGED,
+                     "section %u changed since it was loaded", index);
+    g_array_free (page_ranges, TRUE);
+
+    if (error) {
+        g_warning ("cannot reload section %u: %s", index, error->message);
+        g_error_free (error);
+        g_array_free (paragraphs, TRUE);
+        return FALSE;
+    }
+
+    /* 배열의 참조를 문서로 옮긴다 */
+    for (i = 0; i < paragraphs->len; i++) {
+        g_array_index (doc->paragraphs, GHWPParagraph *,
+                       section->first_paragraph + i) =
+            g_array_index (paragraphs, GHWPParagraph *, i);
+        g_array_index (paragraphs, GHWPParagraph *, i) = NULL;
+    }
+    g_array_free (paragraphs, TRUE);
+
+    _ghwp_document_keep_section (doc, index);
+
+    return TRUE;
+}
+
+/* 문단 index 가 든 구역, 아직 다 읽지 않은 구역이면 G_MAXUINT */
+static guint _ghwp_document_find_section (GHWPDocument *doc, guint index)
+{
+    GArray *sections = doc->priv->sections;
+    guint   lo = 0;
+    guint   hi = sections->len;
+
+    while (lo < hi) {
+        guint         mid     = lo + (hi - lo) / 2;
+        SectionEntry *section = &g_array_index (sections, SectionEntry, mid);
+
+        if (index < section->first_paragraph)
+            hi = mid;
+        else if (index >= section->first_paragraph + section->n_paragraphs)
+            lo = mid + 1;
+        else
+            return mid;
+    }
+
+    return G_MAXUINT;
+}
+
+/* private
+ * doc->priv->lock 을 잡은 상태에서 부른다. 내보낸 페이지에 놓인 문단의
+ * 수. 읽는 중에는 마지막 문단에 아직 글자나 셀이 더해질 수 있지만,
+ * 로더는 페이지를 최상위 문단 경계에서 내보내므로 이 문단들은 다 읽은
+ * 것이다. */
+guint _ghwp_document_get_n_published_paragraphs (GHWPDocument *doc)
+{
+    guint i;
+
+    for (i = doc->page_ranges->len; i > 0; i--) {
+        const GHWPPageRange *range;
+
+        range = &g_array_index (doc->page_ranges, GHWPPageRange, i - 1);
+        if (range->n_paragraphs > 0)
+            return range->first_paragraph + range->n_paragraphs;
+    }
+
+    return 0;
+}
+
+/* private
+ * doc->priv->lock 을 잡은 상태에서 부른다. 버린 구역의 문단이면 구역을
+ * 다시 읽는다. 돌려준 문단은 lock 을 놓거나 다른 구역의 문단을 꺼내기
+ * 전까지만 쓸 수 있다. */
+GHWPParagraph *_ghwp_document_peek_paragraph (GHWPDocument *doc, guint index)
+{
+    GHWPParagraph *paragraph;
+    SectionEntry  *section;
+    guint          n;
+
+    if (index >= doc->paragraphs->len)
+        return NULL;
+
+    paragraph = g_array_index (doc->paragraphs, GHWPParagraph *, index);
+    n         = _ghwp_document_find_section (doc, index);
+    if (n == G_MAXUINT)
+        return paragraph;
+
+    section = &g_array_index (doc->priv->sections, SectionEntry, n);
+    if (section->link) {
+        g_queue_unlink (&doc->priv->resident_sections, section->link);
+        g_queue_push_head_link (&doc->priv->resident_sections, section->link);
+        return paragraph;
+    }
+
+    if (!_ghwp_document_reload_section (doc, n))
+        return NULL;
+
+    return g_array_index (doc->paragraphs, GHWPParagraph *, index);
+}
+
+/**
+ * ghwp_document_set_section_cache_size:
+ * @doc: a #GHWPDocument
+ * @max_bytes: memory budget for parsed sections, or 0 for no limit
+ *
+ * Bounds the memory held by the paragraphs of @doc.  Once the parsed
+ * sections exceed @max_bytes, the least recently used sections are
+ * dropped and parsed again from the file when one of their pages is
+ * requested.  The most recently used section is always kept.  Pages
+ * already returned by ghwp_document_get_page() stay valid.  Only HWP v5
+ * documents can drop sections.  The default is 0, which keeps every
+ * section.
+ */
+void ghwp_document_set_section_cache_size (GHWPDocument *doc, gsize max_bytes)
+{
+    g_return_if_fail (GHWP_IS_DOCUMENT (doc));
+
+    g_mutex_lock (&doc->priv->lock);
+    doc->priv->section_cache_size = max_bytes;
+    _ghwp_document_trim_sections (doc);
+    g_mutex_unlock (&doc->priv->lock);
+}
+
+/**
+ * ghwp_document_get_memory_usage:
+ * @doc: a #GHWPDocument
+ * @usage: (out caller-allocates) (allow-none): return location for the
+ *     breakdown, or %NULL
+ *
+ * Estimates the memory held by @doc.  Paragraphs are counted once the
+ * page holding them is complete, so the value grows while @doc is
+ * loading.  Sections dropped by
+ * ghwp_document_set_section_cache_size() are not counted, nor are pages
+ * returned by ghwp_document_get_page(), which belong to the caller.
+ * Allocator overhead is not included.  Safe to call from any thread.
+ *
+ * Return value: the total number of bytes
+ */
+gsize ghwp_document_get_memory_usage (GHWPDocument    *doc,
+                                      GHWPMemoryUsage *usage)
+{
+    g_return_val_if_fail (GHWP_IS_DOCUMENT (doc), 0);
+
+    GHWPMemoryUsage tmp = { 0, 0, 0, 0 };
+    guint           n_paragraphs;
+    guint           i;
+
+    g_mutex_lock (&doc->priv->lock);
+    tmp.models += sizeof (GHWPDocument) + sizeof (GHWPDocumentPrivate) +
+                  doc->page_ranges->len * sizeof (GHWPPageRange) +
+                  doc->paragraphs->len * sizeof (GHWPParagraph *);
+
+    /* 로더가 아직 고치고 있는 마지막 문단은 건드리지 않는다 */
+    n_paragraphs = _ghwp_document_get_n_published_paragraphs (doc);
+    for (i = 0; i < n_paragraphs; i++) {
+        GHWPParagraph *paragraph;
+        paragraph = g_array_index (doc->paragraphs, GHWPParagraph *, i);
+
+        /* 버린 구역 */
+        if (paragraph == NULL)
+            continue;
+
+        _ghwp_paragraph_add_memory_usage (paragraph, &tmp.text, &tmp.models);
+    }
+    g_mutex_unlock (&doc->priv->lock);
+
+    if (doc->prv_text)
+        tmp.text += strlen (doc->prv_text) + 1;
+    tmp.models += _ghwp_doc_info_get_memory_usage (doc->doc_info);
+    if (doc->file)
+        tmp.streams = _ghwp_file_get_memory_usage (doc->file);
+    tmp.caches = _ghwp_lru_cache_get_cost (doc->priv->image_cache);
+    g_mutex_lock (&doc->priv->lock);
+    tmp.caches += _ghwp_search_index_get_memory_usage (
+                      doc->priv->search_index[0]) +
+                  _ghwp_search_index_get_memory_usage (
+                      doc->priv->search_index[1]) +
+                  _ghwp_text_store_get_memory_usage (doc->priv->text_store);
+    g_mutex_unlock (&doc->priv->lock);
+
+    if (usage)
+        *usage = tmp;
+
+    return tmp.text + tmp.models + tmp.streams + tmp.caches;
+}
+
+static gboolean _ghwp_document_page_added_idle (gpointer user_data)
+{
+    PageAddedData *data = user_data;
+
+    g_signal_emit (data->doc, signals[PAGE_ADDED], 0, data->n_page);
+
+    return FALSE;
+}
+
+/* private
+ * 완성된 페이지를 문서에 더한다. 로더는 더 이상 고치지 않을 문단으로 된
+ * 페이지만 넘겨야 한다. */
+void _ghwp_document_add_page_range (GHWPDocument        *doc,
+                                    const GHWPPageRange *range)
+{
+    g_return_if_fail (GHWP_IS_DOCUMENT (doc));
+    g_return_if_fail (range != NULL);
+
+    GMainContext *context;
+    guint         n_page;
+
+    g_mutex_lock (&doc->priv->lock);
+    n_page = doc->page_ranges->len;
+    g_array_append_vals (doc->page_ranges, range, 1);
+    context = doc->priv->signal_context;
+    g_mutex_unlock (&doc->priv->lock);
+
+    if (context) {
+        PageAddedData *data = g_slice_new (PageAddedData);
+        data->doc    = g_object_ref (doc);
+        data->n_page = n_page;
+        _ghwp_document_idle_add (context,
+                                 _ghwp_document_page_added_idle,
+                                 data,
+                                 (GDestroyNotify) _page_added_data_free);
+    } else {
+        g_signal_emit (doc, signals[PAGE_ADDED], 0, n_page);
+    }
+}
+
+static gboolean _ghwp_document_load_progress_idle (gpointer user_data)
+{
+    ProgressData *data = user_data;
+
+    g_signal_emit (data->doc, signals[LOAD_PROGRESS], 0,
+                   data->n_done, data->n_total,
+                   data->bytes_done, data->bytes_total);
+
+    return FALSE;
+}
+
+/* private
+ * load-progress 를 page-added 와 같은 main context 에서 보낸다. */
+void _ghwp_document_emit_load_progress (GHWPDocument *doc,
+                                        guint         n_done,
+                                        guint         n_total,
+                                        guint64       bytes_done,
+                                        guint64       bytes_total)
+{
+    g_return_if_fail (GHWP_IS_DOCUMENT (doc));
+
+    GMainContext *context;
+
+    g_mutex_lock (&doc->priv->lock);
+    context = doc->priv->signal_context;
+    g_mutex_unlock (&doc->priv->lock);
+
+    if (context) {
+        ProgressData *data = g_slice_new0 (ProgressData);
+        data->doc         = g_object_ref (doc);
+        data->n_done      = n_done;
+        data->n_total     = n_total;
+        data->bytes_done  = bytes_done;
+        data->bytes_total = bytes_total;
+        _ghwp_document_idle_add (context,
+                                 _ghwp_document_load_progress_idle,
+                                 data,
+                                 (GDestroyNotify) _progress_data_free);
+    } else {
+        g_signal_emit (doc, signals[LOAD_PROGRESS], 0,
+                       n_done, n_total, bytes_done, bytes_total);
+    }
+}
+
+/* private
+ * 로더가 페이지를 채울 때 쓴다. 문단은 번호 순서로 더해야 한다. 이미
+ * 마지막인 문단을 다시 더하면 아무것도 하지 않는다. */
+void _ghwp_page_range_add_paragraph (GHWPPageRange *range, guint index)
+{
+    g_return_if_fail (range != NULL);
+
+    if (range->n_paragraphs == 0) {
+        range->first_paragraph = index;
+        range->first_row       = 0;
+    } else {
+        g_return_if_fail (index >= range->first_paragraph +
+                                   range->n_paragraphs - 1);
+    }
+
+    range->n_paragraphs = index - range->first_paragraph + 1;
+    range->end_row      = G_MAXUINT;
+}
+
+/* private
+ * page-added 를 보낼 main context, NULL 이면 _ghwp_document_add_page_range 를
+ * 부른 스레드에서 바로 보낸다. */
+void _ghwp_document_set_signal_context (GHWPDocument *doc,
+                                        GMainContext *context)
+{
+    g_return_if_fail (GHWP_IS_DOCUMENT (doc));
+
+    g_mutex_lock (&doc->priv->lock);
+    if (doc->priv->signal_context)
+        g_main_context_unref (doc->priv->signal_context);
+    doc->priv->signal_context = context ? g_main_context_ref (context) : NULL;
+    g_mutex_unlock (&doc->priv->lock);
+}
+
+/* private
+ * 최상위 문단을 더한다. 다른 스레드에서 버린 구역을 다시 채울 수 있으므로
+ * 잠그고 더한다. */
+void _ghwp_document_add_paragraph (GHWPDocument  *doc,
+                                   GHWPParagraph *paragraph)
+{
+    g_return_if_fail (GHWP_IS_DOCUMENT (doc));
+
+    g_mutex_lock (&doc->priv->lock);
+    g_array_append_val (doc->paragraphs, paragraph);
+    g_mutex_unlock (&doc->priv->lock);
+}
+
+/* private
+ * 구역을 읽기 전에 부른다. 이후 더한 문단과 페이지가 그 구역에 속한다.
+ * 구역의 첫 문단이 될 번호를 돌려준다. */
+guint _ghwp_document_begin_section (GHWPDocument *doc)
+{
+    g_return_val_if_fail (GHWP_IS_DOCUMENT (doc), 0);
+
+    guint first_paragraph;
+
+    g_mutex_lock (&doc->priv->lock);
+    first_paragraph = doc->priv->section_first_paragraph = doc->paragraphs->len;
+    doc->priv->section_first_page = doc->page_ranges->len;
+    g_mutex_unlock (&doc->priv->lock);
+
+    return first_paragraph;
+}
+
+/* private
+ * 구역을 끝까지 읽은 뒤 부른다. 이때부터 구역을 버리고 다시 읽을 수 있다.
+ * 구역의 번호는 부른 순서이고 _ghwp_file_load_section 의 index 와 같다. */
+void _ghwp_document_end_section (GHWPDocument *doc)
+{
+    g_return_if_fail (GHWP_IS_DOCUMENT (doc));
+
+    SectionEntry section;
+
+    g_mutex_lock (&doc->priv->lock);
+    section.first_paragraph = doc->priv->section_first_paragraph;
+    section.n_paragraphs    = doc->paragraphs->len - section.first_paragraph;
+    section.first_page      = doc->priv->section_first_page;
+    section.n_pages         = doc->page_ranges->len - section.first_page;
+    section.cost            = 0;
+    section.link            = NULL;
+    g_array_append_val (doc->priv->sections, section);
+    _ghwp_document_keep_section (doc, doc->priv->sections->len - 1);
+    g_mutex_unlock (&doc->priv->lock);
 }
 
 /**
@@ -120,23 +1196,104 @@ GHWPDocument *ghwp_document_new (void)
 static void ghwp_document_class_init (GHWPDocumentClass *klass)
 {
     GObjectClass *object_class = G_OBJECT_CLASS (klass);
+    g_type_class_add_private (klass, sizeof (GHWPDocumentPrivate));
     object_class->finalize     = ghwp_document_finalize;
+
+    /**
+     * GHWPDocument::page-added:
+     * @document: the #GHWPDocument
+     * @n_page: index of the page that was added
+     *
+     * Emitted each time the loader completes a page.  When the document is
+     * loaded with ghwp_document_new_from_file_async() the signal is emitted
+     * in the caller's main context.
+     */
+    signals[PAGE_ADDED] = g_signal_new ("page-added",
+                                        G_TYPE_FROM_CLASS (klass),
+                                        G_SIGNAL_RUN_LAST,
+                                        G_STRUCT_OFFSET (GHWPDocumentClass,
+                                                         page_added),
+                                        NULL, NULL,
+                                        g_cclosure_marshal_VOID__UINT,
+                                        G_TYPE_NONE, 1, G_TYPE_UINT);
+
+    /**
+     * GHWPDocument::load-progress:
+     * @document: the #GHWPDocument
+     * @n_done: number of units loaded so far
+     * @n_total: total number of units
+     * @bytes_done: bytes of the body loaded so far
+     * @bytes_total: size of the body in bytes, or 0 if it is not known
+     *
+     * Emitted as the loader goes through the body, with the same values
+     * as #GHWPProgressCallback.  When the document is loaded with
+     * ghwp_document_new_from_file_async() the signal is emitted in the
+     * caller's main context.
+     */
+    signals[LOAD_PROGRESS] = g_signal_new ("load-progress",
+                                           G_TYPE_FROM_CLASS (klass),
+                                           G_SIGNAL_RUN_LAST,
+                                           G_STRUCT_OFFSET (GHWPDocumentClass,
+                                                            load_progress),
+                                           NULL, NULL, NULL,
+                                           G_TYPE_NONE, 4,
+                                           G_TYPE_UINT, G_TYPE_UINT,
+                                           G_TYPE_UINT64, G_TYPE_UINT64);
 }
 
 static void ghwp_document_init (GHWPDocument *doc)
 {
-    doc->paragraphs = g_array_new (TRUE, TRUE, sizeof (GHWPParagraph *));
-    doc->pages      = g_array_new (TRUE, TRUE, sizeof (GHWPPage *));
+    doc->priv = G_TYPE_INSTANCE_GET_PRIVATE (doc, GHWP_TYPE_DOCUMENT,
+                                                  GHWPDocumentPrivate);
+    g_mutex_init (&doc->priv->lock);
+    doc->priv->image_cache = _ghwp_lru_cache_new (
+                                 g_direct_hash, g_direct_equal, NULL,
+                                 (GBoxedCopyFunc) cairo_surface_reference,
+                                 (GDestroyNotify) cairo_surface_destroy,
+                                 GHWP_DOCUMENT_IMAGE_CACHE_SIZE);
+    doc->paragraphs  = g_array_new (TRUE, TRUE, sizeof (GHWPParagraph *));
+    doc->page_ranges = g_array_new (FALSE, FALSE, sizeof (GHWPPageRange));
+    /* 문서가 문단을 하나씩 참조한다. 페이지는 가져간 쪽이 가진다. */
+    g_array_set_clear_func (doc->paragraphs, _g_object_unref_element);
+    doc->priv->live_pages = g_hash_table_new_full (g_direct_hash,
+                                                   g_direct_equal, NULL,
+                                                   _ghwp_weak_ref_free);
+    doc->doc_info   = ghwp_doc_info_new ();
+    doc->priv->sections = g_array_new (FALSE, FALSE, sizeof (SectionEntry));
+    g_queue_init (&doc->priv->resident_sections);
 }
 
 static void ghwp_document_finalize (GObject *obj)
 {
     GHWPDocument *doc = GHWP_DOCUMENT(obj);
+    GHWPStats     stats;
+
+    /* GHWP_STATS 를 설정했으면 요약을 남긴다 */
+    if (g_getenv ("GHWP_STATS") && ghwp_document_get_stats (doc, &stats)) {
+        gchar *summary = ghwp_stats_to_string (&stats);
+        g_printerr ("%s", summary);
+        g_free (summary);
+    }
+
     _g_object_unref0 (doc->file);
     _g_free0 (doc->prv_text);
     _g_array_free0 (doc->paragraphs);
-    _g_array_free0 (doc->pages);
+    _g_array_free0 (doc->page_ranges);
+    g_hash_table_destroy (doc->priv->live_pages);
+    ghwp_doc_info_free (doc->doc_info);
     _g_object_unref0 (doc->summary_info);
+    if (doc->priv->signal_context)
+        g_main_context_unref (doc->priv->signal_context);
+    _ghwp_lru_cache_free (doc->priv->image_cache);
+    _ghwp_search_index_free (doc->priv->search_index[0]);
+    _ghwp_search_index_free (doc->priv->search_index[1]);
+    if (doc->priv->text_store)
+        ghwp_text_store_unref (doc->priv->text_store);
+    if (doc->priv->fonts)
+        _ghwp_font_set_unref (doc->priv->fonts);
+    g_array_free (doc->priv->sections, TRUE);
+    g_queue_clear (&doc->priv->resident_sections);
+    g_mutex_clear (&doc->priv->lock);
     G_OBJECT_CLASS (ghwp_document_parent_class)->finalize (obj);
 }
 
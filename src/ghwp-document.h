@@ -22,9 +22,12 @@
 #define __GHWP_DOCUMENT_H__
 
 #include <glib-object.h>
+#include <gio/gio.h>
 #include <gsf/gsf-doc-meta-data.h>
+#include <cairo.h>
 
 #include "ghwp.h"
+#include "ghwp-doc-info.h"
 
 G_BEGIN_DECLS
 
@@ -38,6 +41,44 @@ G_BEGIN_DECLS
 typedef struct _GHWPDocument        GHWPDocument;
 typedef struct _GHWPDocumentClass   GHWPDocumentClass;
 typedef struct _GHWPDocumentPrivate GHWPDocumentPrivate;
+typedef struct _GHWPMemoryUsage     GHWPMemoryUsage;
+typedef struct _GHWPPageRange       GHWPPageRange;
+
+/**
+ * GHWPMemoryUsage:
+ * @text: paragraph text and the preview text
+ * @models: paragraphs, tables, cells, pages and DocInfo tables
+ * @streams: source data and stream indexes held by the file
+ * @caches: decoded images, the search index and the text store
+ *
+ * Bytes held by a #GHWPDocument, see ghwp_document_get_memory_usage().
+ */
+struct _GHWPMemoryUsage {
+    gsize text;
+    gsize models;
+    gsize streams;
+    gsize caches;
+};
+
+/**
+ * GHWPPageRange:
+ * @first_paragraph: index in #GHWPDocument.paragraphs of the first
+ *     paragraph on the page
+ * @n_paragraphs: number of consecutive paragraphs on the page
+ * @first_row: first row drawn of the table of the first paragraph;
+ *     greater than 0 when the table continues from the previous page
+ * @end_row: row of the table of the last paragraph where the page ends,
+ *     or %G_MAXUINT when the table ends on the page
+ *
+ * Where a page of a #GHWPDocument starts and ends.  The #GHWPPage itself
+ * is made from this by ghwp_document_get_page().
+ */
+struct _GHWPPageRange {
+    guint first_paragraph;
+    guint n_paragraphs;
+    guint first_row;
+    guint end_row;
+};
 
 struct _GHWPDocument {
     GObject              parent_instance;
@@ -45,7 +86,8 @@ struct _GHWPDocument {
     GHWPFile            *file;
     gchar               *prv_text;
     GArray              *paragraphs;
-    GArray              *pages;
+    GArray              *page_ranges; /* GHWPPageRange */
+    GHWPDocInfo         *doc_info;
     GsfDocMetaData      *summary_info;
     /* ev info */
     const gchar         *title;
@@ -75,6 +117,37 @@ struct _GHWPDocument {
 
 struct _GHWPDocumentClass {
     GObjectClass parent_class;
+    void (*page_added)    (GHWPDocument *document, guint n_page);
+    void (*load_progress) (GHWPDocument *document,
+                           guint         n_done,
+                           guint         n_total,
+                           guint64       bytes_done,
+                           guint64       bytes_total);
+};
+
+struct _GHWPDocumentPrivate {
+    /* 읽는 동안 다른 스레드에서 paragraphs, page_ranges 에 접근하므로
+     * 잠근다 */
+    GMutex                lock;
+    GMainContext         *signal_context;
+    /* BinData ID -> cairo_surface_t, 페이지 사이에 공유한다 */
+    struct _GHWPLRUCache *image_cache;
+    /* 찾기용 정규화된 글자, [0] 대소문자 구분, [1] 접음. lock 으로 보호 */
+    struct _GHWPSearchIndex *search_index[2];
+    /* 문서 전체의 글자, 처음 달라고 할 때 만든다. lock 으로 보호 */
+    struct _GHWPTextStore   *text_store;
+    /* 페이지들이 함께 쓰는 글꼴, 첫 페이지를 만들 때 만든다 */
+    struct _GHWPFontSet     *fonts;
+    /* 페이지 번호 -> 내준 페이지의 GWeakRef. lock 으로 보호 */
+    GHashTable           *live_pages;
+    /* 다 읽은 구역의 문단, 페이지 범위. lock 으로 보호 */
+    GArray               *sections;
+    guint                 section_first_paragraph;
+    guint                 section_first_page;
+    /* 모델을 들고 있는 구역, 최근에 쓴 것이 앞 */
+    GQueue                resident_sections;
+    gsize                 section_cost;
+    gsize                 section_cache_size; /* 0 이면 버리지 않는다 */
 };
 
 GType         ghwp_document_get_type           (void) G_GNUC_CONST;
@@ -83,8 +156,34 @@ GHWPDocument *ghwp_document_new_from_uri       (const gchar  *uri,
                                                 GError      **error);
 GHWPDocument *ghwp_document_new_from_filename  (const gchar  *filename,
                                                 GError      **error);
+void          ghwp_document_new_from_file_async
+                                   (GFile               *file,
+                                    GCancellable        *cancellable,
+                                    GHWPProgressCallback progress_callback,
+                                    gpointer             progress_data,
+                                    GAsyncReadyCallback  callback,
+                                    gpointer             user_data);
+GHWPDocument *ghwp_document_new_from_file_finish
+                                   (GAsyncResult        *result,
+                                    GError             **error);
 guint     ghwp_document_get_n_pages            (GHWPDocument *doc);
 GHWPPage *ghwp_document_get_page               (GHWPDocument *doc, gint n_page);
+GHWPDocInfo *ghwp_document_get_doc_info        (GHWPDocument *doc);
+cairo_surface_t *
+          ghwp_document_get_image              (GHWPDocument *doc,
+                                                guint         bin_id,
+                                                GError      **error);
+void      ghwp_document_set_image_cache_size   (GHWPDocument *doc,
+                                                gsize         max_bytes);
+void      ghwp_document_set_section_cache_size (GHWPDocument *doc,
+                                                gsize         max_bytes);
+gsize     ghwp_document_get_memory_usage       (GHWPDocument    *doc,
+                                                GHWPMemoryUsage *usage);
+gboolean  ghwp_document_export_pdf             (GHWPDocument  *doc,
+                                                GOutputStream *output,
+                                                guint          n_threads,
+                                                GCancellable  *cancellable,
+                                                GError       **error);
 /* meta data */
 gchar    *ghwp_document_get_title              (GHWPDocument *document);
 gchar    *ghwp_document_get_keywords           (GHWPDocument *document);
@@ -99,6 +198,27 @@ void      ghwp_document_get_hwp_version        (GHWPDocument *document,
                                                 guint8       *minor_version,
                                                 guint8       *micro_version,
                                                 guint8       *extra_version);
+/* private */
+void      _ghwp_document_add_page_range        (GHWPDocument        *doc,
+                                                const GHWPPageRange *range);
+void      _ghwp_document_set_signal_context    (GHWPDocument *doc,
+                                                GMainContext *context);
+void      _ghwp_document_emit_load_progress    (GHWPDocument *doc,
+                                                guint         n_done,
+                                                guint         n_total,
+                                                guint64       bytes_done,
+                                                guint64       bytes_total);
+void      _ghwp_document_add_paragraph         (GHWPDocument          *doc,
+                                                struct _GHWPParagraph *paragraph);
+guint     _ghwp_document_begin_section         (GHWPDocument *doc);
+void      _ghwp_document_end_section           (GHWPDocument *doc);
+struct _GHWPParagraph *
+          _ghwp_document_peek_paragraph        (GHWPDocument *doc,
+                                                guint         index);
+guint     _ghwp_document_get_n_published_paragraphs
+                                               (GHWPDocument *doc);
+void      _ghwp_page_range_add_paragraph       (GHWPPageRange *range,
+                                                guint          index);
 
 G_END_DECLS
 
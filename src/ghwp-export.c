@@ -0,0 +1,235 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4; tab-width: 4 -*- */
+/*
+ * ghwp-export.c
+ *
+ * Copyright (C) 2013 Hodong Kim <cogniti@gmail.com>
+ *
+ * This library is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * 작업 스레드들이 페이지를 recording surface 에 그리고, 부른 스레드가
+ * 차례대로 PDF surface 에 다시 그린다. 그려 놓고 아직 내보내지 않은
+ * 페이지는 window 개를 넘지 않으므로 메모리가 페이지 수에 따라 늘지 않는다.
+ */
+
+#include <cairo-pdf.h>
+
+#include "ghwp-document.h"
+#include "ghwp-page.h"
+
+typedef struct
+{
+    GHWPDocument     *doc;
+    guint             n_pages;
+    guint             window;
+    cairo_surface_t **slots;    /* 페이지 i 는 slots[i % window] */
+    guint             next;     /* 다음에 그릴 페이지 */
+    guint             emitted;  /* 내보낸 페이지 수 */
+    gboolean          aborted;
+    GMutex            lock;
+    GCond             cond;
+    /* PDF 쓰기 */
+    GOutputStream    *output;
+    GCancellable     *cancellable;
+    GError           *error;
+} ExportData;
+
+/* 뷰어가 쓰는 페이지 기록 캐시를 밀어내지 않도록 캐시를 거치지 않는다 */
+static cairo_surface_t *_ghwp_export_record_page (GHWPDocument *doc,
+                                                  guint         n_page)
+{
+    GHWPPage          *page = ghwp_document_get_page (doc, (gint) n_page);
+    cairo_surface_t   *surface;
+    cairo_rectangle_t  extents = { 0.0, 0.0, 0.0, 0.0 };
+
+    if (page == NULL)
+        return cairo_recording_surface_create (CAIRO_CONTENT_COLOR_ALPHA,
+                                               &extents);
+
+    surface = _ghwp_page_record (page, NULL);
+    g_object_unref (page);
+
+    return surface;
+}
+
+static gpointer _ghwp_export_worker (gpointer user_data)
+{
+    ExportData *data = user_data;
+    guint       n_page;
+
+    for (;;) {
+        cairo_surface_t *surface;
+
+        g_mutex_lock (&data->lock);
+        /* 내보내지 않은 페이지가 window 개이면 기다린다 */
+        while (!data->aborted && data->next < data->n_pages &&
+               data->next >= data->emitted + data->window)
+            g_cond_wait (&data->cond, &data->lock);
+
+        if (data->aborted || data->next >= data->n_pages) {
+            g_mutex_unlock (&data->lock);
+            break;
+        }
+        n_page = data->next++;
+        g_mutex_unlock (&data->lock);
+
+        surface = _ghwp_export_record_page (data->doc, n_page);
+
+        g_mutex_lock (&data->lock);
+        data->slots[n_page % data->window] = surface;
+        g_cond_broadcast (&data->cond);
+        g_mutex_unlock (&data->lock);
+    }
+
+    return NULL;
+}
+
+static cairo_status_t _ghwp_export_write (void                *closure,
+                                          const unsigned char *buf,
+                                          unsigned int         length)
+{
+    ExportData *data = closure;
+
+    if (data->error)
+        return CAIRO_STATUS_WRITE_ERROR;
+
+    if (!g_output_stream_write_all (data->output, buf, length, NULL,
+                                    data->cancellable, &data->error))
+        return CAIRO_STATUS_WRITE_ERROR;
+
+    return CAIRO_STATUS_SUCCESS;
+}
+
+/**
+ * ghwp_document_export_pdf:
+ * @doc: a #GHWPDocument
+ * @output: a #GOutputStream to write the PDF to
+ * @n_threads: number of rendering threads, or 0 for the number of
+ *     processors
+ * @cancellable: (allow-none): a #GCancellable, or %NULL
+ * @error: (allow-none): Return location for an error, or %NULL
+ *
+ * Writes all pages of @doc to @output as PDF.  Pages are rendered in
+ * parallel into recording surfaces, as ghwp_page_render() does, and replayed
+ * in order into a single PDF surface, which writes to @output as it
+ * goes.  At most two pages per thread are held at once, so memory use
+ * does not grow with the number of pages.  @output is not closed.
+ *
+ * Return value: %TRUE on success
+ */
+gboolean ghwp_document_export_pdf (GHWPDocument  *doc,
+                                   GOutputStream *output,
+                                   guint          n_threads,
+                                   GCancellable  *cancellable,
+                                   GError       **error)
+{
+    g_return_val_if_fail (GHWP_IS_DOCUMENT (doc), FALSE);
+    g_return_val_if_fail (G_IS_OUTPUT_STREAM (output), FALSE);
+
+    ExportData       data;
+    GThread        **threads;
+    cairo_surface_t *pdf;
+    cairo_status_t   status;
+    guint            i;
+
+    if (n_threads == 0)
+        n_threads = g_get_num_processors ();
+
+    data.doc         = doc;
+    data.n_pages     = ghwp_document_get_n_pages (doc);
+    data.window      = n_threads * 2;
+    data.slots       = g_new0 (cairo_surface_t *, data.window);
+    data.next        = 0;
+    data.emitted     = 0;
+    data.aborted     = FALSE;
+    data.output      = output;
+    data.cancellable = cancellable;
+    data.error       = NULL;
+    g_mutex_init (&data.lock);
+    g_cond_init (&data.cond);
+
+    /* 크기는 페이지마다 cairo_pdf_surface_set_size 로 정한다 */
+    pdf = cairo_pdf_surface_create_for_stream (_ghwp_export_write, &data,
+                                               595.0, 842.0);
+
+    threads = g_new (GThread *, n_threads);
+    for (i = 0; i < n_threads; i++)
+        threads[i] = g_thread_new ("ghwp-export", _ghwp_export_worker, &data);
+
+    for (i = 0; i < data.n_pages; i++) {
+        cairo_surface_t   *surface;
+        cairo_rectangle_t  extents;
+        cairo_t           *cr;
+
+        if (data.error == NULL)
+            g_cancellable_set_error_if_cancelled (cancellable, &data.error);
+        if (data.error)
+            break;
+
+        g_mutex_lock (&data.lock);
+        while (data.slots[i % data.window] == NULL)
+            g_cond_wait (&data.cond, &data.lock);
+        surface = data.slots[i % data.window];
+        data.slots[i % data.window] = NULL;
+        data.emitted = i + 1;
+        g_cond_broadcast (&data.cond);
+        g_mutex_unlock (&data.lock);
+
+        cairo_recording_surface_get_extents (surface, &extents);
+        cairo_pdf_surface_set_size (pdf, extents.width, extents.height);
+
+        cr = cairo_create (pdf);
+        cairo_set_source_surface (cr, surface, 0.0, 0.0);
+        cairo_paint (cr);
+        cairo_show_page (cr);
+        cairo_destroy (cr);
+        cairo_surface_destroy (surface);
+    }
+
+    g_mutex_lock (&data.lock);
+    data.aborted = TRUE;
+    g_cond_broadcast (&data.cond);
+    g_mutex_unlock (&data.lock);
+
+    for (i = 0; i < n_threads; i++)
+        g_thread_join (threads[i]);
+    g_free (threads);
+
+    /* 멈춘 경우 그려 놓고 내보내지 않은 페이지 */
+    for (i = 0; i < data.window; i++)
+        if (data.slots[i])
+            cairo_surface_destroy (data.slots[i]);
+    g_free (data.slots);
+
+    cairo_surface_finish (pdf);
+    status = cairo_surface_status (pdf);
+    cairo_surface_destroy (pdf);
+
+    g_mutex_clear (&data.lock);
+    g_cond_clear (&data.cond);
+
+    if (data.error) {
+        g_propagate_error (error, data.error);
+        return FALSE;
+    }
+
+    if (status != CAIRO_STATUS_SUCCESS) {
+        g_set_error (error, GHWP_ERROR, GHWP_ERROR_INVALID,
+                     "cannot write PDF: %s", cairo_status_to_string (status));
+        return FALSE;
+    }
+
+    return TRUE;
+}
@@ -0,0 +1,515 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4; tab-width: 4 -*- */
+/*
+ * ghwp-extract.c
+ *
+ * Copyright (C) 2013 Hodong Kim <cogniti@gmail.com>
+ *
+ * This library is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * 많은 hwp 파일에서 글자를 뽑아낸다.
+ *
+ * 작업 스레드마다 파일 큐를 두고 자기 큐의 앞에서 꺼내다가, 비면 다른
+ * 스레드 큐의 뒤에서 훔쳐 온다. HWP v5 파일은 레코드를 읽으면서 바로
+ * 글자를 내보내므로 문서 모델을 만들지 않는다.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <glib/gstdio.h>
+
+#include "config.h"
+#include "ghwp.h"
+#include "ghwp-file-v5.h"
+
+typedef struct
+{
+    gchar *path;
+    gchar *rel; /* 출력 파일 이름에 쓰는 상대 경로 */
+} Job;
+
+typedef struct
+{
+    GMutex   lock;
+    GQueue   jobs;
+    guint    id;
+    GThread *thread;
+    /* 통계, 스레드가 끝난 뒤에 합친다 */
+    guint    n_files;
+    guint    n_failed;
+    guint64  n_bytes;
+} Worker;
+
+typedef struct
+{
+    GString *json; /* 이스케이프한 글자, 문서 끝에 한 줄로 쓴다 */
+    FILE    *fp;   /* 파일마다 출력 */
+} Output;
+
+static gchar   **file_lists = NULL;
+static gchar    *output_dir = NULL;
+static gint      n_jobs     = 0;
+static gboolean  ndjson     = FALSE;
+static gboolean  quiet      = FALSE;
+static gchar   **inputs     = NULL;
+
+static GOptionEntry entries[] =
+{
+    { "file-list", 'l', 0, G_OPTION_ARG_FILENAME_ARRAY, &file_lists,
+      "Read input paths from FILE, one per line (\"-\" for stdin)", "FILE" },
+    { "output-dir", 'o', 0, G_OPTION_ARG_FILENAME, &output_dir,
+      "Write the text of each input to DIR/<name>.txt", "DIR" },
+    { "ndjson", 0, 0, G_OPTION_ARG_NONE, &ndjson,
+      "Write one JSON object per input to stdout (default without -o)", NULL },
+    { "jobs", 'j', 0, G_OPTION_ARG_INT, &n_jobs,
+      "Number of worker threads (default: number of processors)", "N" },
+    { "quiet", 'q', 0, G_OPTION_ARG_NONE, &quiet,
+      "Do not print errors and the summary", NULL },
+    { G_OPTION_REMAINING, 0, 0, G_OPTION_ARG_FILENAME_ARRAY, &inputs,
+      NULL, "FILE|DIR..." },
+    { NULL }
+};
+
+static Worker     *workers;
+static guint       n_workers;
+static GMutex      stdout_lock;
+static GHashTable *rels; /* 이미 쓴 출력 이름 */
+
+static void _job_free (Job *job)
+{
+    g_free (job->path);
+    g_free (job->rel);
+    g_slice_free (Job, job);
+}
+
+/* 처음에는 돌아가며 나누어 준다. a/x.hwp 와 b/x.hwp 처럼 출력 이름이
+ * 겹치면 뒤의 것에 x.hwp.2 처럼 번호를 붙인다. */
+static void _add_job (const gchar *path, const gchar *rel)
+{
+    static guint next = 0;
+    Job   *job = g_slice_new (Job);
+    gchar *unique = g_strdup (rel);
+    guint  n;
+
+    for (n = 2; g_hash_table_contains (rels, unique); n++) {
+        g_free (unique);
+        unique = g_strdup_printf ("%s.%u", rel, n);
+    }
+    g_hash_table_add (rels, unique);
+
+    job->path = g_strdup (path);
+    job->rel  = g_strdup (unique);
+    g_queue_push_tail (&workers[next++ % n_workers].jobs, job);
+}
+
+static gboolean _is_hwp_name (const gchar *name)
+{
+    const gchar *dot = strrchr (name, '.');
+
+    return dot && (g_ascii_strcasecmp (dot, ".hwp")   == 0 ||
+                   g_ascii_strcasecmp (dot, ".hml")   == 0 ||
+                   g_ascii_strcasecmp (dot, ".hwpml") == 0);
+}
+
+static void _add_dir (const gchar *root, const gchar *rel)
+{
+    gchar       *path = rel ? g_build_filename (root, rel, NULL)
+                            : g_strdup (root);
+    GDir        *dir  = g_dir_open (path, 0, NULL);
+    const gchar *name;
+
+    if (dir == NULL) {
+        g_free (path);
+        return;
+    }
+
+    while ((name = g_dir_read_name (dir))) {
+        gchar *child     = g_build_filename (path, name, NULL);
+        gchar *child_rel = rel ? g_build_filename (rel, name, NULL)
+                               : g_strdup (name);
+
+        if (g_file_test (child, G_FILE_TEST_IS_DIR)) {
+            /* 디렉터리를 가리키는 심볼릭 링크는 고리를 만들 수 있으므로
+             * 따라가지 않는다 */
+            if (!g_file_test (child, G_FILE_TEST_IS_SYMLINK))
+                _add_dir (root, child_rel);
+        }
+        else if (_is_hwp_name (name))
+            _add_job (child, child_rel);
+
+        g_free (child);
+        g_free (child_rel);
+    }
+
+    g_dir_close (dir);
+    g_free (path);
+}
+
+static void _add_input (const gchar *path)
+{
+    if (g_file_test (path, G_FILE_TEST_IS_DIR)) {
+        _add_dir (path, NULL);
+    } else {
+        gchar *rel = g_path_get_basename (path);
+        _add_job (path, rel);
+        g_free (rel);
+    }
+}
+
+static gboolean _add_file_list (const gchar *list, GError **error)
+{
+    GIOChannel *channel;
+    gchar      *line;
+    gsize       term;
+    GIOStatus   status;
+
+    if (g_str_equal (list, "-"))
+        channel = g_io_channel_unix_new (0);
+    else
+        channel = g_io_channel_new_file (list, "r", error);
+
+    if (channel == NULL)
+        return FALSE;
+
+    /* 경로는 바이트 그대로 다룬다 */
+    g_io_channel_set_encoding (channel, NULL, NULL);
+
+    while ((status = g_io_channel_read_line (channel, &line, NULL, &term,
+                                             error)) == G_IO_STATUS_NORMAL) {
+        line[term] = '\0';
+        if (*line)
+            _add_input (line);
+        g_free (line);
+    }
+
+    g_io_channel_unref (channel);
+
+    return status != G_IO_STATUS_ERROR;
+}
+
+static void _json_append_escaped (GString     *json,
+                                  const gchar *str,
+                                  gsize        len)
+{
+    const gchar *p;
+
+    for (p = str; p < str + len; p++) {
+        switch (*p) {
+        case '"':
+            g_string_append (json, "\\\"");
+            break;
+        case '\\':
+            g_string_append (json, "\\\\");
+            break;
+        case '\n':
+            g_string_append (json, "\\n");
+            break;
+        case '\r':
+            g_string_append (json, "\\r");
+            break;
+        case '\t':
+            g_string_append (json, "\\t");
+            break;
+        default:
+            if ((guchar) *p < 0x20)
+                g_string_append_printf (json, "\\u%04x", (guchar) *p);
+            else
+                g_string_append_c (json, *p);
+            break;
+        }
+    }
+}
+
+static void _json_append_string (GString *json, const gchar *str)
+{
+    g_string_append_c (json, '"');
+    _json_append_escaped (json, str, strlen (str));
+    g_string_append_c (json, '"');
+}
+
+static gboolean _write_paragraph (guint        section,
+                                  guint        paragraph,
+                                  const gchar *text,
+                                  gpointer     user_data)
+{
+    Output *output = user_data;
+
+    if (output->fp) {
+        fputs (text, output->fp);
+        fputc ('\n', output->fp);
+    }
+
+    if (output->json) {
+        _json_append_escaped (output->json, text, strlen (text));
+        g_string_append (output->json, "\\n");
+    }
+
+    return TRUE;
+}
+
+/* HWP v3, HWPML 은 레코드 단위로 읽는 방법이 없으므로 문서를 만든다.
+ * 글자는 text store 에 문단마다 '\n' 으로 끝나 있으므로 한 번에 쓴다. */
+static gboolean _extract_from_document (GHWPFile *file,
+                                        Output   *output,
+                                        GError  **error)
+{
+    GHWPDocument  *doc;
+    GHWPTextStore *store;
+    const gchar   *data;
+    gsize          size;
+
+    /* 문서가 file 의 참조를 가져가므로 호출한 쪽의 참조와 따로 잡는다 */
+    doc = ghwp_file_get_document (g_object_ref (file), error);
+    if (doc == NULL) {
+        g_object_unref (file);
+        return FALSE;
+    }
+
+    /* 읽다가 실패해도 문서는 돌려주므로 error 를 본다 */
+    if (error && *error) {
+        g_object_unref (doc);
+        return FALSE;
+    }
+
+    store = ghwp_document_get_text_store (doc);
+    data  = ghwp_text_store_get_data (store, &size);
+
+    if (output->fp)
+        fwrite (data, 1, size, output->fp);
+
+    if (output->json)
+        _json_append_escaped (output->json, data, size);
+
+    ghwp_text_store_unref (store);
+    g_object_unref (doc);
+    return TRUE;
+}
+
+static FILE *_open_output (const gchar *rel, GError **error)
+{
+    gchar *name = g_strconcat (rel, ".txt", NULL);
+    gchar *path = g_build_filename (output_dir, name, NULL);
+    gchar *dir  = g_path_get_dirname (path);
+    FILE  *fp;
+
+    g_mkdir_with_parents (dir, 0755);
+    fp = g_fopen (path, "w");
+    if (fp == NULL)
+        g_set_error (error, G_FILE_ERROR, g_file_error_from_errno (errno),
+                     "cannot open %s: %s", path, g_strerror (errno));
+
+    g_free (dir);
+    g_free (path);
+    g_free (name);
+
+    return fp;
+}
+
+static void _extract (Worker *worker, Job *job)
+{
+    Output    output = { NULL, NULL };
+    GError   *error  = NULL;
+    GHWPFile *file;
+    GStatBuf  st;
+    gboolean  ok = FALSE;
+
+    if (g_stat (job->path, &st) == 0)
+        worker->n_bytes += st.st_size;
+
+    if (ndjson)
+        output.json = g_string_new (NULL);
+
+    if (output_dir)
+        output.fp = _open_output (job->rel, &error);
+
+    if (output_dir == NULL || output.fp) {
+        file = ghwp_file_new_from_filename (job->path, &error);
+        if (file && GHWP_IS_FILE_V5 (file))
+            ok = ghwp_file_v5_foreach_paragraph_text (GHWP_FILE_V5 (file),
+                                                      _write_paragraph,
+                                                      &output, NULL, &error);
+        else if (file)
+            ok = _extract_from_document (file, &output, &error);
+        if (file)
+            g_object_unref (file);
+    }
+
+    if (output.fp)
+        fclose (output.fp);
+
+    worker->n_files++;
+    if (!ok) {
+        worker->n_failed++;
+        if (!quiet && !ndjson)
+            g_printerr ("ghwp-extract: %s: %s\n", job->path,
+                        error ? error->message : "unknown error");
+    }
+
+    if (output.json) {
+        GString *line = g_string_new ("{\"path\":");
+        gchar   *path = g_filename_display_name (job->path);
+
+        _json_append_string (line, path);
+        if (ok) {
+            g_string_append (line, ",\"text\":\"");
+            g_string_append_len (line, output.json->str, output.json->len);
+            g_string_append (line, "\"}\n");
+        } else {
+            g_string_append (line, ",\"error\":");
+            _json_append_string (line, error ? error->message
+                                             : "unknown error");
+            g_string_append (line, "}\n");
+        }
+
+        g_mutex_lock (&stdout_lock);
+        fwrite (line->str, 1, line->len, stdout);
+        g_mutex_unlock (&stdout_lock);
+
+        g_string_free (line, TRUE);
+        g_string_free (output.json, TRUE);
+        g_free (path);
+    }
+
+    g_clear_error (&error);
+}
+
+/* 다른 스레드 큐의 뒤에서 하나 훔쳐 온다 */
+static Job *_steal (Worker *self)
+{
+    guint k;
+
+    for (k = 1; k < n_workers; k++) {
+        Worker *victim = &workers[(self->id + k) % n_workers];
+        Job    *job;
+
+        g_mutex_lock (&victim->lock);
+        job = g_queue_pop_tail (&victim->jobs);
+        g_mutex_unlock (&victim->lock);
+
+        if (job)
+            return job;
+    }
+
+    return NULL;
+}
+
+static gpointer _worker_main (gpointer data)
+{
+    Worker *self = data;
+    Job    *job;
+
+    /* 시작한 뒤로는 작업이 늘지 않으므로 모든 큐가 비면 끝난다 */
+    for (;;) {
+        g_mutex_lock (&self->lock);
+        job = g_queue_pop_head (&self->jobs);
+        g_mutex_unlock (&self->lock);
+
+        if (job == NULL)
+            job = _steal (self);
+        if (job == NULL)
+            break;
+
+        _extract (self, job);
+        _job_free (job);
+    }
+
+    return NULL;
+}
+
+int main (int argc, char **argv)
+{
+    GOptionContext *context;
+    GError         *error    = NULL;
+    guint           n_files  = 0;
+    guint           n_failed = 0;
+    guint64         n_bytes  = 0;
+    gint64          start;
+    gdouble         elapsed;
+    guint           i;
+
+    context = g_option_context_new ("- extract text from hwp files");
+    g_option_context_add_main_entries (context, entries, NULL);
+    if (!g_option_context_parse (context, &argc, &argv, &error)) {
+        g_printerr ("ghwp-extract: %s\n", error->message);
+        g_error_free (error);
+        g_option_context_free (context);
+        return 2;
+    }
+    g_option_context_free (context);
+
+    if (inputs == NULL && file_lists == NULL) {
+        g_printerr ("ghwp-extract: no input files\n");
+        return 2;
+    }
+
+    if (output_dir == NULL)
+        ndjson = TRUE;
+
+    n_workers = n_jobs > 0 ? (guint) n_jobs : g_get_num_processors ();
+    workers   = g_new0 (Worker, n_workers);
+    for (i = 0; i < n_workers; i++) {
+        g_mutex_init (&workers[i].lock);
+        g_queue_init (&workers[i].jobs);
+        workers[i].id = i;
+    }
+
+    rels = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+    for (i = 0; inputs && inputs[i]; i++)
+        _add_input (inputs[i]);
+
+    for (i = 0; file_lists && file_lists[i]; i++) {
+        if (!_add_file_list (file_lists[i], &error)) {
+            g_printerr ("ghwp-extract: %s: %s\n", file_lists[i],
+                        error ? error->message : "cannot read");
+            g_clear_error (&error);
+            return 2;
+        }
+    }
+
+    g_hash_table_unref (rels);
+
+    start = g_get_monotonic_time ();
+
+    for (i = 0; i < n_workers; i++)
+        workers[i].thread = g_thread_new ("ghwp-extract", _worker_main,
+                                          &workers[i]);
+
+    for (i = 0; i < n_workers; i++) {
+        g_thread_join (workers[i].thread);
+        n_files  += workers[i].n_files;
+        n_failed += workers[i].n_failed;
+        n_bytes  += workers[i].n_bytes;
+        g_mutex_clear (&workers[i].lock);
+    }
+
+    elapsed = (g_get_monotonic_time () - start) / (gdouble) G_USEC_PER_SEC;
+    if (elapsed <= 0.0)
+        elapsed = 1e-6;
+
+    if (!quiet)
+        g_printerr ("ghwp-extract: %u files (%u failed), %.1f MB "
+                    "in %.2f s: %.1f files/s, %.1f MB/s\n",
+                    n_files, n_failed, n_bytes / 1e6, elapsed,
+                    n_files / elapsed, n_bytes / 1e6 / elapsed);
+
+    g_free (workers);
+    g_strfreev (inputs);
+    g_strfreev (file_lists);
+    g_free (output_dir);
+
+    return n_failed ? 1 : 0;
+}
@@ -20,6 +20,7 @@
 
 #include <libxml/xmlreader.h>
 #include <string.h>
+#include <gsf/gsf-input-memory.h>
 #include "ghwp-file-ml.h"
 #include <math.h>
 
@@ -59,6 +60,26 @@ GHWPFileML *ghwp_file_ml_new_from_filename (const gchar *filename,
     return file;
 }
 
+/**
+ * ghwp_file_ml_new_from_gsf_input:
+ * @input: a #GsfInput holding an HWPML document
+ * @error: (allow-none): Return location for an error, or %NULL
+ *
+ * Creates a new #GHWPFileML reading from @input, which is referenced by
+ * the returned file.
+ *
+ * Return value: A newly created #GHWPFileML, or %NULL
+ **/
+GHWPFileML *ghwp_file_ml_new_from_gsf_input (GsfInput *input, GError **error)
+{
+    g_return_val_if_fail (GSF_IS_INPUT (input), NULL);
+
+    GHWPFileML *file  = g_object_new (GHWP_TYPE_FILE_ML, NULL);
+    file->priv->input = g_object_ref (input);
+
+    return file;
+}
+
 gchar *ghwp_file_ml_get_hwp_version_string (GHWPFile *file)
 {
     return NULL;
@@ -80,12 +101,11 @@ enum HWPParseStateFlags {
     HWP_PARSE_CHAR   = 1 << 2
 };
 
-static int   hwp_parse_state = HWP_PARSE_NORMAL;
-static guint tag_p_count = 0;
-
 static void _ghwp_file_ml_parse_node(GHWPDocument    *doc,
                                      xmlTextReaderPtr reader)
 {
+    /* 여러 문서를 동시에 읽을 수 있도록 상태는 file 에 둔다 */
+    GHWPFileMLPrivate *priv = GHWP_FILE_ML (doc->file)->priv;
     xmlChar *name, *value;
     int node_type = 0;
 
@@ -103,21 +123,21 @@ static void _ghwp_file_ml_parse_node(GHWPDocument    *doc,
         case XML_READER_TYPE_ELEMENT:
             /* paragraph */
             if (g_utf8_collate (tag_name, tag_p) == 0) {
-                hwp_parse_state |= HWP_PARSE_P;
-                tag_p_count++;
-                if (tag_p_count > 1) {
+                priv->parse_state |= HWP_PARSE_P;
+                priv->tag_p_count++;
+                if (priv->tag_p_count > 1) {
                     GHWPParagraph *paragraph = ghwp_paragraph_new ();
                     GHWPText *ghwp_text = ghwp_text_new ("");
                     ghwp_paragraph_set_ghwp_text (paragraph, ghwp_text);
-                    g_array_append_val (doc->paragraphs, paragraph);
+                    _ghwp_document_add_paragraph (doc, paragraph);
                 }
             /* char */
             } else if (g_utf8_collate (tag_name, tag_char) == 0) {
-                hwp_parse_state |= HWP_PARSE_CHAR;
+                priv->parse_state |= HWP_PARSE_CHAR;
             }
             break;
         case XML_READER_TYPE_TEXT:
-            if ((hwp_parse_state & HWP_PARSE_CHAR) == HWP_PARSE_CHAR) {
+            if ((priv->parse_state & HWP_PARSE_CHAR) == HWP_PARSE_CHAR) {
                 GHWPParagraph *paragraph = g_array_index (doc->paragraphs,
                                                           GHWPParagraph *,
                                                           doc->paragraphs->len - 1);
@@ -125,27 +145,24 @@ static void _ghwp_file_ml_parse_node(GHWPDocument    *doc,
             }
             break;
         case XML_READER_TYPE_END_ELEMENT:
-            if ((g_utf8_collate (tag_name, tag_p) == 0) && (tag_p_count > 1)) {
+            if ((g_utf8_collate (tag_name, tag_p) == 0) && (priv->tag_p_count > 1)) {
                 GHWPParagraph *paragraph = g_array_index (doc->paragraphs,
                                                           GHWPParagraph *,
                                                           doc->paragraphs->len - 1);
 
                 /* 높이 계산 */
-                static gdouble y   = 0.0;
-                static guint   len = 0;
-                len = g_utf8_strlen (paragraph->ghwp_text->text, -1);
-                y += 18.0 * ceil (len / 33.0);
-
-                if (y > 842.0 - 80.0) {
-                    g_array_append_val (doc->pages, GHWP_FILE_ML (doc->file)->page);
-                    GHWP_FILE_ML (doc->file)->page = ghwp_page_new ();
-                    g_array_append_val (GHWP_FILE_ML (doc->file)->page->paragraphs, paragraph);
-                    y = 0.0;
-                } else {
-                    g_array_append_val (GHWP_FILE_ML (doc->file)->page->paragraphs, paragraph);
+                guint len = g_utf8_strlen (paragraph->ghwp_text->text, -1);
+                priv->y += 18.0 * ceil (len / 33.0);
+
+                if (priv->y > 842.0 - 80.0) {
+                    _ghwp_document_add_page_range (doc, &priv->page);
+                    memset (&priv->page, 0, sizeof (GHWPPageRange));
+                    priv->y = 0.0;
                 } /* if */
+                _ghwp_page_range_add_paragraph (&priv->page,
+                                                doc->paragraphs->len - 1);
             } else if (g_utf8_collate (tag_name, tag_char) == 0) {
-                hwp_parse_state &= ~HWP_PARSE_CHAR;
+                priv->parse_state &= ~HWP_PARSE_CHAR;
             }
             break;
         default:
@@ -165,28 +182,60 @@ static void _ghwp_file_ml_parse (GHWPDocument *doc, GError **error)
 {
     g_return_if_fail (doc != NULL);
 
-    gchar *uri = GHWP_FILE_ML (doc->file)->priv->uri;
-    
+    GHWPFileML *file = GHWP_FILE_ML (doc->file);
+    const gchar *uri = file->priv->uri;
+
     xmlTextReaderPtr reader;
     int              ret;
 
-    reader = xmlNewTextReaderFilename (uri);
+    if (file->priv->input) {
+        /* 메모리(또는 이미 열린 파일)에서 바로 읽는다 */
+        GsfInput     *input = file->priv->input;
+        gsf_off_t     size  = gsf_input_size (input);
+        const guint8 *data;
+
+        uri = gsf_input_name (input) ? gsf_input_name (input) : "(memory)";
+        gsf_input_seek (input, 0, G_SEEK_SET);
+        data = gsf_input_read (input, (size_t) size, NULL);
+        reader = data ? xmlReaderForMemory ((const char *) data, (int) size,
+                                            NULL, NULL, 0)
+                      : NULL;
+    } else {
+        reader = xmlNewTextReaderFilename (uri);
+    }
 
     if (reader != NULL) {
+        GCancellable *cancellable = doc->file->priv->cancellable;
+
+        _ghwp_file_report_progress (doc, 0, 1, 0, 0);
+
         while ((ret = xmlTextReaderRead(reader)) == 1) {
+            if (g_cancellable_set_error_if_cancelled (cancellable, error))
+                break;
             _ghwp_file_ml_parse_node (doc, reader);
         }
         /* 마지막 페이지 더하기 */
-        g_array_append_val (doc->pages, GHWP_FILE_ML (doc->file)->page);
+        _ghwp_document_add_page_range (doc,
+                                       &GHWP_FILE_ML (doc->file)->priv->page);
         xmlFreeTextReader(reader);
-        if (ret != 0) {
+        if (ret < 0) {
             g_warning ("%s : failed to parse\n", uri);
         }
+        if (ret == 0)
+            _ghwp_file_report_progress (doc, 1, 1, 0, 0);
     } else {
         g_warning ("Unable to open %s\n", uri);
     }
 }
 
+static void ghwp_file_ml_load_document (GHWPFile     *file,
+                                        GHWPDocument *doc,
+                                        GError      **error)
+{
+    g_return_if_fail (GHWP_IS_FILE_ML (file));
+    _ghwp_file_ml_parse (doc, error);
+}
+
 GHWPDocument *ghwp_file_ml_get_document (GHWPFile *file, GError **error)
 {
     g_return_val_if_fail (GHWP_IS_FILE_ML (file), NULL);
@@ -200,13 +249,24 @@ static void ghwp_file_ml_init (GHWPFileML *file)
 {
     file->priv = G_TYPE_INSTANCE_GET_PRIVATE (file, GHWP_TYPE_FILE_ML,
                                                     GHWPFileMLPrivate);
-    file->page = ghwp_page_new ();
+}
+
+static gsize ghwp_file_ml_get_memory_usage (GHWPFile *file)
+{
+    GsfInput *input = GHWP_FILE_ML (file)->priv->input;
+
+    if (input && GSF_IS_INPUT_MEMORY (input))
+        return (gsize) gsf_input_size (input);
+
+    return 0;
 }
 
 static void ghwp_file_ml_finalize (GObject *object)
 {
     GHWPFileML *file = GHWP_FILE_ML(object);
     g_free (file->priv->uri);
+    if (file->priv->input)
+        g_object_unref (file->priv->input);
     G_OBJECT_CLASS (ghwp_file_ml_parent_class)->finalize (object);
 }
 
@@ -216,8 +276,10 @@ static void ghwp_file_ml_class_init (GHWPFileMLClass *klass)
     g_type_class_add_private (klass, sizeof (GHWPFileMLPrivate));
     GHWPFileClass *hwp_file_class = GHWP_FILE_CLASS (klass);
     hwp_file_class->get_document  = ghwp_file_ml_get_document;
+    hwp_file_class->load_document = ghwp_file_ml_load_document;
     hwp_file_class->get_hwp_version_string = ghwp_file_ml_get_hwp_version_string;
     hwp_file_class->get_hwp_version = ghwp_file_ml_get_hwp_version;
+    hwp_file_class->get_memory_usage = ghwp_file_ml_get_memory_usage;
 
     object_class->finalize = ghwp_file_ml_finalize;
 }
@@ -22,6 +22,7 @@
 #define _GHWP_FILE_ML_H_
 
 #include <glib-object.h>
+#include <gsf/gsf-input.h>
 #include "ghwp.h"
 
 G_BEGIN_DECLS
@@ -45,12 +46,17 @@ struct _GHWPFileML
 {
     GHWPFile           parent_instance;
     GHWPFileMLPrivate *priv;
-    GHWPPage          *page;
 };
 
 struct _GHWPFileMLPrivate
 {
-    gchar *uri;
+    gchar    *uri;
+    GsfInput *input;
+    /* parser state */
+    int       parse_state;
+    guint     tag_p_count;
+    gdouble   y;
+    GHWPPageRange page; /* 채우고 있는 페이지 */
 };
 
 GType         ghwp_file_ml_get_type               (void) G_GNUC_CONST;
@@ -58,6 +64,8 @@ GHWPFileML   *ghwp_file_ml_new_from_uri           (const gchar *uri,
                                                    GError     **error);
 GHWPFileML   *ghwp_file_ml_new_from_filename      (const gchar *filename,
                                                    GError     **error);
+GHWPFileML   *ghwp_file_ml_new_from_gsf_input     (GsfInput    *input,
+                                                   GError     **error);
 gchar        *ghwp_file_ml_get_hwp_version_string (GHWPFile    *file);
 void          ghwp_file_ml_get_hwp_version        (GHWPFile    *file,
                                                    guint8      *major_version,
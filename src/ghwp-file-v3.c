@@ -27,8 +27,10 @@
 
 #include "ghwp-file-v3.h"
 #include "ghwp-context-v3.h"
+#include "gsf-input-stream.h"
 #include "hnc2unicode.h"
 #include <math.h>
+#include <string.h>
 
 G_DEFINE_TYPE (GHWPFileV3, ghwp_file_v3, GHWP_TYPE_FILE);
 
@@ -60,11 +62,34 @@ GHWPFileV3 *ghwp_file_v3_new_from_filename (const gchar *filename,
     GFile *file = g_file_new_for_path (filename);
     GFileInputStream *fis = g_file_read (file, NULL, error);
     g_object_unref(file);
+
+    if (fis == NULL)
+        return NULL;
+
     GHWPFileV3 *hwpv3file = g_object_new (GHWP_TYPE_FILE_V3, NULL);
     hwpv3file->priv->stream = G_INPUT_STREAM (fis);
     return hwpv3file;
 }
 
+/**
+ * ghwp_file_v3_new_from_gsf_input:
+ * @input: a #GsfInput positioned at the start of an HWP v3 document
+ * @error: (allow-none): Return location for an error, or %NULL
+ *
+ * Creates a new #GHWPFileV3 reading from @input, which is referenced by
+ * the returned file.
+ *
+ * Return value: A newly created #GHWPFileV3, or %NULL
+ **/
+GHWPFileV3 *ghwp_file_v3_new_from_gsf_input (GsfInput *input, GError **error)
+{
+    g_return_val_if_fail (GSF_IS_INPUT (input), NULL);
+
+    GHWPFileV3 *hwpv3file = g_object_new (GHWP_TYPE_FILE_V3, NULL);
+    hwpv3file->priv->stream = G_INPUT_STREAM (gsf_input_stream_new (input));
+    return hwpv3file;
+}
+
 gchar *ghwp_file_v3_get_hwp_version_string (GHWPFile *file)
 {
     g_return_val_if_fail (GHWP_IS_FILE_V3 (file), NULL);
@@ -86,11 +111,20 @@ void ghwp_file_v3_get_hwp_version (GHWPFile *file,
     if (extra_version) *extra_version = GHWP_FILE_V3 (file)->rev;
 }
 
+/* 문서를 읽는 동안 설정된 GCancellable 을 context 에 넘긴다 */
+static GHWPContextV3 *_ghwp_file_v3_context_new (GHWPDocument *doc)
+{
+    GHWPFileV3    *file    = GHWP_FILE_V3 (doc->file);
+    GHWPContextV3 *context = ghwp_context_v3_new (file->priv->stream);
+    ghwp_context_v3_set_cancellable (context,
+                                     GHWP_FILE (file)->priv->cancellable);
+    return context;
+}
+
 static void _ghwp_file_v3_parse_signature (GHWPDocument *doc)
 {
     g_return_if_fail (doc != NULL);
-    GInputStream *stream = GHWP_FILE_V3 (doc->file)->priv->stream;
-    GHWPContextV3 *context = ghwp_context_v3_new (stream);
+    GHWPContextV3 *context = _ghwp_file_v3_context_new (doc);
     gchar *signature = g_malloc(30);
     ghwp_context_v3_read (context, signature, 30);
     g_free (signature);
@@ -103,8 +137,7 @@ static void _ghwp_file_v3_parse_doc_info (GHWPDocument *doc)
     GHWPFileV3 *file = GHWP_FILE_V3 (doc->file);
     /* 문서 정보 128 bytes */
     /* 암호 여부 */
-    GInputStream *stream = file->priv->stream;
-    GHWPContextV3 *context = ghwp_context_v3_new (stream);
+    GHWPContextV3 *context = _ghwp_file_v3_context_new (doc);
 
     ghwp_context_v3_skip (context, 96);
     ghwp_context_v3_read_uint16 (context, &(file->is_crypt));
@@ -122,8 +155,7 @@ static void _ghwp_file_v3_parse_doc_info (GHWPDocument *doc)
 static void _ghwp_file_v3_parse_summary_info (GHWPDocument *doc)
 {
     g_return_if_fail (doc != NULL);
-    GInputStream *stream = GHWP_FILE_V3 (doc->file)->priv->stream;
-    GHWPContextV3 *context = ghwp_context_v3_new (stream);
+    GHWPContextV3 *context = _ghwp_file_v3_context_new (doc);
 
     gchar   *str;
     GString *string;
@@ -171,7 +203,8 @@ static void _ghwp_file_v3_parse_info_block (GHWPDocument *doc)
 {
     g_return_if_fail (doc != NULL);
     GInputStream *stream = GHWP_FILE_V3 (doc->file)->priv->stream;
-    g_input_stream_skip (stream, GHWP_FILE_V3 (doc->file)->info_block_len, NULL, NULL);
+    g_input_stream_skip (stream, GHWP_FILE_V3 (doc->file)->info_block_len,
+                         doc->file->priv->cancellable, NULL);
 
     if (GHWP_FILE_V3 (doc->file)->is_compress) {
         GZlibDecompressor *zd;
@@ -180,9 +213,8 @@ static void _ghwp_file_v3_parse_info_block (GHWPDocument *doc)
         zd  = g_zlib_decompressor_new (G_ZLIB_COMPRESSOR_FORMAT_RAW);
         cis = g_converter_input_stream_new ((GInputStream*) stream,
                                             (GConverter*) zd);
+        /* 기존의 스트림은 cis 가 참조한다 */
         g_object_unref (GHWP_FILE_V3 (doc->file)->priv->stream);
-        g_object_ref (cis);
-        /* NOTE 기존의 스트림은 어떻게 ? */
         GHWP_FILE_V3 (doc->file)->priv->stream = G_INPUT_STREAM (cis);
 
         g_object_unref (zd);
@@ -198,9 +230,11 @@ static void _ghwp_file_v3_parse_font_names (GHWPDocument *doc)
     gsize bytes_read;
     GInputStream *stream = GHWP_FILE_V3 (doc->file)->priv->stream;
     for (i = 0; i < 7; i++) {
-        g_input_stream_read_all (stream, &n_fonts, 2, &bytes_read, NULL, NULL);
+        g_input_stream_read_all (stream, &n_fonts, 2, &bytes_read,
+                                 doc->file->priv->cancellable, NULL);
         buffer = g_malloc (40 * n_fonts);
-        g_input_stream_read_all (stream, buffer, 40 * n_fonts, &bytes_read, NULL, NULL);
+        g_input_stream_read_all (stream, buffer, 40 * n_fonts, &bytes_read,
+                                 doc->file->priv->cancellable, NULL);
         g_free (buffer);
     }
 }
@@ -212,9 +246,11 @@ static void _ghwp_file_v3_parse_styles (GHWPDocument *doc)
     guint8 *buffer = NULL;
     gsize bytes_read;
     GInputStream *stream = GHWP_FILE_V3 (doc->file)->priv->stream;
-    g_input_stream_read_all (stream, &n_styles, 2, &bytes_read, NULL, NULL);
+    g_input_stream_read_all (stream, &n_styles, 2, &bytes_read,
+                             doc->file->priv->cancellable, NULL);
     buffer = g_malloc (n_styles * (20 + 31 + 187));
-    g_input_stream_read_all (stream, buffer, n_styles * (20 + 31 + 187), &bytes_read, NULL, NULL);
+    g_input_stream_read_all (stream, buffer, n_styles * (20 + 31 + 187),
+                             &bytes_read, doc->file->priv->cancellable, NULL);
     g_free (buffer);
 }
 
@@ -222,8 +258,7 @@ static gboolean _ghwp_file_v3_parse_paragraph (GHWPDocument *doc)
 {
     g_return_val_if_fail (doc != NULL, FALSE);
 
-    GInputStream  *stream  = GHWP_FILE_V3 (doc->file)->priv->stream;
-    GHWPContextV3 *context = ghwp_context_v3_new (stream);
+    GHWPContextV3 *context = _ghwp_file_v3_context_new (doc);
     /* 문단 정보 */
     guint8  prev_paragraph_shape;
     guint16 n_chars;
@@ -263,7 +298,7 @@ static gboolean _ghwp_file_v3_parse_paragraph (GHWPDocument *doc)
     }
 
     GHWPParagraph *paragraph = ghwp_paragraph_new ();
-    g_array_append_val (doc->paragraphs, paragraph);
+    _ghwp_document_add_paragraph (doc, paragraph);
     GString *string = g_string_new (NULL);
     /* 글자들 */
     guint16 n_chars_read = 0;
@@ -368,21 +403,20 @@ static gboolean _ghwp_file_v3_parse_paragraph (GHWPDocument *doc)
     g_free (tmp);
     ghwp_paragraph_set_ghwp_text (paragraph, ghwp_text);
 
-    static gdouble y   = 0.0;
-    static guint   len = 0;
+    GHWPFileV3Private *priv = GHWP_FILE_V3 (doc->file)->priv;
+    guint              len;
 
     /* 높이 계산 */
     len = g_utf8_strlen (ghwp_text->text, -1);
-    y += 18.0 * ceil (len / 33.0);
+    priv->y += 18.0 * ceil (len / 33.0);
 
-    if (y > 842.0 - 80.0) {
-        g_array_append_val (doc->pages, GHWP_FILE_V3 (doc->file)->page);
-        GHWP_FILE_V3 (doc->file)->page = ghwp_page_new ();
-        g_array_append_val (GHWP_FILE_V3 (doc->file)->page->paragraphs, paragraph);
-        y = 0.0;
-    } else {
-        g_array_append_val (GHWP_FILE_V3 (doc->file)->page->paragraphs, paragraph);
-    } /* if */
+    if (priv->y > 842.0 - 80.0) {
+        _ghwp_document_add_page_range (doc, &priv->page);
+        memset (&priv->page, 0, sizeof (GHWPPageRange));
+        priv->y = 0.0;
+    }
+    /* 읽는 스레드만 문단을 더하므로 잠그지 않고 센다 */
+    _ghwp_page_range_add_paragraph (&priv->page, doc->paragraphs->len - 1);
 
     g_object_unref (context);
     return TRUE;
@@ -394,7 +428,7 @@ static void _ghwp_file_v3_parse_paragraphs (GHWPDocument *doc)
     while(_ghwp_file_v3_parse_paragraph(doc)) {
     }
     /* 마지막 페이지 더하기 */
-    g_array_append_val (doc->pages, GHWP_FILE_V3 (doc->file)->page);
+    _ghwp_document_add_page_range (doc, &GHWP_FILE_V3 (doc->file)->priv->page);
 }
 
 static void _ghwp_file_v3_parse_supplementary_info_block1 (GHWPDocument *doc)
@@ -417,9 +451,24 @@ static void _ghwp_file_v3_parse (GHWPDocument *doc, GError **error)
     _ghwp_file_v3_parse_info_block (doc);
     _ghwp_file_v3_parse_font_names (doc);
     _ghwp_file_v3_parse_styles (doc);
+    _ghwp_file_report_progress (doc, 0, 1, 0, 0);
     _ghwp_file_v3_parse_paragraphs (doc);
     _ghwp_file_v3_parse_supplementary_info_block1 (doc);
     _ghwp_file_v3_parse_supplementary_info_block2 (doc);
+
+    if (g_cancellable_set_error_if_cancelled (doc->file->priv->cancellable,
+                                              error))
+        return;
+
+    _ghwp_file_report_progress (doc, 1, 1, 0, 0);
+}
+
+static void ghwp_file_v3_load_document (GHWPFile     *file,
+                                        GHWPDocument *doc,
+                                        GError      **error)
+{
+    g_return_if_fail (GHWP_IS_FILE_V3 (file));
+    _ghwp_file_v3_parse (doc, error);
 }
 
 GHWPDocument *ghwp_file_v3_get_document (GHWPFile *file, GError **error)
@@ -435,7 +484,6 @@ static void ghwp_file_v3_init (GHWPFileV3 *file)
 {
     file->priv = G_TYPE_INSTANCE_GET_PRIVATE (file, GHWP_TYPE_FILE_V3,
                                                     GHWPFileV3Private);
-    file->page = ghwp_page_new ();
 }
 
 static void ghwp_file_v3_finalize (GObject *object)
@@ -451,6 +499,7 @@ static void ghwp_file_v3_class_init (GHWPFileV3Class *klass)
 
     g_type_class_add_private (klass, sizeof (GHWPFileV3Private));
     GHWP_FILE_CLASS (klass)->get_document = ghwp_file_v3_get_document;
+    GHWP_FILE_CLASS (klass)->load_document = ghwp_file_v3_load_document;
     GHWP_FILE_CLASS (klass)->get_hwp_version_string = ghwp_file_v3_get_hwp_version_string;
     GHWP_FILE_CLASS (klass)->get_hwp_version = ghwp_file_v3_get_hwp_version;
     object_class->finalize = ghwp_file_v3_finalize;
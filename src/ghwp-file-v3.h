@@ -29,6 +29,7 @@
 #define _GHWP_FILE_V3_H_
 
 #include <glib-object.h>
+#include <gsf/gsf-input.h>
 
 #include "ghwp.h"
 
@@ -57,12 +58,13 @@ struct _GHWPFileV3
     guint8             is_compress;
     guint8             rev;
     guint16            info_block_len;
-    GHWPPage          *page;
 };
 
 struct _GHWPFileV3Private
 {
     GInputStream *stream;
+    gdouble       y;    /* 페이지 나누기용 현재 높이 */
+    GHWPPageRange page; /* 채우고 있는 페이지 */
 };
 
 GType         ghwp_file_v3_get_type               (void) G_GNUC_CONST;
@@ -70,6 +72,8 @@ GHWPFileV3   *ghwp_file_v3_new_from_uri           (const gchar *uri,
                                                    GError     **error);
 GHWPFileV3   *ghwp_file_v3_new_from_filename      (const gchar *filename,
                                                    GError     **error);
+GHWPFileV3   *ghwp_file_v3_new_from_gsf_input     (GsfInput    *input,
+                                                   GError     **error);
 gchar        *ghwp_file_v3_get_hwp_version_string (GHWPFile    *file);
 void          ghwp_file_v3_get_hwp_version        (GHWPFile    *file,
                                                    guint8      *major_version,
@@ -42,6 +42,8 @@
 
 #include "gsf-input-stream.h"
 #include "ghwp-file-v5.h"
+#include "ghwp-hash.h"
+#include "ghwp-inflate.h"
 #include "config.h"
 
 G_DEFINE_TYPE (GHWPFileV5, ghwp_file_v5, GHWP_TYPE_FILE);
@@ -56,6 +58,17 @@ static gpointer _g_object_ref0 (gpointer obj)
     return obj ? g_object_ref (obj) : NULL;
 }
 
+/* 구역을 여는 데 필요한 것만 둔다 */
+typedef struct
+{
+    guint   id;    /* SectionN 의 N */
+    gint    child; /* BodyText 저장소 안의 자식 번호 */
+    guint64 size;  /* 저장된 (압축된) 크기, 진행률에 쓴다 */
+} GHWPSectionHandle;
+
+static GInputStream *_ghwp_file_v5_open_section (GHWPFileV5 *file,
+                                                 guint       index);
+
 /*typedef enum {*/
 /*    ID_BINARY_DATA      = 0,*/
 /*    ID_KOREAN_FONTS     = 1,*/
@@ -90,42 +103,75 @@ static void _ghwp_file_v5_parse_doc_info (GHWPDocument *doc, GError **error)
 {
     g_return_if_fail (doc != NULL);
 
-/*    guint32 id_mappings[16] = {0}; */ /* 반드시 초기화 해야 한다. */
-/*    int i;*/
+    GInputStream *stream = GHWP_FILE_V5 (doc->file)->doc_info_stream;
+    GHWPContext  *context;
+    GByteArray   *buf;
+
+    if (stream == NULL)
+        return;
+
+    /* 레코드 내용을 한 번에 읽어 고정 크기 구조체로 푼다 */
+    context = ghwp_context_new (stream);
+    ghwp_context_set_cancellable (context, doc->file->priv->cancellable);
+    _ghwp_context_set_stats (context, doc->file->priv->stats);
+    buf = g_byte_array_sized_new (256);
 
-/*    GInputStream *stream  = doc->file->doc_info_stream;
-    GHWPContext  *context = ghwp_context_new (stream);
     while (ghwp_context_pull (context, error)) {
         switch (context->tag_id) {
-        case GHWP_TAG_DOCUMENT_PROPERTIES:*/
-            /* TODO */
-/*            break;
-        case GHWP_TAG_ID_MAPPINGS:*/
-/*            for (i = 0; i < sizeof(id_mappings); i = i + sizeof(guint32)) {*/
-/*                memcpy(&id_mappings[i], &(context->data[i]), sizeof(guint32));*/
-/*                id_mappings[i] = GUINT16_FROM_LE(id_mappings[i]);*/
-/*                printf("%d\n", id_mappings[i]);*/
-/*            }*/
-/*            break;
+        case GHWP_TAG_ID_MAPPINGS:
+        case GHWP_TAG_BIN_DATA:
+        case GHWP_TAG_FACE_NAME:
+        case GHWP_TAG_BORDER_FILL:
+        case GHWP_TAG_CHAR_SHAPE:
+        case GHWP_TAG_PARA_SHAPE:
+        case GHWP_TAG_STYLE:
+            g_byte_array_set_size (buf, context->data_len);
+            if (context_read_data (context, buf->data, context->data_len))
+                ghwp_doc_info_parse_record (doc->doc_info, context->tag_id,
+                                            buf->data, buf->len);
+            break;
         default:
-            printf("%s:%d: %s not implemented\n", __FILE__, __LINE__,
-                _ghwp_get_tag_name (context->tag_id));
             break;
         }
     }
 
-    g_object_unref (context);*/
+    g_byte_array_unref (buf);
+    g_object_unref (context);
 }
 
-static gchar *_ghwp_file_get_text_from_context (GHWPContext *context)
+/* 컨트롤 문자는 WCHAR 8개를 차지한다 */
+static inline void
+_ghwp_file_v5_skip_ctrl (GHWPContext *context, GArray *offsets, guint pos,
+                         guint32 offset)
+{
+    guint k;
+
+    context_skip (context, 14);
+
+    if (offsets == NULL)
+        return;
+
+    for (k = 1; k < 8 && pos + k < offsets->len; k++)
+        g_array_index (offsets, guint32, pos + k) = offset;
+}
+
+/* offsets 가 주어지면 WCHAR 위치마다 UTF-8 바이트 위치를 기록한다.
+ * PARA_CHAR_SHAPE 의 위치를 바꾸는 데 쓴다. */
+static gchar *_ghwp_file_get_text_from_context (GHWPContext *context,
+                                                GArray      *offsets)
 {
     g_return_val_if_fail (context != NULL, NULL);
     gunichar2 ch; /* guint16 */
     GString  *text = g_string_new("");
     guint     i;
 
+    if (offsets)
+        g_array_set_size (offsets, context->data_len / 2 + 1);
+
     for (i = 0; i < context->data_len; i = i + 2)
     {
+        if (offsets)
+            g_array_index (offsets, guint32, i / 2) = (guint32) text->len;
         context_read_uint16 (context, &ch);
         switch (ch) {
         case 0:
@@ -138,20 +184,20 @@ static gchar *_ghwp_file_get_text_from_context (GHWPContext *context)
         case 6: /* inline */
         case 7: /* inline */
         case 8: /* inline */
+            _ghwp_file_v5_skip_ctrl (context, offsets, i / 2, text->len);
             i = i + 14;
-            context_skip(context, 14);;
             break;
         case 9: /* inline */ /* tab */
+            _ghwp_file_v5_skip_ctrl (context, offsets, i / 2, text->len);
             i = i + 14;
-            context_skip(context, 14);;
             g_string_append_unichar(text, ch);
             break;
         case 10:
             break;
         case 11:
         case 12:
+            _ghwp_file_v5_skip_ctrl (context, offsets, i / 2, text->len);
             i = i + 14;
-            context_skip(context, 14);;
             break;
         case 13:
             break;
@@ -165,8 +211,8 @@ static gchar *_ghwp_file_get_text_from_context (GHWPContext *context)
         case 21:
         case 22:
         case 23:
+            _ghwp_file_v5_skip_ctrl (context, offsets, i / 2, text->len);
             i = i + 14;
-            context_skip(context, 14);;
             break;
         case 24:
         case 25:
@@ -183,6 +229,9 @@ static gchar *_ghwp_file_get_text_from_context (GHWPContext *context)
         } /* switch */
     } /* for */
 
+    if (offsets)
+        g_array_index (offsets, guint32, offsets->len - 1) = (guint32) text->len;
+
     if (context->data_count != context->data_len) {
         g_string_free(text, TRUE);
         return NULL;
@@ -204,189 +253,498 @@ typedef enum
     CTRL_ID_TABLE = GUINT32_FROM_LE(MAKE_CTRL_ID('t', 'b', 'l', ' '))
 } CtrlID;
 
+/* PARA_CHAR_SHAPE: (WCHAR 위치, 글자 모양 ID) 쌍의 배열.
+ * offsets 로 위치를 paragraph 의 UTF-8 바이트 위치로 바꾼다. */
+static void _ghwp_file_v5_parse_char_shapes (GHWPContext   *context,
+                                             GHWPParagraph *paragraph,
+                                             GArray        *offsets,
+                                             GByteArray    *buf)
+{
+    GHWPCharShapeRun *runs;
+    guint             n_runs = context->data_len / 8;
+    guint32           end;
+    guint             i;
+
+    if (paragraph == NULL || n_runs == 0)
+        return;
+
+    g_byte_array_set_size (buf, n_runs * 8);
+    if (!context_read_data (context, buf->data, buf->len))
+        return;
+
+    end  = offsets->len ? g_array_index (offsets, guint32, offsets->len - 1)
+                        : 0;
+    runs = g_new (GHWPCharShapeRun, n_runs);
+
+    for (i = 0; i < n_runs; i++) {
+        guint32 pos = GUINT32_FROM_LE (((guint32 *) buf->data)[i * 2]);
+        guint32 id  = GUINT32_FROM_LE (((guint32 *) buf->data)[i * 2 + 1]);
+
+        runs[i].offset        = pos < offsets->len ?
+                                g_array_index (offsets, guint32, pos) : end;
+        runs[i].char_shape_id = id;
+    }
+
+    ghwp_paragraph_set_char_shape_runs (paragraph, runs, n_runs);
+}
+
+/* 본문 레코드 처리기들이 함께 쓰는 상태 */
+typedef struct
+{
+    GHWPDocument  *doc;
+    GHWPStatsData *stats;
+    /* 구역을 다시 읽을 때는 문서 대신 여기에 모은다 */
+    GArray        *paragraphs;
+    GArray        *page_ranges;
+    /* 구역의 첫 문단 번호, 다시 읽을 때는 0 */
+    guint          first_paragraph;
+    guint          n_paragraphs;
+    /* 구역의 마지막 최상위 문단, 번호는 first_paragraph + n_paragraphs - 1 */
+    GHWPParagraph *paragraph;
+    GHWPPageRange  page;
+    gdouble        y;
+    guint32        ctrl_id;
+    guint16        ctrl_lv;
+    /* 셀을 모으고 있는 표의 문단 */
+    GHWPParagraph *table_paragraph;
+    GArray        *pending; /* GHWPPageRange */
+    /* 문단마다 다시 쓰는 임시 버퍼, 글자 모양을 읽지 않으면 offsets 는
+     * NULL */
+    GArray        *offsets;
+    GByteArray    *buf;
+} BodyText;
+
+/* 문단이 끝나기 전에는 표에 셀이 더해질 수 있으므로, 다 찬 페이지는
+ * pending 에 모아 두었다가 최상위 문단 경계에서 내보낸다. */
+static void _ghwp_file_v5_flush_pages (BodyText *body)
+{
+    guint i;
+
+    for (i = 0; i < body->pending->len; i++) {
+        GHWPPageRange *range;
+        range = &g_array_index (body->pending, GHWPPageRange, i);
+        if (body->page_ranges)
+            g_array_append_vals (body->page_ranges, range, 1);
+        else
+            _ghwp_document_add_page_range (body->doc, range);
+    }
+
+    g_array_set_size (body->pending, 0);
+}
+
+/* 현재 페이지를 닫고 빈 페이지를 시작한다 */
+static void _ghwp_file_v5_next_page (BodyText *body)
+{
+    g_array_append_val (body->pending, body->page);
+    memset (&body->page, 0, sizeof (GHWPPageRange));
+}
+
+/* 현재 최상위 문단을 페이지에 놓는다 */
+static void _ghwp_file_v5_add_to_page (BodyText *body)
+{
+    _ghwp_page_range_add_paragraph (&body->page,
+                                    body->first_paragraph +
+                                    body->n_paragraphs - 1);
+}
+
+/* 표가 끝났을 때 부른다. 배치 결과의 행 높이로 쪽을 나눈다.
+ * 표를 가진 문단은 이미 현재 페이지의 마지막 문단이다. */
+static void _ghwp_file_v5_place_table (BodyText *body)
+{
+    const GHWPTableLayout *layout;
+    GHWPParagraph *paragraph = body->table_paragraph;
+    GHWPTable     *table;
+    guint          i;
+    gint64         start;
+
+    if (paragraph == NULL)
+        return;
+
+    body->table_paragraph = NULL;
+    table = ghwp_paragraph_get_table (paragraph);
+    if (!GHWP_IS_TABLE (table))
+        return;
+
+    start = _GHWP_STATS_BEGIN (GHWP_PHASE_PAGINATION);
+
+    /* 페이지를 내보내기 전에 계산해 두어야 읽는 쪽에서 고치지 않는다 */
+    layout = ghwp_table_get_layout (table);
+
+    for (i = 0; i < table->n_rows; i++) {
+        gdouble height = layout->row_offsets[i + 1] - layout->row_offsets[i];
+
+        /* 행 경계에서만 나눈다, 한 행이 페이지보다 크면 그대로 둔다 */
+        if (body->y + height > 842.0 - 80.0 && body->y > 0.0) {
+            body->page.end_row = i;
+            _ghwp_file_v5_next_page (body);
+            _ghwp_file_v5_add_to_page (body);
+            body->page.first_row = i;
+            body->y = 0.0;
+        }
+        body->y += height;
+    }
+
+    _GHWP_STATS_END (body->stats, GHWP_PHASE_PAGINATION, start);
+}
+
+static gboolean _ghwp_file_v5_on_para_header (GHWPContext *context,
+                                              gpointer     user_data,
+                                              GError     **error)
+{
+    BodyText *body = user_data;
+
+    if (body->offsets)
+        g_array_set_size (body->offsets, 0);
+    if (context->status != STATE_INSIDE_TABLE) {
+        /* 앞 문단이 끝났으므로 다 찬 페이지를 내보낸다 */
+        _ghwp_file_v5_flush_pages (body);
+        body->paragraph = ghwp_paragraph_new ();
+        body->n_paragraphs++;
+        if (body->paragraphs)
+            g_array_append_val (body->paragraphs, body->paragraph);
+        else
+            _ghwp_document_add_paragraph (body->doc, body->paragraph);
+    } else if (body->paragraph) {
+        GHWPTable     *table;
+        GHWPTableCell *cell;
+        table = ghwp_paragraph_get_table (body->paragraph);
+        cell  = ghwp_table_get_last_cell (table);
+        GHWPParagraph *c_paragraph = ghwp_paragraph_new ();
+        ghwp_table_cell_add_paragraph (cell, c_paragraph);
+    }
+
+    return TRUE;
+}
+
+static gboolean _ghwp_file_v5_on_para_text (GHWPContext *context,
+                                            gpointer     user_data,
+                                            GError     **error)
+{
+    BodyText      *body      = user_data;
+    GHWPParagraph *paragraph = body->paragraph;
+    GHWPText      *ghwp_text;
+    gchar         *text;
+    guint          len;
+
+    /* 문단 머리 없이 시작하는 구역 */
+    if (paragraph == NULL)
+        return TRUE;
+
+    text      = _ghwp_file_get_text_from_context (context, body->offsets);
+    ghwp_text = ghwp_text_new (text);
+    g_free (text);
+
+    if (context->status != STATE_INSIDE_TABLE) {
+        ghwp_paragraph_set_ghwp_text (paragraph, ghwp_text);
+        /* 높이 계산 */
+        len = g_utf8_strlen (ghwp_text->text, -1);
+        body->y += 18.0 * ceil (len / 33.0);
+
+        if (body->y > 842.0 - 80.0) {
+            _ghwp_file_v5_next_page (body);
+            _ghwp_file_v5_add_to_page (body);
+            body->y = 0.0;
+        } else {
+            _ghwp_file_v5_add_to_page (body);
+        } /* if */
+    } else {
+        GHWPTable     *table;
+        GHWPTableCell *cell;
+        GHWPParagraph *c_paragraph;
+        table       = ghwp_paragraph_get_table (paragraph);
+        cell        = ghwp_table_get_last_cell (table);
+        c_paragraph = ghwp_table_cell_get_last_paragraph (cell);
+        ghwp_paragraph_set_ghwp_text (c_paragraph, ghwp_text);
+    }
+
+    return TRUE;
+}
+
+static gboolean _ghwp_file_v5_on_para_char_shape (GHWPContext *context,
+                                                  gpointer     user_data,
+                                                  GError     **error)
+{
+    BodyText      *body      = user_data;
+    GHWPParagraph *paragraph = body->paragraph;
+
+    if (paragraph == NULL)
+        return TRUE;
+
+    if (context->status == STATE_INSIDE_TABLE) {
+        GHWPTableCell *cell;
+        cell      = ghwp_table_get_last_cell (
+                        ghwp_paragraph_get_table (paragraph));
+        paragraph = cell ? ghwp_table_cell_get_last_paragraph (cell) : NULL;
+    }
+    _ghwp_file_v5_parse_char_shapes (context, paragraph,
+                                     body->offsets, body->buf);
+
+    return TRUE;
+}
+
+static gboolean _ghwp_file_v5_on_ctrl_header (GHWPContext *context,
+                                              gpointer     user_data,
+                                              GError     **error)
+{
+    BodyText *body = user_data;
+
+    context_read_uint32 (context, &body->ctrl_id);
+    body->ctrl_lv = context->level;
+    switch (body->ctrl_id) {
+    case CTRL_ID_TABLE:
+        context->status = STATE_INSIDE_TABLE;
+        break;
+    default:
+        context->status = STATE_NORMAL;
+        _ghwp_file_v5_place_table (body);
+        break;
+    }
+
+    return TRUE;
+}
+
+/*
+      \  col 0   col 1
+       +-------+-------+
+row 0  |  00   |   01  |
+       +-------+-------+
+row 1  |  10   |   11  |
+       +-------+-------+
+row 2  |  20   |   21  |
+       +-------+-------+
+
+<table> ::= { <list-header> <para-header>+ }+
+
+para-header
+    ...
+    ctrl-header (id:tbl)
+        table: row-count, col-count
+        list-header (00)
+        ...
+        list-header (01)
+        ...
+        list-header (10)
+        ...
+        list-header (11)
+        ...
+        list-header (20)
+        ...
+        list-header (21)
+*/
+static gboolean _ghwp_file_v5_on_table (GHWPContext *context,
+                                        gpointer     user_data,
+                                        GError     **error)
+{
+    BodyText      *body      = user_data;
+    GHWPParagraph *paragraph = body->paragraph;
+    GHWPTable     *table;
+
+    if (paragraph == NULL)
+        return TRUE;
+
+    table = ghwp_table_new_from_context (context);
+    ghwp_paragraph_set_table (paragraph, table);
+    /* 문단 글자가 없었으면 아직 페이지에 없다 */
+    _ghwp_file_v5_add_to_page (body);
+    body->table_paragraph = paragraph;
+
+    return TRUE;
+}
+
+static gboolean _ghwp_file_v5_on_list_header (GHWPContext *context,
+                                              gpointer     user_data,
+                                              GError     **error)
+{
+    BodyText      *body = user_data;
+    GHWPTable     *table;
+    GHWPTableCell *cell;
+
+    /* TODO ctrl_id 에 따른 객체를 생성한다 */
+    if (context->status != STATE_INSIDE_TABLE || body->paragraph == NULL)
+        return TRUE;
+
+    /* table에 cell을 추가한다 */
+    table = ghwp_paragraph_get_table (body->paragraph);
+    cell  = ghwp_table_cell_new_from_context (context);
+    /* 높이 계산은 표가 끝난 뒤 _ghwp_file_v5_place_table 에서 */
+    if (GHWP_IS_TABLE (table))
+        ghwp_table_add_cell (table, cell);
+    else
+        _g_object_unref0 (cell);
+
+    return TRUE;
+}
+
+/* 모델을 만드는 태그만 처리하고 나머지는 풀지 않고 건너뛴다. 건너뛴 레코드는
+ * 상태를 바꾸지 않으므로 표가 끝났는지는 다음 처리하는 레코드에서 알아도 된다. */
+static GHWPTagTable *_ghwp_file_v5_body_text_tags (BodyText *body)
+{
+    GHWPTagTable *table = ghwp_tag_table_new ();
+
+    ghwp_tag_table_set_handler (table, GHWP_TAG_PARA_HEADER,
+                                _ghwp_file_v5_on_para_header, body);
+    ghwp_tag_table_set_handler (table, GHWP_TAG_PARA_TEXT,
+                                _ghwp_file_v5_on_para_text, body);
+    /* 글자만 쓰는 경우에는 글자 모양을 풀지 않는다 */
+    if (body->offsets)
+        ghwp_tag_table_set_handler (table, GHWP_TAG_PARA_CHAR_SHAPE,
+                                    _ghwp_file_v5_on_para_char_shape, body);
+    ghwp_tag_table_set_handler (table, GHWP_TAG_CTRL_HEADER,
+                                _ghwp_file_v5_on_ctrl_header, body);
+    ghwp_tag_table_set_handler (table, GHWP_TAG_TABLE,
+                                _ghwp_file_v5_on_table, body);
+    ghwp_tag_table_set_handler (table, GHWP_TAG_LIST_HEADER,
+                                _ghwp_file_v5_on_list_header, body);
+    ghwp_tag_table_ignore_unhandled (table);
+
+    return table;
+}
+
+/* 구역 하나를 읽는다. 구역마다 새 페이지에서 시작하고 앞 구역의 상태를
+ * 넘겨받지 않으므로, 같은 구역은 언제 다시 읽어도 같은 페이지로 나뉜다. */
+static gboolean _ghwp_file_v5_parse_section (GHWPFileV5   *file,
+                                             BodyText     *body,
+                                             GHWPTagTable *tags,
+                                             guint         index,
+                                             GCancellable *cancellable,
+                                             GError      **error)
+{
+    GInputStream *section_stream;
+    GHWPContext  *context;
+    GError       *tmp_error = NULL;
+
+    /* 구역은 읽을 때 열고 다 읽으면 닫는다 */
+    section_stream = _ghwp_file_v5_open_section (file, index);
+    if (section_stream == NULL) {
+        g_set_error (error, GHWP_ERROR, GHWP_ERROR_DAMAGED,
+                     "cannot open section %u", index);
+        return FALSE;
+    }
+
+    memset (&body->page, 0, sizeof (GHWPPageRange));
+    body->y               = 0.0;
+    body->n_paragraphs    = 0;
+    body->paragraph       = NULL;
+    body->table_paragraph = NULL;
+    body->ctrl_lv         = 0;
+
+    context = ghwp_context_new (section_stream);
+    ghwp_context_set_cancellable (context, cancellable);
+    ghwp_context_set_tag_table (context, tags);
+    _ghwp_context_set_stats (context, body->stats);
+
+    while (ghwp_context_pull(context, &tmp_error)) {
+        /* 상태 변화 */
+        if (context->level <= body->ctrl_lv)
+            context->status = STATE_NORMAL;
+
+        if (context->status != STATE_INSIDE_TABLE)
+            _ghwp_file_v5_place_table (body);
+
+        if (!ghwp_context_dispatch (context, &tmp_error))
+            break;
+    } /* while */
+    _ghwp_file_v5_place_table (body);
+    /* add last page */
+    _ghwp_file_v5_next_page (body);
+    _ghwp_file_v5_flush_pages (body);
+    _g_object_unref0 (context);
+    _g_object_unref0 (section_stream);
+
+    /* 취소 또는 에러 */
+    if (tmp_error) {
+        g_propagate_error (error, tmp_error);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+static void _ghwp_file_v5_body_text_init (BodyText *body, GHWPFile *file)
+{
+    body->stats   = file->priv->stats;
+    body->pending = g_array_new (FALSE, FALSE, sizeof (GHWPPageRange));
+    body->buf     = g_byte_array_new ();
+    if (file->priv->load_flags & GHWP_LOAD_CHAR_SHAPES)
+        body->offsets = g_array_new (FALSE, FALSE, sizeof (guint32));
+}
+
+static void _ghwp_file_v5_body_text_clear (BodyText *body)
+{
+    g_array_free (body->pending, TRUE);
+    if (body->offsets)
+        g_array_free (body->offsets, TRUE);
+    g_byte_array_unref (body->buf);
+}
+
 /* TODO fsm parser, nautilus에서 파일 속성만 보는 경우가 있으므로 속도 문제
  * 때문에 get_n_pages 로 옮겨갈 필요가 있다. */
 static void _ghwp_file_v5_parse_body_text (GHWPDocument *doc, GError **error)
 {
     g_return_if_fail (doc != NULL);
-    guint32 ctrl_id = 0;
-    guint16 ctrl_lv = 0;
-    guint16 curr_lv = 0;
-    guint   index;
-    GHWPFileV5 *file = GHWP_FILE_V5(doc->file);
-    gdouble    y    = 0.0;
-    guint      len  = 0;
-    GHWPPage  *page = ghwp_page_new ();
-
-    for (index = 0; index < file->section_streams->len; index++) {
-        GInputStream *section_stream;
-        GHWPContext  *context;
-        section_stream = g_array_index (file->section_streams,
-                                        GInputStream *,
-                                        index);
-        section_stream = _g_object_ref0 (section_stream);
+    GHWPFileV5   *file = GHWP_FILE_V5(doc->file);
+    GHWPTagTable *tags;
+    BodyText      body = { 0 };
+    guint         index;
+    guint         n_sections = ghwp_file_v5_get_n_sections (file);
+    guint64       bytes_done = 0;
+    guint64       bytes_total = 0;
+
+    for (index = 0; index < n_sections; index++)
+        bytes_total += g_array_index (file->priv->sections,
+                                      GHWPSectionHandle, index).size;
+
+    body.doc = doc;
+    _ghwp_file_v5_body_text_init (&body, doc->file);
+    tags = _ghwp_file_v5_body_text_tags (&body);
+
+    _ghwp_file_report_progress (doc, 0, n_sections, 0, bytes_total);
+
+    for (index = 0; index < n_sections; index++) {
+        /* 다 읽은 구역만 색인에 올려 버리고 다시 읽을 수 있게 한다 */
+        body.first_paragraph = _ghwp_document_begin_section (doc);
+        if (!_ghwp_file_v5_parse_section (file, &body, tags, index,
+                                          GHWP_FILE (file)->priv->cancellable,
+                                          error))
+            break;
+        _ghwp_document_end_section (doc);
 
-        context = ghwp_context_new (section_stream);
+        bytes_done += g_array_index (file->priv->sections,
+                                     GHWPSectionHandle, index).size;
+        _ghwp_file_report_progress (doc, index + 1, n_sections,
+                                    bytes_done, bytes_total);
+    } /* for */
 
-        while (ghwp_context_pull(context, error)) {
-            curr_lv = context->level;
-            /* 상태 변화 */
-            if (curr_lv <= ctrl_lv)
-                context->status = STATE_NORMAL;
+    ghwp_tag_table_unref (tags);
+    _ghwp_file_v5_body_text_clear (&body);
+}
 
-            switch (context->tag_id) {
-            case GHWP_TAG_PARA_HEADER:
-                if (context->status != STATE_INSIDE_TABLE) {
-                    GHWPParagraph *paragraph = ghwp_paragraph_new ();
-                    g_array_append_val (doc->paragraphs, paragraph);
-                } else if (context->status == STATE_INSIDE_TABLE) {
-                    GHWPParagraph *paragraph;
-                    GHWPTable     *table;
-                    GHWPTableCell *cell;
-                    paragraph = g_array_index (doc->paragraphs,
-                                               GHWPParagraph *,
-                                               doc->paragraphs->len - 1);
-                    table = ghwp_paragraph_get_table (paragraph);
-                    cell  = ghwp_table_get_last_cell (table);
-                    GHWPParagraph *c_paragraph = ghwp_paragraph_new ();
-                    ghwp_table_cell_add_paragraph (cell, c_paragraph);
-                }
-                break;
-            case GHWP_TAG_PARA_TEXT:
-            {
-                GHWPParagraph *paragraph;
-                GHWPText      *ghwp_text;
-                paragraph    = g_array_index (doc->paragraphs, GHWPParagraph *,
-                                              doc->paragraphs->len - 1);
-                gchar *text  = _ghwp_file_get_text_from_context (context);
-                ghwp_text    = ghwp_text_new (text);
-                g_free (text);
+/* 버린 구역을 다시 읽는다. 문서에는 손대지 않고 paragraphs, page_ranges
+ * 에 최상위 문단과 페이지 범위를 순서대로 담는다. */
+static gboolean ghwp_file_v5_load_section (GHWPFile *file,
+                                           guint     index,
+                                           GArray   *paragraphs,
+                                           GArray   *page_ranges,
+                                           GError  **error)
+{
+    g_return_val_if_fail (GHWP_IS_FILE_V5 (file), FALSE);
 
-                if (context->status != STATE_INSIDE_TABLE) {
-                    ghwp_paragraph_set_ghwp_text (paragraph, ghwp_text);
-                    /* 높이 계산 */
-                    len = g_utf8_strlen (ghwp_text->text, -1);
-                    y += 18.0 * ceil (len / 33.0);
-
-                    if (y > 842.0 - 80.0) {
-                        g_array_append_val (doc->pages, page);
-                        page = ghwp_page_new ();
-                        g_array_append_val (page->paragraphs, paragraph);
-                        y = 0.0;
-                    } else {
-                        g_array_append_val (page->paragraphs, paragraph);
-                    } /* if */
-                    paragraph = NULL;
-                } else if (context->status == STATE_INSIDE_TABLE) {
-                    GHWPTable     *table;
-                    GHWPTableCell *cell;
-                    GHWPParagraph *c_paragraph;
-                    table       = ghwp_paragraph_get_table (paragraph);
-                    cell        = ghwp_table_get_last_cell (table);
-                    c_paragraph = ghwp_table_cell_get_last_paragraph (cell);
-                    ghwp_paragraph_set_ghwp_text (c_paragraph, ghwp_text);
-                }
-            }
-                break;
-            case GHWP_TAG_CTRL_HEADER:
-                context_read_uint32 (context, &ctrl_id);
-                ctrl_lv = context->level;
-                switch (ctrl_id) {
-                case CTRL_ID_TABLE:
-                    context->status = STATE_INSIDE_TABLE;
-                    break;
-                default:
-                    context->status = STATE_NORMAL;
-                    break;
-                }
-                break;
-            case GHWP_TAG_TABLE:
-            /*
-                  \  col 0   col 1
-                   +-------+-------+
-            row 0  |  00   |   01  |
-                   +-------+-------+
-            row 1  |  10   |   11  |
-                   +-------+-------+
-            row 2  |  20   |   21  |
-                   +-------+-------+
-
-            <table> ::= { <list-header> <para-header>+ }+
-
-            para-header
-                ...
-                ctrl-header (id:tbl)
-                    table: row-count, col-count
-                    list-header (00)
-                    ...
-                    list-header (01)
-                    ...
-                    list-header (10)
-                    ...
-                    list-header (11)
-                    ...
-                    list-header (20)
-                    ...
-                    list-header (21)
-            */
-            {
-                GHWPTable     *table;
-                GHWPParagraph *paragraph;
-                table = ghwp_table_new_from_context (context);
-                paragraph = g_array_index (doc->paragraphs, GHWPParagraph *,
-                                           doc->paragraphs->len - 1);
-                ghwp_paragraph_set_table (paragraph, table);
-            }
-                break;
-            case GHWP_TAG_LIST_HEADER:
-                /* TODO ctrl_id 에 따른 객체를 생성한다 */
-                switch (context->status) {
-                /* table에 cell을 추가한다 */
-                case STATE_INSIDE_TABLE:
-                {
-                    GHWPParagraph *paragraph;
-                    GHWPTable     *table;
-                    GHWPTableCell *cell;
-
-                    paragraph = g_array_index (doc->paragraphs, GHWPParagraph *,
-                                               doc->paragraphs->len - 1);
-
-                    table = ghwp_paragraph_get_table (paragraph);
-                    cell  = ghwp_table_cell_new_from_context(context);
-                    if (GHWP_IS_TABLE(table)) {
-                        ghwp_table_add_cell (table, cell);
-                        /* TODO 높이 계산 cell_spacing 고려할 것 FIXME 소수점 */
-                        y += cell->height / 7200.0 * 25.4 *
-                                cell->col_span / table->n_cols;
-                    }
-
-                    if (y > 842.0 - 80.0) {
-                        g_array_append_val (doc->pages, page);
-                        page = ghwp_page_new ();
-                        /* FIXME 중복 저장 */
-                        g_array_append_val (page->paragraphs, paragraph);
-                        y = 0.0;
-                    } else {
-                        /* FIXME 중복 저장 */
-                        g_array_append_val (page->paragraphs, paragraph);
-                    }
-                }
-                    break;
-                default:
-                    break;
-                }
-                break;
-            default:
-/*                printf ("%s:%d: %s not implemented\n", __FILE__, __LINE__,*/
-/*                    _ghwp_get_tag_name(context->tag_id));*/
-                break;
-            } /* switch */
-        } /* while */
-        /* add last page */
-        g_array_append_val (doc->pages, page);
-        _g_object_unref0 (context);
-        _g_object_unref0 (section_stream);
-    } /* for */
+    GHWPTagTable *tags;
+    BodyText      body = { 0 };
+    gboolean      ret;
+
+    body.paragraphs  = paragraphs;
+    body.page_ranges = page_ranges;
+    _ghwp_file_v5_body_text_init (&body, file);
+    tags = _ghwp_file_v5_body_text_tags (&body);
+
+    ret = _ghwp_file_v5_parse_section (GHWP_FILE_V5 (file), &body, tags,
+                                       index, NULL, error);
+
+    ghwp_tag_table_unref (tags);
+    _ghwp_file_v5_body_text_clear (&body);
+
+    return ret;
 }
 
 static void _ghwp_file_v5_parse_prv_text (GHWPDocument *doc)
@@ -582,18 +940,51 @@ static void _ghwp_file_v5_parse_summary_info (GHWPDocument *doc)
     _g_object_unref0 (gis);
 }
 
+/* 모델을 만든 시간은 따로 재지 않고, 읽은 시간에서 다른 단계를 뺀다 */
+static guint64 _ghwp_file_v5_get_inner_time (GHWPStatsData *stats)
+{
+    return _ghwp_stats_get_time (stats, GHWP_PHASE_INFLATE) +
+           _ghwp_stats_get_time (stats, GHWP_PHASE_RECORD_DECODE) +
+           _ghwp_stats_get_time (stats, GHWP_PHASE_PAGINATION);
+}
+
 static void _ghwp_file_v5_parse (GHWPDocument *doc, GError **error)
 {
     g_return_if_fail (doc != NULL);
 
+    GHWPStatsData *stats = doc->file->priv->stats;
+    guint64        inner = 0;
+    gint64         start = 0;
+
+    if (stats) {
+        inner = _ghwp_file_v5_get_inner_time (stats);
+        start = _ghwp_stats_begin (GHWP_PHASE_MODEL_BUILD);
+    }
+
     _ghwp_file_v5_parse_doc_info (doc, error);
-    if (*error) return;
-    _ghwp_file_v5_parse_body_text (doc, error);
+    if (*error == NULL)
+        _ghwp_file_v5_parse_body_text (doc, error);
+
+    if (stats) {
+        _ghwp_stats_end (stats, GHWP_PHASE_MODEL_BUILD, start);
+        _ghwp_stats_add_time (stats, GHWP_PHASE_MODEL_BUILD,
+                              -(gint64) (_ghwp_file_v5_get_inner_time (stats) -
+                                         inner));
+    }
+
     if (*error) return;
     _ghwp_file_v5_parse_prv_text (doc);
     _ghwp_file_v5_parse_summary_info (doc);
 }
 
+static void ghwp_file_v5_load_document (GHWPFile     *file,
+                                        GHWPDocument *doc,
+                                        GError      **error)
+{
+    g_return_if_fail (GHWP_IS_FILE_V5 (file));
+    _ghwp_file_v5_parse (doc, error);
+}
+
 GHWPDocument *ghwp_file_v5_get_document (GHWPFile *file, GError **error)
 {
     g_return_val_if_fail (GHWP_IS_FILE_V5 (file), NULL);
@@ -735,6 +1126,483 @@ static gint compare_entries (gconstpointer a, gconstpointer b)
 }
 
 /* FIXME streams 배열과 enum을 이용하여 코드 재적성 바람 */
+/* 모든 OLE 하위 스트림은 파일의 io_lock 을 공유한다 */
+static GsfInputStream *
+_ghwp_file_v5_stream_new (GHWPFileV5 *file, GsfInput *input)
+{
+    GsfInputStream *gis = gsf_input_stream_new (input);
+    gsf_input_stream_set_lock (gis, &GHWP_FILE (file)->priv->io_lock);
+    return gis;
+}
+
+static gint _compare_sections (gconstpointer a, gconstpointer b)
+{
+    const GHWPSectionHandle *section_a = a;
+    const GHWPSectionHandle *section_b = b;
+
+    return section_a->id < section_b->id ? -1 : section_a->id > section_b->id;
+}
+
+/* 구역은 이름(Section0, Section1 ...)만 보고 순서를 정해 둔다. 스트림과
+ * 압축 풀기 상태는 구역을 읽을 때 _ghwp_file_v5_open_section 에서 만든다. */
+static void _ghwp_file_v5_index_sections (GHWPFileV5 *file)
+{
+    GsfInfile *infile = file->priv->body_text;
+    gint       n_children;
+    gint       i;
+
+    _g_array_free0 (file->priv->sections);
+    file->priv->sections = g_array_new (FALSE, FALSE,
+                                        sizeof (GHWPSectionHandle));
+
+    if (infile == NULL)
+        return;
+
+    n_children = gsf_infile_num_children (infile);
+
+    for (i = 0; i < n_children; i++) {
+        const gchar      *name = gsf_infile_name_by_index (infile, i);
+        gchar            *end  = NULL;
+        guint64           id;
+        GsfInput         *child;
+        GHWPSectionHandle section;
+
+        if (name == NULL || !g_str_has_prefix (name, "Section"))
+            continue;
+
+        id = g_ascii_strtoull (name + 7, &end, 10);
+        if (end == name + 7 || *end != '\0' || id > G_MAXUINT)
+            continue;
+
+        section.id    = (guint) id;
+        section.child = i;
+        section.size  = 0;
+
+        /* 자식을 열어도 디렉터리 항목만 읽는다 */
+        child = gsf_infile_child_by_index (infile, i);
+        if (child) {
+            section.size = (guint64) gsf_input_size (child);
+            g_object_unref (child);
+        }
+
+        g_array_append_val (file->priv->sections, section);
+    }
+
+    g_array_sort (file->priv->sections, _compare_sections);
+}
+
+/* BinData 저장소의 이름(BIN0001.jpg 등)만 보고 ID -> 자식 번호 색인을
+ * 만든다. 내용은 ghwp_file_v5_get_bin_data 에서 처음 요청할 때 읽는다. */
+static void _ghwp_file_v5_index_bin_data (GHWPFileV5 *file)
+{
+    GsfInfile *infile = file->priv->bin_data;
+    gint       n_children;
+    gint       i;
+
+    _g_array_free0 (file->priv->bin_data_index);
+    file->priv->bin_data_index = g_array_new (FALSE, TRUE, sizeof (gint));
+
+    if (infile == NULL)
+        return;
+
+    n_children = gsf_infile_num_children (infile);
+
+    for (i = 0; i < n_children; i++) {
+        const gchar *name = gsf_infile_name_by_index (infile, i);
+        gchar       *end  = NULL;
+        guint64      id;
+
+        if (name == NULL || g_ascii_strncasecmp (name, "BIN", 3) != 0)
+            continue;
+
+        id = g_ascii_strtoull (name + 3, &end, 16);
+
+        if (end == name + 3 || id == 0 || id > G_MAXUINT16)
+            continue;
+
+        if (file->priv->bin_data_index->len <= id)
+            g_array_set_size (file->priv->bin_data_index, (guint) id + 1);
+        /* 0 은 없음을 뜻하므로 자식 번호에 1 을 더해 둔다 */
+        g_array_index (file->priv->bin_data_index, gint, id) = i + 1;
+    }
+}
+
+/**
+ * ghwp_file_v5_get_bin_data:
+ * @file: a #GHWPFileV5
+ * @bin_id: BinData ID, starting at 1
+ * @compressed: whether the storage is deflate-compressed
+ * @error: (allow-none): Return location for an error, or %NULL
+ *
+ * Reads and, if @compressed, inflates the embedded binary item @bin_id.
+ * Nothing is read until this is called; the result is not cached.  Safe
+ * to call while the document is loading in another thread.
+ *
+ * Return value: (transfer full): the item's bytes, or %NULL
+ */
+GBytes *ghwp_file_v5_get_bin_data (GHWPFileV5 *file,
+                                   guint16     bin_id,
+                                   gboolean    compressed,
+                                   GError    **error)
+{
+    g_return_val_if_fail (GHWP_IS_FILE_V5 (file), NULL);
+
+    GArray       *index = file->priv->bin_data_index;
+    GsfInput     *input;
+    GBytes       *bytes = NULL;
+    const guint8 *data;
+    gsf_off_t     size;
+    GMutex       *lock = &GHWP_FILE (file)->priv->io_lock;
+
+    if (index == NULL || bin_id >= index->len ||
+        g_array_index (index, gint, bin_id) == 0) {
+        g_set_error (error, GHWP_ERROR, GHWP_ERROR_INVALID,
+                     "no such bin data: %u", bin_id);
+        return NULL;
+    }
+
+    g_mutex_lock (lock);
+    input = gsf_infile_child_by_index (file->priv->bin_data,
+                                       g_array_index (index, gint, bin_id) - 1);
+    if (input) {
+        size = gsf_input_size (input);
+        data = gsf_input_read (input, (size_t) size, NULL);
+        if (data && !compressed)
+            bytes = g_bytes_new (data, (gsize) size);
+        else if (data)
+            bytes = _ghwp_inflate_bytes (data, (gsize) size, error);
+        g_object_unref (input);
+    }
+    g_mutex_unlock (lock);
+
+    if (bytes == NULL && error && *error == NULL)
+        g_set_error (error, GHWP_ERROR, GHWP_ERROR_DAMAGED,
+                     "cannot read bin data: %u", bin_id);
+
+    return bytes;
+}
+
+/* 압축된 input 을 푸는 스트림. 통계를 켰으면 푸는 데 든 시간을 센다. */
+static GInputStream *
+_ghwp_file_v5_inflate_stream (GHWPFileV5 *file, GsfInput *input)
+{
+    GsfInputStream *gis = _ghwp_file_v5_stream_new (file, input);
+    GInputStream   *stream;
+
+    /* 압축된 크기는 OLE 디렉터리에 있다 */
+    stream = _ghwp_inflate_stream_new ((GInputStream *) gis,
+                                       (gsize) gsf_input_size (input),
+                                       GHWP_FILE (file)->priv->stats);
+    g_object_unref (gis);
+
+    return stream;
+}
+
+/* 구역 스트림을 새로 연다. 부를 때마다 처음부터 읽을 수 있고, 다 읽고
+ * 놓으면 OLE 자식, 압축 풀기 상태가 함께 사라진다. */
+static GInputStream *
+_ghwp_file_v5_open_section (GHWPFileV5 *file, guint index)
+{
+    GMutex       *lock = &GHWP_FILE (file)->priv->io_lock;
+    GArray       *sections = file->priv->sections;
+    GsfInput     *section;
+    GInputStream *stream;
+
+    if (sections == NULL || index >= sections->len)
+        return NULL;
+
+    /* 자식을 만들 때 원본을 읽을 수 있다 */
+    g_mutex_lock (lock);
+    section = gsf_infile_child_by_index (file->priv->body_text,
+                  g_array_index (sections, GHWPSectionHandle, index).child);
+    g_mutex_unlock (lock);
+
+    if (section == NULL)
+        return NULL;
+
+    if (file->is_compress)
+        stream = _ghwp_file_v5_inflate_stream (file, section);
+    else
+        stream = G_INPUT_STREAM (_ghwp_file_v5_stream_new (file, section));
+    g_object_unref (section);
+
+    return stream;
+}
+
+/**
+ * ghwp_file_v5_get_n_sections:
+ * @file: a #GHWPFileV5
+ *
+ * Return value: the number of BodyText sections
+ */
+guint ghwp_file_v5_get_n_sections (GHWPFileV5 *file)
+{
+    g_return_val_if_fail (GHWP_IS_FILE_V5 (file), 0);
+
+    return file->priv->sections ? file->priv->sections->len : 0;
+}
+
+/**
+ * ghwp_file_v5_foreach_paragraph_text:
+ * @file: a #GHWPFileV5
+ * @func: (scope call): called with the text of each paragraph
+ * @user_data: user data for @func
+ * @cancellable: (allow-none): a #GCancellable, or %NULL
+ * @error: (allow-none): Return location for an error, or %NULL
+ *
+ * Reads the body text record by record and calls @func for every
+ * paragraph that has text, including paragraphs inside table cells.
+ * No document, pages or paragraph objects are built, and sections are
+ * opened afresh, so this can be used whether or not a document was
+ * loaded from @file.  Paragraphs are numbered in record order within
+ * each section.  Stops early when @func returns %FALSE.
+ *
+ * Return value: %FALSE if an error occurred
+ */
+gboolean ghwp_file_v5_foreach_paragraph_text (GHWPFileV5           *file,
+                                              GHWPParagraphTextFunc func,
+                                              gpointer              user_data,
+                                              GCancellable         *cancellable,
+                                              GError              **error)
+{
+    g_return_val_if_fail (GHWP_IS_FILE_V5 (file), FALSE);
+    g_return_val_if_fail (func != NULL, FALSE);
+
+    GError       *tmp_error = NULL;
+    gboolean      proceed   = TRUE;
+    guint         index;
+    guint         n_sections = ghwp_file_v5_get_n_sections (file);
+    GHWPTagTable *tags       = ghwp_tag_table_new ();
+
+    /* 문단 머리와 글자 말고는 풀지 않는다 */
+    ghwp_tag_table_ignore_unhandled (tags);
+    ghwp_tag_table_set_ignored (tags, GHWP_TAG_PARA_HEADER, FALSE);
+    ghwp_tag_table_set_ignored (tags, GHWP_TAG_PARA_TEXT, FALSE);
+
+    for (index = 0; proceed && index < n_sections; index++) {
+        GInputStream *stream;
+        GHWPContext  *context;
+        guint         paragraph = 0;
+
+        stream = _ghwp_file_v5_open_section (file, index);
+        if (stream == NULL) {
+            g_set_error (&tmp_error, GHWP_ERROR, GHWP_ERROR_DAMAGED,
+                         "cannot open section %u", index);
+            break;
+        }
+
+        context = ghwp_context_new (stream);
+        ghwp_context_set_cancellable (context, cancellable);
+        ghwp_context_set_tag_table (context, tags);
+
+        while (proceed && ghwp_context_pull (context, &tmp_error)) {
+            gchar *text;
+
+            switch (context->tag_id) {
+            case GHWP_TAG_PARA_HEADER:
+                paragraph++;
+                break;
+            case GHWP_TAG_PARA_TEXT:
+                text = _ghwp_file_get_text_from_context (context, NULL);
+                if (text && *text && paragraph > 0)
+                    proceed = func (index, paragraph - 1, text, user_data);
+                g_free (text);
+                break;
+            default:
+                break;
+            }
+        }
+
+        g_object_unref (context);
+        g_object_unref (stream);
+
+        if (tmp_error)
+            break;
+    }
+
+    ghwp_tag_table_unref (tags);
+
+    if (tmp_error) {
+        g_propagate_error (error, tmp_error);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/**
+ * ghwp_file_v5_foreach_record:
+ * @file: a #GHWPFileV5
+ * @table: handlers to call, see ghwp_tag_table_set_handler()
+ * @cancellable: (allow-none): a #GCancellable, or %NULL
+ * @error: (allow-none): Return location for an error, or %NULL
+ *
+ * Reads every BodyText section from the start and calls the handler in
+ * @table for each record.  Records whose tag is ignored in @table are
+ * skipped without decoding their body, so a consumer that only needs a
+ * few tags can mark the rest ignored with
+ * ghwp_tag_table_ignore_unhandled().  Stops early when a handler
+ * returns %FALSE.
+ *
+ * Return value: %FALSE if an error occurred
+ */
+gboolean ghwp_file_v5_foreach_record (GHWPFileV5   *file,
+                                      GHWPTagTable *table,
+                                      GCancellable *cancellable,
+                                      GError      **error)
+{
+    g_return_val_if_fail (GHWP_IS_FILE_V5 (file), FALSE);
+    g_return_val_if_fail (table != NULL, FALSE);
+
+    GError  *tmp_error = NULL;
+    gboolean proceed   = TRUE;
+    guint    index;
+    guint    n_sections = ghwp_file_v5_get_n_sections (file);
+
+    for (index = 0; proceed && index < n_sections; index++) {
+        GInputStream *stream;
+        GHWPContext  *context;
+
+        stream = _ghwp_file_v5_open_section (file, index);
+        if (stream == NULL) {
+            g_set_error (&tmp_error, GHWP_ERROR, GHWP_ERROR_DAMAGED,
+                         "cannot open section %u", index);
+            break;
+        }
+
+        context = ghwp_context_new (stream);
+        ghwp_context_set_cancellable (context, cancellable);
+        ghwp_context_set_tag_table (context, table);
+
+        while (proceed && ghwp_context_pull (context, &tmp_error))
+            proceed = ghwp_context_dispatch (context, &tmp_error);
+
+        g_object_unref (context);
+        g_object_unref (stream);
+
+        if (tmp_error)
+            break;
+    }
+
+    if (tmp_error) {
+        g_propagate_error (error, tmp_error);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/* 내용 지문. 레코드마다 태그, 수준과 내용에 해당하는 부분만 섞는다.
+ * 문단 머리의 인스턴스 ID, 줄 배치, 글자 모양 ID 처럼 사본마다 달라질
+ * 수 있는 것은 넣지 않는다. */
+typedef struct
+{
+    GHWPHash64  state;
+    GByteArray *buf;             /* 레코드마다 다시 쓴다 */
+    guint32     ctrl_ids[0x400]; /* 수준(10 비트)마다 마지막 레코드의
+                                    컨트롤 ID, 컨트롤이 아니면 0 */
+} ContentHash;
+
+static gboolean _ghwp_file_v5_hash_record (GHWPContext *context,
+                                           gpointer     user_data,
+                                           GError     **error)
+{
+    ContentHash *hash = user_data;
+    guint16      head[2];
+    guint32      from = 0;
+    guint32      len  = 0;
+    guint32      raw;
+
+    head[0] = GUINT16_TO_LE (context->tag_id);
+    head[1] = GUINT16_TO_LE (context->level);
+    _ghwp_hash64_update (&hash->state, head, sizeof head);
+
+    switch (context->tag_id) {
+    case GHWP_TAG_PARA_TEXT:
+        len = context->data_len;
+        break;
+    case GHWP_TAG_CTRL_HEADER:
+        len = 4; /* 컨트롤 ID */
+        break;
+    case GHWP_TAG_TABLE:
+        /* 속성 다음의 행 수, 열 수 */
+        from = 4;
+        len  = 8;
+        break;
+    case GHWP_TAG_LIST_HEADER:
+        /* 표의 셀이면 주소와 병합. 셀 안에 또 표가 있어도 바로 위
+         * 수준의 컨트롤이 이 목록을 가진다. */
+        if (context->level > 0 &&
+            hash->ctrl_ids[context->level - 1] == CTRL_ID_TABLE) {
+            from = 8;
+            len  = 16;
+        }
+        break;
+    default:
+        break;
+    }
+
+    /* 레코드는 앞 순서로 나오므로 한 수준 위의 마지막 레코드가 부모다 */
+    hash->ctrl_ids[context->level] = 0;
+
+    len = MIN (len, context->data_len);
+    if (len <= from)
+        return TRUE;
+
+    g_byte_array_set_size (hash->buf, len);
+    if (!context_read_data (context, hash->buf->data, len)) {
+        g_set_error (error, GHWP_ERROR, GHWP_ERROR_DAMAGED,
+                     "cannot read record %u", context->tag_id);
+        return FALSE;
+    }
+
+    if (context->tag_id == GHWP_TAG_CTRL_HEADER) {
+        memcpy (&raw, hash->buf->data, sizeof raw);
+        hash->ctrl_ids[context->level] = GUINT32_FROM_LE (raw);
+    }
+
+    _ghwp_hash64_update (&hash->state, hash->buf->data + from, len - from);
+
+    return TRUE;
+}
+
+static gboolean ghwp_file_v5_compute_content_hash (GHWPFile     *file,
+                                                   guint64      *hash,
+                                                   GCancellable *cancellable,
+                                                   GError      **error)
+{
+    ContentHash   data;
+    GHWPTagTable *table = ghwp_tag_table_new ();
+    gboolean      ret;
+
+    _ghwp_hash64_init (&data.state, 0);
+    data.buf = g_byte_array_new ();
+    memset (data.ctrl_ids, 0, sizeof data.ctrl_ids);
+
+    /* 나머지 레코드는 내용을 풀지 않고 건너뛴다 */
+    ghwp_tag_table_set_handler (table, GHWP_TAG_PARA_HEADER,
+                                _ghwp_file_v5_hash_record, &data);
+    ghwp_tag_table_set_handler (table, GHWP_TAG_PARA_TEXT,
+                                _ghwp_file_v5_hash_record, &data);
+    ghwp_tag_table_set_handler (table, GHWP_TAG_CTRL_HEADER,
+                                _ghwp_file_v5_hash_record, &data);
+    ghwp_tag_table_set_handler (table, GHWP_TAG_TABLE,
+                                _ghwp_file_v5_hash_record, &data);
+    ghwp_tag_table_set_handler (table, GHWP_TAG_LIST_HEADER,
+                                _ghwp_file_v5_hash_record, &data);
+    ghwp_tag_table_ignore_unhandled (table);
+
+    ret = ghwp_file_v5_foreach_record (GHWP_FILE_V5 (file), table,
+                                       cancellable, error);
+    if (ret)
+        *hash = _ghwp_hash64_digest (&data.state);
+
+    ghwp_tag_table_unref (table);
+    g_byte_array_unref (data.buf);
+
+    return ret;
+}
+
 static void _ghwp_file_v5_make_stream (GHWPFileV5 *file)
 {
     g_return_if_fail (file != NULL);
@@ -772,12 +1640,12 @@ static void _ghwp_file_v5_make_stream (GHWPFileV5 *file)
                 fprintf (stderr, "invalid\n");
             }
 
-            file->file_header_stream = G_INPUT_STREAM (gsf_input_stream_new (input));
+            file->file_header_stream = G_INPUT_STREAM (_ghwp_file_v5_stream_new (file, input));
+            _g_object_unref0 (input);
             ghwp_file_v5_decode_file_header (file);
         } else if (g_str_equal (entry, "DocInfo")) {
             input = gsf_infile_child_by_name ((GsfInfile*) file->priv->olefile,
                                               entry);
-            input = _g_object_ref0 (input);
             num_children = gsf_infile_num_children ((GsfInfile*) input);
 
             if (num_children > 0) {
@@ -785,85 +1653,27 @@ static void _ghwp_file_v5_make_stream (GHWPFileV5 *file)
             }
 
             if (file->is_compress) {
-                GsfInputStream    *gis;
-                GZlibDecompressor *zd;
-                GInputStream      *cis;
-
-                gis = gsf_input_stream_new (input);
-                zd  = g_zlib_decompressor_new (G_ZLIB_COMPRESSOR_FORMAT_RAW);
-                cis = g_converter_input_stream_new ((GInputStream*) gis,
-                                                    (GConverter*) zd);
                 _g_object_unref0 (file->doc_info_stream);
-                file->doc_info_stream = cis;
-
-                _g_object_unref0 (zd);
-                _g_object_unref0 (gis);
+                file->doc_info_stream = _ghwp_file_v5_inflate_stream (file,
+                                                                      input);
             } else {
                 _g_object_unref0 (file->doc_info_stream);
-                file->doc_info_stream = (GInputStream*) gsf_input_stream_new (input);
+                file->doc_info_stream = (GInputStream*) _ghwp_file_v5_stream_new (file, input);
             }
             _g_object_unref0 (input);
         } else if (g_str_equal(entry, "BodyText") ||
                    g_str_equal(entry, "VeiwText")) {
-            GsfInfile* infile;
-
-            _g_array_free0 (file->section_streams);
-            file->section_streams = g_array_new (TRUE, TRUE,
-                                                 sizeof (GInputStream*));
-
-            infile = (GsfInfile*) gsf_infile_child_by_name (
+            _g_object_unref0 (file->priv->body_text);
+            file->priv->body_text = (GsfInfile*) gsf_infile_child_by_name (
                                          (GsfInfile*) file->priv->olefile, entry);
-            infile = _g_object_ref0 (infile);
-
-            num_children = gsf_infile_num_children (infile);
+            _ghwp_file_v5_index_sections (file);
 
-            if (num_children == 0) {
+            if (file->priv->sections->len == 0) {
                 fprintf (stderr, "nothing in %s\n", entry);
             }
-
-            gint j;
-            for (j = 0; j < num_children; j++) {
-
-                input = gsf_infile_child_by_vname (infile,
-                                             g_strdup_printf("Section%d", j),
-                                             NULL);
-
-                GsfInfile *section = _g_object_ref0 (input);
-
-                if (gsf_infile_num_children (section) > 0) {
-                    fprintf (stderr, "invalid section\n");
-                }
-
-                if (file->is_compress) {
-                    GsfInputStream* gis;
-                    GZlibDecompressor* zd;
-                    GConverterInputStream* cis;
-
-                    gis = gsf_input_stream_new ((GsfInput*) section);
-                    zd = g_zlib_decompressor_new (G_ZLIB_COMPRESSOR_FORMAT_RAW);
-                    cis = (GConverterInputStream*) g_converter_input_stream_new ((GInputStream*) gis, (GConverter*) zd);
-
-                    _g_object_unref0 (file->priv->section_stream);
-                    file->priv->section_stream = G_INPUT_STREAM (cis);
-                    _g_object_unref0 (zd);
-                    _g_object_unref0 (gis);
-                } else {
-                    GsfInputStream* stream;
-                    stream = gsf_input_stream_new ((GsfInput*) section);
-                    _g_object_unref0 (file->priv->section_stream);
-                    file->priv->section_stream = G_INPUT_STREAM (stream);
-                }
-
-                GInputStream *_stream_ = file->priv->section_stream;
-                _stream_ = _g_object_ref0 (_stream_);
-                g_array_append_val (file->section_streams, _stream_);
-                _g_object_unref0 (section);
-            } /* for */
-            _g_object_unref0 (infile);
         } else if (g_str_equal (entry, "\005HwpSummaryInformation")) {
             input = gsf_infile_child_by_name ((GsfInfile*) file->priv->olefile,
                                               entry);
-            input = _g_object_ref0 (input);
             num_children = gsf_infile_num_children ((GsfInfile*) input);
 
             if (num_children > 0) {
@@ -871,12 +1681,11 @@ static void _ghwp_file_v5_make_stream (GHWPFileV5 *file)
             }
 
             _g_object_unref0 (file->summary_info_stream);
-            file->summary_info_stream = (GInputStream*) gsf_input_stream_new (input);
+            file->summary_info_stream = (GInputStream*) _ghwp_file_v5_stream_new (file, input);
             _g_object_unref0 (input);
         } else if (g_str_equal (entry, "PrvText")) {
             input = gsf_infile_child_by_name ((GsfInfile*) file->priv->olefile,
                                               entry);
-            input = _g_object_ref0 (input);
             num_children = gsf_infile_num_children ((GsfInfile*) input);
 
             if (num_children > 0) {
@@ -884,12 +1693,11 @@ static void _ghwp_file_v5_make_stream (GHWPFileV5 *file)
             }
 
             _g_object_unref0 (file->prv_text_stream);
-            file->prv_text_stream = (GInputStream *) gsf_input_stream_new (input);
+            file->prv_text_stream = (GInputStream *) _ghwp_file_v5_stream_new (file, input);
             _g_object_unref0 (input);
         } else if (g_str_equal (entry, "PrvImage")) {
             input = gsf_infile_child_by_name ((GsfInfile*) file->priv->olefile,
                                               entry);
-            input = _g_object_ref0 (input);
             num_children = gsf_infile_num_children ((GsfInfile*) input);
 
             if (num_children > 0) {
@@ -897,14 +1705,19 @@ static void _ghwp_file_v5_make_stream (GHWPFileV5 *file)
             }
 
             _g_object_unref0 (file->prv_image_stream);
-            file->prv_image_stream = (GInputStream*) gsf_input_stream_new (input);
+            file->prv_image_stream = (GInputStream*) _ghwp_file_v5_stream_new (file, input);
             _g_object_unref0 (input);
+        } else if (g_str_equal (entry, "BinData")) {
+            input = gsf_infile_child_by_name ((GsfInfile*) file->priv->olefile,
+                                              entry);
+            _g_object_unref0 (file->priv->bin_data);
+            file->priv->bin_data = (GsfInfile *) input;
+            _ghwp_file_v5_index_bin_data (file);
         } else {
             g_warning("%s:%d: %s not implemented\n", __FILE__, __LINE__, entry);
         } /* if */
     } /* for */
     g_array_free (entries, TRUE);
-    g_array_unref (entries);
 }
 
 GHWPFileV5* ghwp_file_v5_new_from_filename (const gchar* filename, GError** error)
@@ -913,7 +1726,7 @@ GHWPFileV5* ghwp_file_v5_new_from_filename (const gchar* filename, GError** erro
     GFile *gfile = g_file_new_for_path (filename);
 
     GsfInputStdio* input;
-    GsfInfileMSOle* olefile;
+    GHWPFileV5    *file;
 
     gchar *path = g_file_get_path(gfile);
     _g_object_unref0 (gfile);
@@ -921,27 +1734,62 @@ GHWPFileV5* ghwp_file_v5_new_from_filename (const gchar* filename, GError** erro
     _g_free0 (path);
 
     if (input == NULL) {
-        g_warning("%s:%d: %s\n", __FILE__, __LINE__, (*error)->message);
         return NULL;
     }
 
-    olefile = (GsfInfileMSOle*) gsf_infile_msole_new ((GsfInput*) input,
-                                                      error);
+    file = ghwp_file_v5_new_from_gsf_input ((GsfInput*) input, error);
+    _g_object_unref0 (input);
+
+    return file;
+}
+
+/**
+ * ghwp_file_v5_new_from_gsf_input:
+ * @input: a #GsfInput holding an OLE compound document
+ * @error: (allow-none): Return location for an error, or %NULL
+ *
+ * Creates a new #GHWPFileV5 reading from @input.  @input may be backed by
+ * a file or by memory (see gsf_input_memory_new()); it is referenced by
+ * the returned file.
+ *
+ * Return value: A newly created #GHWPFileV5, or %NULL
+ **/
+GHWPFileV5 *ghwp_file_v5_new_from_gsf_input (GsfInput *input, GError **error)
+{
+    g_return_val_if_fail (GSF_IS_INPUT (input), NULL);
+
+    GsfInfileMSOle *olefile;
+    gint64          start = _GHWP_STATS_BEGIN (GHWP_PHASE_OLE_OPEN);
+
+    olefile = (GsfInfileMSOle*) gsf_infile_msole_new (input, error);
 
     if (olefile == NULL) {
-        g_warning("%s:%d: %s\n", __FILE__, __LINE__, (*error)->message);
-        _g_object_unref0 (input);
         return NULL;
     }
 
     GHWPFileV5 *file = g_object_new (GHWP_TYPE_FILE_V5, NULL);
     file->priv->olefile = olefile;
-    _g_object_unref0 (input);
+    if (GSF_IS_INPUT_MEMORY (input))
+        file->priv->source_size = (gsize) gsf_input_size (input);
     _ghwp_file_v5_make_stream (file);
+    _GHWP_STATS_END (GHWP_FILE (file)->priv->stats, GHWP_PHASE_OLE_OPEN, start);
 
     return file;
 }
 
+static gsize ghwp_file_v5_get_memory_usage (GHWPFile *file)
+{
+    GHWPFileV5 *v5    = GHWP_FILE_V5 (file);
+    gsize       usage = v5->priv->source_size;
+
+    if (v5->priv->sections)
+        usage += v5->priv->sections->len * sizeof (GHWPSectionHandle);
+    if (v5->priv->bin_data_index)
+        usage += v5->priv->bin_data_index->len * sizeof (gint);
+
+    return usage;
+}
+
 static void ghwp_file_v5_finalize (GObject* obj)
 {
     GHWPFileV5 *file = GHWP_FILE_V5(obj);
@@ -950,9 +1798,11 @@ static void ghwp_file_v5_finalize (GObject* obj)
     _g_object_unref0 (file->prv_image_stream);
     _g_object_unref0 (file->file_header_stream);
     _g_object_unref0 (file->doc_info_stream);
-    _g_array_free0 (file->section_streams);
-    _g_object_unref0 (file->priv->section_stream);
+    _g_object_unref0 (file->priv->body_text);
+    _g_array_free0 (file->priv->sections);
     _g_object_unref0 (file->summary_info_stream);
+    _g_object_unref0 (file->priv->bin_data);
+    _g_array_free0 (file->priv->bin_data_index);
     g_free (file->signature);
     G_OBJECT_CLASS (ghwp_file_v5_parent_class)->finalize (obj);
 }
@@ -962,8 +1812,12 @@ static void ghwp_file_v5_class_init (GHWPFileV5Class * klass)
     GObjectClass *object_class = G_OBJECT_CLASS (klass);
     g_type_class_add_private (klass, sizeof (GHWPFileV5Private));
     GHWP_FILE_CLASS (klass)->get_document = ghwp_file_v5_get_document;
+    GHWP_FILE_CLASS (klass)->load_document = ghwp_file_v5_load_document;
+    GHWP_FILE_CLASS (klass)->load_section = ghwp_file_v5_load_section;
     GHWP_FILE_CLASS (klass)->get_hwp_version_string = ghwp_file_v5_get_hwp_version_string;
     GHWP_FILE_CLASS (klass)->get_hwp_version = ghwp_file_v5_get_hwp_version;
+    GHWP_FILE_CLASS (klass)->get_memory_usage = ghwp_file_v5_get_memory_usage;
+    GHWP_FILE_CLASS (klass)->compute_content_hash = ghwp_file_v5_compute_content_hash;
     object_class->finalize = ghwp_file_v5_finalize;
 }
 
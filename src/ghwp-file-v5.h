@@ -51,7 +51,6 @@ struct _GHWPFileV5
     GHWPFile           parent_instance;
     GHWPFileV5Private *priv;
 
-    GArray            *section_streams;
     GInputStream      *prv_text_stream;
     GInputStream      *prv_image_stream;
     GInputStream      *file_header_stream;
@@ -82,10 +81,28 @@ struct _GHWPFileV5Class
     GHWPFileClass parent_class;
 };
 
+/**
+ * GHWPParagraphTextFunc:
+ * @section: index of the BodyText section
+ * @paragraph: index of the paragraph within @section, in record order
+ * @text: the paragraph text in UTF-8
+ * @user_data: user data
+ *
+ * Return value: %FALSE to stop
+ */
+typedef gboolean (*GHWPParagraphTextFunc) (guint        section,
+                                           guint        paragraph,
+                                           const gchar *text,
+                                           gpointer     user_data);
+
 struct _GHWPFileV5Private
 {
     GsfInfileMSOle *olefile;
-    GInputStream   *section_stream;
+    GsfInfile      *body_text;
+    GArray         *sections;       /* GHWPSectionHandle, 구역 번호 순 */
+    GsfInfile      *bin_data;
+    GArray         *bin_data_index; /* ID -> 자식 번호 + 1 */
+    gsize           source_size;    /* 원본이 메모리에 있을 때 그 크기 */
 };
 
 GType         ghwp_file_v5_get_type               (void) G_GNUC_CONST;
@@ -93,6 +110,8 @@ GHWPFileV5   *ghwp_file_v5_new_from_uri           (const gchar *uri,
                                                    GError     **error);
 GHWPFileV5   *ghwp_file_v5_new_from_filename      (const gchar *filename,
                                                    GError     **error);
+GHWPFileV5   *ghwp_file_v5_new_from_gsf_input     (GsfInput    *input,
+                                                   GError     **error);
 gchar        *ghwp_file_v5_get_hwp_version_string (GHWPFile    *file);
 void          ghwp_file_v5_get_hwp_version        (GHWPFile    *file,
                                                    guint8      *major_version,
@@ -101,6 +120,20 @@ void          ghwp_file_v5_get_hwp_version        (GHWPFile    *file,
                                                    guint8      *extra_version);
 GHWPDocument *ghwp_file_v5_get_document           (GHWPFile    *file,
                                                    GError     **error);
+GBytes       *ghwp_file_v5_get_bin_data           (GHWPFileV5  *file,
+                                                   guint16      bin_id,
+                                                   gboolean     compressed,
+                                                   GError     **error);
+guint         ghwp_file_v5_get_n_sections         (GHWPFileV5  *file);
+gboolean      ghwp_file_v5_foreach_paragraph_text (GHWPFileV5           *file,
+                                                   GHWPParagraphTextFunc func,
+                                                   gpointer              user_data,
+                                                   GCancellable         *cancellable,
+                                                   GError              **error);
+gboolean      ghwp_file_v5_foreach_record         (GHWPFileV5           *file,
+                                                   GHWPTagTable         *table,
+                                                   GCancellable         *cancellable,
+                                                   GError              **error);
 
 G_END_DECLS
 
@@ -28,6 +28,8 @@
 #include <glib.h>
 #include <glib-object.h>
 #include <string.h>
+#include <gsf/gsf-input-memory.h>
+#include <gsf/gsf-input-stdio.h>
 
 #include "ghwp-file.h"
 #include "ghwp-file-v5.h"
@@ -70,6 +72,120 @@ GHWPDocument *ghwp_file_get_document (GHWPFile *file, GError **error)
     return GHWP_FILE_GET_CLASS (file)->get_document (file, error);
 }
 
+/* private
+ * doc->file 은 호출한 쪽이 미리 설정한다. 읽는 동안 완성된 페이지는
+ * _ghwp_document_add_page_range 로 doc 에 바로 더해진다. */
+void _ghwp_file_load_document (GHWPFile     *file,
+                               GHWPDocument *doc,
+                               GError      **error)
+{
+    g_return_if_fail (GHWP_IS_FILE (file));
+    g_return_if_fail (GHWP_IS_DOCUMENT (doc) && doc->file == file);
+
+    GHWP_FILE_GET_CLASS (file)->load_document (file, doc, error);
+}
+
+/* private
+ * 문서가 버린 구역 하나를 다시 읽어 최상위 문단과 페이지 범위를
+ * paragraphs, page_ranges 에 담는다. 범위의 문단 번호는 구역 안에서 센다.
+ * 구역 단위로 다시 읽을 수 없는 형식은 FALSE. */
+gboolean _ghwp_file_load_section (GHWPFile *file,
+                                  guint     index,
+                                  GArray   *paragraphs,
+                                  GArray   *page_ranges,
+                                  GError  **error)
+{
+    g_return_val_if_fail (GHWP_IS_FILE (file), FALSE);
+
+    if (GHWP_FILE_GET_CLASS (file)->load_section == NULL) {
+        g_set_error_literal (error, GHWP_ERROR, GHWP_ERROR_INVALID,
+                             "sections cannot be reloaded");
+        return FALSE;
+    }
+
+    return GHWP_FILE_GET_CLASS (file)->load_section (file, index, paragraphs,
+                                                     page_ranges, error);
+}
+
+/**
+ * ghwp_file_set_load_flags:
+ * @file: a #GHWPFile
+ * @flags: what to read
+ *
+ * Chooses what ghwp_file_get_document() reads.  The default,
+ * %GHWP_LOAD_DEFAULT, is enough for getting the text; pass
+ * %GHWP_LOAD_CHAR_SHAPES to draw pages with the fonts of the document.
+ * Call it before ghwp_file_get_document().  Sections reloaded later
+ * keep the flags they were first read with.
+ */
+void ghwp_file_set_load_flags (GHWPFile *file, GHWPLoadFlags flags)
+{
+    g_return_if_fail (GHWP_IS_FILE (file));
+
+    file->priv->load_flags = flags;
+}
+
+/**
+ * ghwp_file_get_load_flags:
+ * @file: a #GHWPFile
+ *
+ * Return value: the flags set with ghwp_file_set_load_flags()
+ */
+GHWPLoadFlags ghwp_file_get_load_flags (GHWPFile *file)
+{
+    g_return_val_if_fail (GHWP_IS_FILE (file), GHWP_LOAD_DEFAULT);
+
+    return file->priv->load_flags;
+}
+
+/**
+ * ghwp_file_compute_content_hash:
+ * @file: a #GHWPFile
+ * @hash: (out): return location for the hash
+ * @cancellable: (allow-none): a #GCancellable, or %NULL
+ * @error: (allow-none): Return location for an error, or %NULL
+ *
+ * Computes a 64-bit fingerprint of the body of @file for finding
+ * duplicates.  It covers paragraph text and the structure of paragraphs,
+ * controls and tables, but not the summary information, the preview or
+ * layout caches, so copies that differ only in those get the same value.
+ * Records are read one by one and hashed with XXH64; no document is
+ * built.  This is not a cryptographic hash.  Only HWP v5 files are
+ * supported.
+ *
+ * Return value: %FALSE if an error occurred
+ */
+gboolean ghwp_file_compute_content_hash (GHWPFile     *file,
+                                         guint64      *hash,
+                                         GCancellable *cancellable,
+                                         GError      **error)
+{
+    g_return_val_if_fail (GHWP_IS_FILE (file), FALSE);
+    g_return_val_if_fail (hash != NULL, FALSE);
+
+    if (GHWP_FILE_GET_CLASS (file)->compute_content_hash == NULL) {
+        g_set_error_literal (error, GHWP_ERROR, GHWP_ERROR_INVALID,
+                             "content hash is not supported for this format");
+        return FALSE;
+    }
+
+    return GHWP_FILE_GET_CLASS (file)->compute_content_hash (file, hash,
+                                                             cancellable,
+                                                             error);
+}
+
+/* private
+ * 파일이 메모리에 들고 있는 원본, 스트림 색인 등의 바이트 수 */
+gsize _ghwp_file_get_memory_usage (GHWPFile *file)
+{
+    g_return_val_if_fail (GHWP_IS_FILE (file), 0);
+
+    if (GHWP_FILE_GET_CLASS (file)->get_memory_usage == NULL)
+        return 0;
+
+    return GHWP_FILE_GET_CLASS (file)->get_memory_usage (file);
+}
+
 gchar *ghwp_file_get_hwp_version_string (GHWPFile *file)
 {
     g_return_val_if_fail (GHWP_IS_FILE (file), NULL);
@@ -99,82 +215,301 @@ GHWPFile *ghwp_file_new_from_uri (const gchar* uri, GError** error)
     return file;
 }
 
-static gboolean is_hwpml (gchar *haystack, gssize haystack_len)
+/* ASCII 대소문자를 구분하지 않는 memmem, needle 은 소문자여야 한다. */
+static const guint8 *
+_ghwp_memcasemem (const guint8 *haystack,
+                  gsize         haystack_len,
+                  const gchar  *needle,
+                  gsize         needle_len)
 {
-    gchar *ptr1;
-    gchar *ptr2;
-    gchar *lowercase       = g_utf8_strdown (haystack, haystack_len);
-    gchar *signature_xml   = g_utf8_strdown ("<?xml version=\"", 15);
-    gchar *signature_hwpml = g_utf8_strdown ("<HWPML Version=\"", 16);
+    gsize i, j;
+
+    if (needle_len == 0 || haystack_len < needle_len)
+        return NULL;
+
+    for (i = 0; i <= haystack_len - needle_len; i++) {
+        for (j = 0; j < needle_len; j++) {
+            if (g_ascii_tolower (haystack[i + j]) != needle[j])
+                break;
+        }
+        if (j == needle_len)
+            return haystack + i;
+    }
 
-    ptr1 = g_strstr_len (lowercase, haystack_len, signature_xml);
-    ptr2 = g_strstr_len (lowercase, haystack_len, signature_hwpml);
+    return NULL;
+}
 
-    g_free (lowercase);
-    g_free (signature_xml);
-    g_free (signature_hwpml);
+static gboolean is_hwpml (const guint8 *haystack, gsize haystack_len)
+{
+    static const gchar signature_xml[]   = "<?xml version=\"";
+    static const gchar signature_hwpml[] = "<hwpml version=\"";
+    const guint8 *ptr1;
+    const guint8 *ptr2;
 
-    if (ptr1 && ptr2 && (ptr1 < ptr2))
-        return TRUE;
-    else
+    ptr1 = _ghwp_memcasemem (haystack, haystack_len,
+                             signature_xml, sizeof (signature_xml) - 1);
+    if (ptr1 == NULL)
         return FALSE;
+
+    ptr2 = _ghwp_memcasemem (ptr1, haystack_len - (ptr1 - haystack),
+                             signature_hwpml, sizeof (signature_hwpml) - 1);
+
+    return ptr2 != NULL;
+}
+
+/* 포맷 판별에 사용하는 앞부분 크기 */
+#define GHWP_FILE_SNIFF_SIZE 4096
+
+static const guint8 signature_ole[] = {
+    0xd0, 0xcf, 0x11, 0xe0, 0xa1, 0xb1, 0x1a, 0xe1
+};
+
+static const guint8 signature_v3[] = {
+    /* HWP Document File V3.00 \x1a\1\2\3\4\5 */
+    0x48, 0x57, 0x50, 0x20, 0x44, 0x6f, 0x63, 0x75,
+    0x6d, 0x65, 0x6e, 0x74, 0x20, 0x46, 0x69, 0x6c,
+    0x65, 0x20, 0x56, 0x33, 0x2e, 0x30, 0x30, 0x20,
+    0x1a, 0x01, 0x02, 0x03, 0x04, 0x05
+};
+
+typedef enum
+{
+    HWP_FORMAT_INVALID,
+    HWP_FORMAT_V5,
+    HWP_FORMAT_V3,
+    HWP_FORMAT_ML
+} HWPFormat;
+
+static HWPFormat _ghwp_file_sniff (const guint8 *prefix, gsize prefix_len)
+{
+    if (prefix_len >= sizeof (signature_ole) &&
+        memcmp (prefix, signature_ole, sizeof (signature_ole)) == 0)
+        return HWP_FORMAT_V5;
+
+    if (prefix_len >= sizeof (signature_v3) &&
+        memcmp (prefix, signature_v3, sizeof (signature_v3)) == 0)
+        return HWP_FORMAT_V3;
+
+    if (is_hwpml (prefix, prefix_len))
+        return HWP_FORMAT_ML;
+
+    return HWP_FORMAT_INVALID;
+}
+
+/* input 을 이미 읽어둔 prefix 로 판별하여 알맞은 backend 에 넘긴다 */
+static GHWPFile *
+_ghwp_file_new_from_gsf_input (GsfInput     *input,
+                               const guint8 *prefix,
+                               gsize         prefix_len,
+                               GError      **error)
+{
+    HWPFormat format = _ghwp_file_sniff (prefix, prefix_len);
+
+    /* backend 는 처음부터 읽는다 */
+    gsf_input_seek (input, 0, G_SEEK_SET);
+
+    switch (format) {
+    case HWP_FORMAT_V5:
+        return GHWP_FILE (ghwp_file_v5_new_from_gsf_input (input, error));
+    case HWP_FORMAT_V3:
+        return GHWP_FILE (ghwp_file_v3_new_from_gsf_input (input, error));
+    case HWP_FORMAT_ML:
+        return GHWP_FILE (ghwp_file_ml_new_from_gsf_input (input, error));
+    default:
+        g_set_error_literal (error, GHWP_FILE_ERROR, GHWP_FILE_ERROR_INVALID,
+                             "invalid hwp file");
+        return NULL;
+    }
 }
 
 GHWPFile *ghwp_file_new_from_filename (const gchar* filename, GError** error)
 {
     g_return_val_if_fail (filename != NULL, NULL);
 
-    /* check signature */
-	static const guint8 const signature_ole[] = {
-        0xd0, 0xcf, 0x11, 0xe0, 0xa1, 0xb1, 0x1a, 0xe1
-    };
+    GsfInput     *input;
+    GHWPFile     *file;
+    const guint8 *prefix;
+    gsize         prefix_len;
 
-	static const guint8 signature_v3[] = {
-        /* HWP Document File V3.00 \x1a\1\2\3\4\5 */
-        0x48, 0x57, 0x50, 0x20, 0x44, 0x6f, 0x63, 0x75,
-        0x6d, 0x65, 0x6e, 0x74, 0x20, 0x46, 0x69, 0x6c,
-        0x65, 0x20, 0x56, 0x33, 0x2e, 0x30, 0x30, 0x20,
-        0x1a, 0x01, 0x02, 0x03, 0x04, 0x05
-    };
+    /* 파일은 한 번만 연다. 판별에 쓴 입력을 그대로 backend 에 넘긴다. */
+    input = gsf_input_stdio_new (filename, error);
 
-    GFile            *file   = g_file_new_for_path (filename);
-    GFileInputStream *stream = g_file_read(file, NULL, error);
+    if (input == NULL)
+        return NULL;
+
+    prefix_len = (gsize) MIN (gsf_input_size (input), GHWP_FILE_SNIFF_SIZE);
+    prefix     = gsf_input_read (input, prefix_len, NULL);
 
-    if (!stream)
+    if (prefix == NULL) {
+        g_set_error_literal (error, GHWP_FILE_ERROR, GHWP_FILE_ERROR_INVALID,
+                             "invalid hwp file");
+        g_object_unref (input);
         return NULL;
+    }
+
+    /* prefix 는 input 의 내부 버퍼를 가리키므로 판별이 끝난 뒤에
+     * backend 가 처음부터 다시 읽는다. 같은 핸들이므로 다시 열지 않는다. */
+    file = _ghwp_file_new_from_gsf_input (input, prefix, prefix_len, error);
+    g_object_unref (input);
 
-    gsize bytes_read = 0;
-    guint8 *buffer = g_malloc0 (4096);
-    g_input_stream_read_all (G_INPUT_STREAM(stream), buffer, 4096,
-                             &bytes_read, NULL, error);
-
-    if ( memcmp(buffer, signature_ole, sizeof(signature_ole)) == 0) {
-        /* hwp v5 */
-        g_free(buffer);
-        g_object_unref(stream);
-        return GHWP_FILE (ghwp_file_v5_new_from_filename (filename, error));
-    } else if ( memcmp(buffer, signature_v3, sizeof(signature_v3)) == 0) {
-        /* hwp v3 */
-        g_free(buffer);
-        g_object_unref(stream);
-        return GHWP_FILE (ghwp_file_v3_new_from_filename (filename, error));
-    } else if (is_hwpml((gchar *) buffer, bytes_read)) {
-        /* hwp ml */
-        g_free(buffer);
-        g_object_unref(stream);
-        return GHWP_FILE (ghwp_file_ml_new_from_filename (filename, error));
-    } else {
-        /* invalid hwp file */
-        *error = g_error_new (ghwp_file_error_quark(), GHWP_FILE_ERROR_INVALID,
-                              "invalid hwp file");
-        g_free(buffer);
-        g_object_unref(stream);
+    return file;
+}
+
+/**
+ * ghwp_file_new_from_bytes:
+ * @bytes: a #GBytes holding the whole HWP document
+ * @error: (allow-none): Return location for an error, or %NULL
+ *
+ * Creates a new #GHWPFile reading from @bytes.  The data is not copied;
+ * the returned file keeps a reference to @bytes until it is finalized.
+ * Any of HWP v5, HWP v3 and HWPML is accepted.
+ *
+ * Return value: A newly created #GHWPFile, or %NULL
+ **/
+GHWPFile *ghwp_file_new_from_bytes (GBytes *bytes, GError **error)
+{
+    g_return_val_if_fail (bytes != NULL, NULL);
+
+    gsize         size;
+    const guint8 *data = g_bytes_get_data (bytes, &size);
+    GsfInput     *input;
+    GHWPFile     *file;
+
+    if (size == 0) {
+        g_set_error_literal (error, GHWP_FILE_ERROR, GHWP_FILE_ERROR_INVALID,
+                             "invalid hwp file");
         return NULL;
     }
+
+    /* gsf_input_memory_new 는 버퍼를 복사하지 않는다. */
+    input = gsf_input_memory_new (data, (gsf_off_t) size, FALSE);
+    file  = _ghwp_file_new_from_gsf_input (input, data,
+                                           MIN (size, GHWP_FILE_SNIFF_SIZE),
+                                           error);
+    g_object_unref (input);
+
+    /* 버퍼의 수명을 file 에 묶는다 */
+    if (file)
+        file->priv->bytes = g_bytes_ref (bytes);
+
+    return file;
+}
+
+/**
+ * ghwp_file_new_from_stream:
+ * @stream: a #GInputStream positioned at the start of an HWP document
+ * @cancellable: (allow-none): optional #GCancellable object, %NULL to ignore
+ * @error: (allow-none): Return location for an error, or %NULL
+ *
+ * Creates a new #GHWPFile reading from @stream.  The format is detected
+ * from the first block before the rest of @stream is read, so that
+ * unsupported data is rejected early.  HWP v5 needs random access to the
+ * OLE container, hence the remaining data is read into memory once and
+ * handed to ghwp_file_new_from_bytes().
+ *
+ * Return value: A newly created #GHWPFile, or %NULL
+ **/
+GHWPFile *ghwp_file_new_from_stream (GInputStream *stream,
+                                     GCancellable *cancellable,
+                                     GError      **error)
+{
+    g_return_val_if_fail (G_IS_INPUT_STREAM (stream), NULL);
+
+    GByteArray *array = g_byte_array_sized_new (GHWP_FILE_SNIFF_SIZE);
+    gsize       chunk = GHWP_FILE_SNIFF_SIZE;
+    gsize       bytes_read;
+    guint       offset;
+    gboolean    eof;
+    GBytes     *bytes;
+    GHWPFile   *file;
+
+    do {
+        offset = array->len;
+        g_byte_array_set_size (array, offset + chunk);
+
+        if (!g_input_stream_read_all (stream, array->data + offset, chunk,
+                                      &bytes_read, cancellable, error)) {
+            g_byte_array_free (array, TRUE);
+            return NULL;
+        }
+
+        g_byte_array_set_size (array, offset + bytes_read);
+        eof = (bytes_read < chunk);
+
+        /* 첫 블록에서 포맷을 판별한다 */
+        if (offset == 0 &&
+            _ghwp_file_sniff (array->data, array->len) == HWP_FORMAT_INVALID) {
+            g_set_error_literal (error, GHWP_FILE_ERROR,
+                                 GHWP_FILE_ERROR_INVALID, "invalid hwp file");
+            g_byte_array_free (array, TRUE);
+            return NULL;
+        }
+
+        chunk = 65536;
+    } while (!eof);
+
+    bytes = g_byte_array_free_to_bytes (array);
+    file  = ghwp_file_new_from_bytes (bytes, error);
+    g_bytes_unref (bytes);
+
+    return file;
+}
+
+void _ghwp_file_set_cancellable (GHWPFile *file, GCancellable *cancellable)
+{
+    g_return_if_fail (GHWP_IS_FILE (file));
+
+    if (cancellable)
+        g_object_ref (cancellable);
+    if (file->priv->cancellable)
+        g_object_unref (file->priv->cancellable);
+    file->priv->cancellable = cancellable;
+}
+
+void _ghwp_file_set_progress_callback (GHWPFile            *file,
+                                       GHWPProgressCallback callback,
+                                       gpointer             user_data)
+{
+    g_return_if_fail (GHWP_IS_FILE (file));
+
+    file->priv->progress_callback = callback;
+    file->priv->progress_data     = user_data;
+}
+
+void _ghwp_file_report_progress (GHWPDocument *doc,
+                                 guint         n_done,
+                                 guint         n_total,
+                                 guint64       bytes_done,
+                                 guint64       bytes_total)
+{
+    g_return_if_fail (GHWP_IS_DOCUMENT (doc));
+
+    GHWPFile *file = doc->file;
+
+    if (file->priv->progress_callback)
+        file->priv->progress_callback (doc, n_done, n_total,
+                                       bytes_done, bytes_total,
+                                       file->priv->progress_data);
+
+    _ghwp_document_emit_load_progress (doc, n_done, n_total,
+                                       bytes_done, bytes_total);
 }
 
 static void ghwp_file_finalize (GObject *obj)
 {
+    GHWPFile *file = GHWP_FILE (obj);
+
+    if (file->priv->cancellable)
+        g_object_unref (file->priv->cancellable);
+
+    if (file->priv->bytes)
+        g_bytes_unref (file->priv->bytes);
+
+    if (file->priv->stats)
+        _ghwp_stats_data_unref (file->priv->stats);
+
+    g_mutex_clear (&file->priv->io_lock);
+
     G_OBJECT_CLASS (ghwp_file_parent_class)->finalize (obj);
 }
 
@@ -189,4 +524,9 @@ static void ghwp_file_init (GHWPFile *file)
 {
     file->priv = G_TYPE_INSTANCE_GET_PRIVATE (file, GHWP_TYPE_FILE,
                                                     GHWPFilePrivate);
+    g_mutex_init (&file->priv->io_lock);
+
+    _ghwp_stats_init ();
+    if (_ghwp_stats_enabled)
+        file->priv->stats = _ghwp_stats_data_new ();
 }
@@ -62,6 +62,19 @@ typedef enum {
 	GHWP_FILE_ERROR_INVALID
 } GHWPFileError;
 
+/**
+ * GHWPLoadFlags:
+ * @GHWP_LOAD_DEFAULT: read the text, tables and page layout only
+ * @GHWP_LOAD_CHAR_SHAPES: also read the character shape runs of each
+ *     paragraph, see ghwp_paragraph_get_char_shape_runs()
+ *
+ * What ghwp_file_get_document() reads besides the text.
+ */
+typedef enum {
+    GHWP_LOAD_DEFAULT     = 0,
+    GHWP_LOAD_CHAR_SHAPES = 1 << 0
+} GHWPLoadFlags;
+
 typedef struct _GHWPFileClass   GHWPFileClass;
 typedef struct _GHWPFilePrivate GHWPFilePrivate;
 
@@ -73,17 +86,40 @@ struct _GHWPFile {
 struct _GHWPFileClass {
     GObjectClass parent_class;
     GHWPDocument* (*get_document) (GHWPFile *file, GError **error);
+    void   (*load_document) (GHWPFile     *file,
+                             GHWPDocument *doc,
+                             GError      **error);
+    gboolean (*load_section) (GHWPFile *file,
+                              guint     index,
+                              GArray   *paragraphs,
+                              GArray   *page_ranges,
+                              GError  **error);
     gchar* (*get_hwp_version_string) (GHWPFile* file);
     void   (*get_hwp_version) (GHWPFile *file,
                                guint8   *major_version,
                                guint8   *minor_version,
                                guint8   *micro_version,
                                guint8   *extra_version);
+    gsize  (*get_memory_usage) (GHWPFile *file);
+    gboolean (*compute_content_hash) (GHWPFile     *file,
+                                      guint64      *hash,
+                                      GCancellable *cancellable,
+                                      GError      **error);
 };
 
 struct _GHWPFilePrivate {
-    GsfInfileMSOle *olefile;
-    GInputStream   *section_stream;
+    GsfInfileMSOle      *olefile;
+    GInputStream        *section_stream;
+    GBytes              *bytes;
+    /* OLE 하위 스트림은 같은 입력을 공유하므로 읽을 때 잠근다 */
+    GMutex               io_lock;
+    /* 문서를 읽는 동안에만 설정된다 */
+    GCancellable        *cancellable;
+    GHWPProgressCallback progress_callback;
+    gpointer             progress_data;
+    GHWPLoadFlags        load_flags;
+    /* 통계를 켠 뒤 연 파일에만 있다 */
+    struct _GHWPStatsData *stats;
 };
 
 GType         ghwp_file_get_type          (void) G_GNUC_CONST;
@@ -92,14 +128,48 @@ GHWPFile*     ghwp_file_new_from_uri      (const gchar* uri,
                                            GError**     error);
 GHWPFile*     ghwp_file_new_from_filename (const gchar* filename,
                                            GError**     error);
+GHWPFile*     ghwp_file_new_from_bytes    (GBytes      *bytes,
+                                           GError     **error);
+GHWPFile*     ghwp_file_new_from_stream   (GInputStream *stream,
+                                           GCancellable *cancellable,
+                                           GError      **error);
 GHWPDocument *ghwp_file_get_document      (GHWPFile    *file,
                                            GError     **error);
+void          ghwp_file_set_load_flags    (GHWPFile     *file,
+                                           GHWPLoadFlags flags);
+GHWPLoadFlags ghwp_file_get_load_flags    (GHWPFile     *file);
 gchar*        ghwp_file_get_hwp_version_string (GHWPFile* self);
 void          ghwp_file_get_hwp_version (GHWPFile *file,
                                          guint8   *major_version,
                                          guint8   *minor_version,
                                          guint8   *micro_version,
                                          guint8   *extra_version);
+gboolean      ghwp_file_compute_content_hash
+                                         (GHWPFile     *file,
+                                          guint64      *hash,
+                                          GCancellable *cancellable,
+                                          GError      **error);
+/* private */
+void          _ghwp_file_load_document   (GHWPFile     *file,
+                                          GHWPDocument *doc,
+                                          GError      **error);
+gboolean      _ghwp_file_load_section    (GHWPFile     *file,
+                                          guint         index,
+                                          GArray       *paragraphs,
+                                          GArray       *page_ranges,
+                                          GError      **error);
+void          _ghwp_file_set_cancellable (GHWPFile     *file,
+                                          GCancellable *cancellable);
+void          _ghwp_file_set_progress_callback
+                                         (GHWPFile            *file,
+                                          GHWPProgressCallback callback,
+                                          gpointer             user_data);
+void          _ghwp_file_report_progress (GHWPDocument *doc,
+                                          guint         n_done,
+                                          guint         n_total,
+                                          guint64       bytes_done,
+                                          guint64       bytes_total);
+gsize         _ghwp_file_get_memory_usage (GHWPFile    *file);
 
 G_END_DECLS
 
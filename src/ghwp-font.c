@@ -0,0 +1,481 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4; tab-width: 4 -*- */
+/*
+ * ghwp-font.c
+ *
+ * Copyright (C) 2013 Hodong Kim <cogniti@gmail.com>
+ *
+ * This library is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * 글꼴 찾기. DocInfo 의 글꼴 이름을 fontconfig 로 찾고, 없으면 언어마다
+ * 정해 둔 대체 글꼴로 넘어간다. 찾은 결과와 읽은 FT_Face 는 프로세스
+ * 전체가 함께 쓰고 참조 수를 센다. 천 개의 문서가 "바탕" 을 써도 FT_Face
+ * 는 하나다. 아무 문서도 쓰지 않게 된 글꼴도 최근 것 몇 개는 닫지 않고
+ * 남겨 두어, 문서를 하나씩 차례로 여는 경우에도 다시 읽지 않는다.
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <fontconfig/fontconfig.h>
+#include <cairo-ft.h>
+#include <ft2build.h>
+#include FT_FREETYPE_H
+
+#include "ghwp-font.h"
+
+typedef struct
+{
+    gchar *file; /* NULL 이면 찾지 못함 */
+    gint   index;
+    gchar *face_key;
+} Resolved;
+
+/* 쓰지 않는 글꼴을 이만큼 남겨 둔다 */
+#define GHWP_FONT_IDLE_FACES 32
+
+typedef struct
+{
+    const gchar       *key;       /* "file:index", g_intern_string */
+    gint               ref_count; /* _ghwp_font_get_face 가 내준 수 */
+    FT_Face            ft_face;
+    cairo_font_face_t *font_face; /* faces 가 참조 하나를 가진다 */
+    GList             *idle_link; /* ref_count 가 0 이면 idle_faces 에 */
+} FaceEntry;
+
+struct _GHWPFontSet
+{
+    gint                ref_count;
+    GMutex              lock;
+    GPtrArray          *names[GHWP_LANG_COUNT]; /* face id -> 이름들(strv) */
+    guint16            *face_ids;               /* char shape 마다 언어 수만큼 */
+    guint               n_char_shapes;
+    cairo_font_face_t **faces[GHWP_LANG_COUNT]; /* 처음 쓸 때 찾는다 */
+};
+
+/* 언어마다 fontconfig 언어 태그와 대체 글꼴 */
+static const struct
+{
+    const gchar *lang_tag;
+    const gchar *families[4];
+} fallbacks[GHWP_LANG_COUNT] = {
+    /* 한글 */ { "ko",    { "NanumGothic", "Noto Sans CJK KR", "UnDotum", NULL } },
+    /* 영문 */ { "en",    { "DejaVu Sans", "Liberation Sans", NULL } },
+    /* 한자 */ { "zh-tw", { "Noto Sans CJK KR", "UnBatang", "Noto Sans CJK TC", NULL } },
+    /* 일어 */ { "ja",    { "Noto Sans CJK JP", "IPAGothic", "TakaoGothic", NULL } },
+    /* 기타 */ { NULL,    { "DejaVu Sans", NULL } },
+    /* 기호 */ { NULL,    { "OpenSymbol", "DejaVu Sans", "Symbola", NULL } },
+    /* 사용자 */ { NULL,  { "DejaVu Sans", NULL } }
+};
+
+static GMutex                font_lock;
+static FT_Library            ft_lib   = NULL;
+static GHashTable           *resolved = NULL; /* 이름들, 언어 -> Resolved */
+static GHashTable           *faces    = NULL; /* "file:index" -> FaceEntry */
+static GQueue                idle_faces = G_QUEUE_INIT; /* 최근 것이 앞 */
+static cairo_user_data_key_t face_entry_key;
+
+static void _resolved_free (Resolved *res)
+{
+    g_free (res->file);
+    g_free (res->face_key);
+    g_slice_free (Resolved, res);
+}
+
+/* cairo 가 글꼴을 다 쓴 뒤에 불린다 */
+static void _face_entry_free (FaceEntry *entry)
+{
+    g_mutex_lock (&font_lock);
+    FT_Done_Face (entry->ft_face);
+    g_mutex_unlock (&font_lock);
+
+    g_slice_free (FaceEntry, entry);
+}
+
+static gboolean _ghwp_font_is_serif (const gchar *name)
+{
+    static const gchar *serif[] = {
+        "바탕", "명조", "궁서", "Batang", "Myeongjo", "Serif", "Times", NULL
+    };
+    guint i;
+
+    for (i = 0; serif[i]; i++)
+        if (strstr (name, serif[i]))
+            return TRUE;
+
+    return FALSE;
+}
+
+/* font_lock 을 잡은 상태에서 부른다 */
+static Resolved *_ghwp_font_resolve (const gchar * const *families,
+                                     GHWPLanguage         lang)
+{
+    Resolved  *res;
+    GString   *key = g_string_new (NULL);
+    FcPattern *pattern;
+    FcPattern *match;
+    FcResult   result;
+    FcChar8   *file;
+    gboolean   serif = FALSE;
+    guint      i;
+
+    g_string_append_printf (key, "%d", lang);
+    for (i = 0; families[i]; i++) {
+        g_string_append_c (key, '\x1f');
+        g_string_append (key, families[i]);
+    }
+
+    res = g_hash_table_lookup (resolved, key->str);
+    if (res) {
+        g_string_free (key, TRUE);
+        return res;
+    }
+
+    /* 앞의 이름일수록 먼저 고른다. family 가 lang 보다 우선한다. */
+    pattern = FcPatternCreate ();
+    for (i = 0; families[i]; i++) {
+        FcPatternAddString (pattern, FC_FAMILY, (const FcChar8 *) families[i]);
+        serif |= _ghwp_font_is_serif (families[i]);
+    }
+    for (i = 0; fallbacks[lang].families[i]; i++)
+        FcPatternAddString (pattern, FC_FAMILY,
+                            (const FcChar8 *) fallbacks[lang].families[i]);
+    FcPatternAddString (pattern, FC_FAMILY,
+                        (const FcChar8 *) (serif ? "serif" : "sans-serif"));
+    if (fallbacks[lang].lang_tag)
+        FcPatternAddString (pattern, FC_LANG,
+                            (const FcChar8 *) fallbacks[lang].lang_tag);
+
+    FcConfigSubstitute (NULL, pattern, FcMatchPattern);
+    FcDefaultSubstitute (pattern);
+    match = FcFontMatch (NULL, pattern, &result);
+    FcPatternDestroy (pattern);
+
+    res = g_slice_new0 (Resolved);
+    if (match && FcPatternGetString (match, FC_FILE, 0, &file) == FcResultMatch) {
+        res->file = g_strdup ((const gchar *) file);
+        if (FcPatternGetInteger (match, FC_INDEX, 0, &res->index) != FcResultMatch)
+            res->index = 0;
+        res->face_key = g_strdup_printf ("%s:%d", res->file, res->index);
+    }
+    if (match)
+        FcPatternDestroy (match);
+
+    g_hash_table_insert (resolved, g_string_free (key, FALSE), res);
+    return res;
+}
+
+static cairo_font_face_t *
+_ghwp_font_get_face_for_names (const gchar * const *families,
+                               GHWPLanguage         lang)
+{
+    Resolved          *res;
+    FaceEntry         *entry;
+    FT_Face            ft_face;
+    cairo_font_face_t *font_face;
+
+    g_mutex_lock (&font_lock);
+
+    if (resolved == NULL) {
+        FcInit ();
+        FT_Init_FreeType (&ft_lib);
+        resolved = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                          (GDestroyNotify) _resolved_free);
+        faces    = g_hash_table_new (g_str_hash, g_str_equal);
+    }
+
+    res = _ghwp_font_resolve (families, lang);
+    if (res->file == NULL) {
+        g_mutex_unlock (&font_lock);
+        return NULL;
+    }
+
+    entry = g_hash_table_lookup (faces, res->face_key);
+    if (entry == NULL) {
+        if (FT_New_Face (ft_lib, res->file, res->index, &ft_face) != 0) {
+            g_mutex_unlock (&font_lock);
+            g_warning ("cannot load font %s", res->file);
+            return NULL;
+        }
+
+        font_face = cairo_ft_font_face_create_for_ft_face (ft_face, 0);
+        entry = g_slice_new (FaceEntry);
+        entry->key       = g_intern_string (res->face_key);
+        entry->ref_count = 0;
+        entry->ft_face   = ft_face;
+        entry->font_face = font_face;
+        entry->idle_link = NULL;
+
+        /* 마지막 cairo 참조가 사라질 때 FT_Face 를 닫는다 */
+        if (cairo_font_face_set_user_data (font_face, &face_entry_key, entry,
+                                   (cairo_destroy_func_t) _face_entry_free)) {
+            g_mutex_unlock (&font_lock);
+            cairo_font_face_destroy (font_face);
+            FT_Done_Face (ft_face);
+            g_slice_free (FaceEntry, entry);
+            return NULL;
+        }
+        g_hash_table_insert (faces, (gpointer) entry->key, entry);
+    }
+
+    if (entry->idle_link) {
+        g_queue_delete_link (&idle_faces, entry->idle_link);
+        entry->idle_link = NULL;
+    }
+
+    entry->ref_count++;
+    font_face = cairo_font_face_reference (entry->font_face);
+
+    g_mutex_unlock (&font_lock);
+    return font_face;
+}
+
+/**
+ * _ghwp_font_get_face:
+ * @family: (allow-none): font family name as stored in the document
+ * @lang: language group the text belongs to
+ *
+ * Resolves @family through fontconfig, falling back to fonts that cover
+ * @lang.  Faces are shared by the whole process.
+ *
+ * Return value: a font face to release with _ghwp_font_release_face(),
+ *     or %NULL if no font was found
+ */
+cairo_font_face_t *_ghwp_font_get_face (const gchar  *family,
+                                        GHWPLanguage  lang)
+{
+    const gchar *families[2] = { family, NULL };
+
+    g_return_val_if_fail (lang < GHWP_LANG_COUNT, NULL);
+
+    return _ghwp_font_get_face_for_names (family && *family ? families
+                                                            : families + 1,
+                                          lang);
+}
+
+/* 마지막으로 놓인 글꼴은 바로 닫지 않고 idle_faces 에 넣는다. 넘치면
+ * 가장 오래 쓰지 않은 것을 faces 에서 빼고 닫는다. */
+void _ghwp_font_release_face (cairo_font_face_t *face)
+{
+    g_return_if_fail (face != NULL);
+
+    FaceEntry         *entry = cairo_font_face_get_user_data (face,
+                                                              &face_entry_key);
+    cairo_font_face_t *evicted = NULL;
+
+    g_return_if_fail (entry != NULL);
+
+    g_mutex_lock (&font_lock);
+    if (--entry->ref_count == 0) {
+        g_queue_push_head (&idle_faces, entry);
+        entry->idle_link = idle_faces.head;
+
+        if (idle_faces.length > GHWP_FONT_IDLE_FACES) {
+            FaceEntry *oldest = g_queue_pop_tail (&idle_faces);
+            oldest->idle_link = NULL;
+            g_hash_table_remove (faces, oldest->key);
+            evicted = oldest->font_face;
+        }
+    }
+    g_mutex_unlock (&font_lock);
+
+    /* _face_entry_free 가 font_lock 을 잡으므로 풀고 나서 부른다 */
+    cairo_font_face_destroy (face);
+    if (evicted)
+        cairo_font_face_destroy (evicted);
+}
+
+/**
+ * _ghwp_font_get_face_id:
+ * @face: a font face
+ *
+ * Return value: an interned string naming the font file of @face, which
+ *     stays the same when the face is closed and loaded again, or %NULL
+ *     if @face was not made by _ghwp_font_get_face()
+ */
+const gchar *_ghwp_font_get_face_id (cairo_font_face_t *face)
+{
+    FaceEntry *entry;
+
+    g_return_val_if_fail (face != NULL, NULL);
+
+    entry = cairo_font_face_get_user_data (face, &face_entry_key);
+    return entry ? entry->key : NULL;
+}
+
+/**
+ * _ghwp_font_get_default_face:
+ *
+ * Return value: (transfer none): the face used when a document names no
+ *     font, valid for the life of the process
+ */
+cairo_font_face_t *_ghwp_font_get_default_face (void)
+{
+    static gsize face = 0;
+
+    if (g_once_init_enter (&face)) {
+        cairo_font_face_t *tmp = _ghwp_font_get_face (NULL, GHWP_LANG_HANGUL);
+        if (tmp == NULL)
+            tmp = cairo_toy_font_face_create ("sans-serif",
+                                              CAIRO_FONT_SLANT_NORMAL,
+                                              CAIRO_FONT_WEIGHT_NORMAL);
+        g_once_init_leave (&face, (gsize) tmp);
+    }
+
+    return (cairo_font_face_t *) face;
+}
+
+/* 공백, 숫자, 문장 부호는 앞 글자의 언어를 따른다 */
+GHWPLanguage _ghwp_font_get_language (gunichar c, GHWPLanguage prev)
+{
+    switch (g_unichar_get_script (c)) {
+    case G_UNICODE_SCRIPT_HANGUL:
+        return GHWP_LANG_HANGUL;
+    case G_UNICODE_SCRIPT_HAN:
+        return GHWP_LANG_HANJA;
+    case G_UNICODE_SCRIPT_HIRAGANA:
+    case G_UNICODE_SCRIPT_KATAKANA:
+        return GHWP_LANG_JAPANESE;
+    case G_UNICODE_SCRIPT_LATIN:
+        return GHWP_LANG_LATIN;
+    case G_UNICODE_SCRIPT_COMMON:
+    case G_UNICODE_SCRIPT_INHERITED:
+        switch (g_unichar_type (c)) {
+        case G_UNICODE_MATH_SYMBOL:
+        case G_UNICODE_OTHER_SYMBOL:
+            return GHWP_LANG_SYMBOL;
+        default:
+            return prev;
+        }
+    default:
+        return GHWP_LANG_OTHER;
+    }
+}
+
+/**
+ * _ghwp_font_set_new:
+ * @info: (allow-none): a #GHWPDocInfo
+ *
+ * Copies the face names and character shape font ids of @info, so the
+ * set stays valid after the document is freed.  Faces are resolved the
+ * first time they are asked for.
+ */
+GHWPFontSet *_ghwp_font_set_new (GHWPDocInfo *info)
+{
+    GHWPFontSet *set = g_slice_new0 (GHWPFontSet);
+    guint        lang, i;
+
+    set->ref_count = 1;
+    g_mutex_init (&set->lock);
+
+    for (lang = 0; lang < GHWP_LANG_COUNT; lang++) {
+        guint n = info ? ghwp_doc_info_get_n_face_names (info, lang) : 0;
+
+        set->names[lang] = g_ptr_array_new_full (n, (GDestroyNotify) g_strfreev);
+        for (i = 0; i < n; i++) {
+            const GHWPFaceName *face = ghwp_doc_info_get_face_name (info, lang, i);
+            gchar             **strv = g_new0 (gchar *, 4);
+            guint               k    = 0;
+
+            if (face && face->name && *face->name)
+                strv[k++] = g_strdup (face->name);
+            if (face && face->alt_name && *face->alt_name)
+                strv[k++] = g_strdup (face->alt_name);
+            if (face && face->base_name && *face->base_name)
+                strv[k++] = g_strdup (face->base_name);
+            g_ptr_array_add (set->names[lang], strv);
+        }
+        set->faces[lang] = g_new0 (cairo_font_face_t *, MAX (n, 1));
+    }
+
+    set->n_char_shapes = info ? ghwp_doc_info_get_n_char_shapes (info) : 0;
+    set->face_ids = g_new (guint16, set->n_char_shapes * GHWP_LANG_COUNT + 1);
+    for (i = 0; i < set->n_char_shapes; i++) {
+        const GHWPCharShape *shape = ghwp_doc_info_get_char_shape (info, i);
+        memcpy (set->face_ids + i * GHWP_LANG_COUNT, shape->face_ids,
+                sizeof (shape->face_ids));
+    }
+
+    return set;
+}
+
+GHWPFontSet *_ghwp_font_set_ref (GHWPFontSet *set)
+{
+    g_return_val_if_fail (set != NULL, NULL);
+    g_atomic_int_inc (&set->ref_count);
+    return set;
+}
+
+void _ghwp_font_set_unref (GHWPFontSet *set)
+{
+    g_return_if_fail (set != NULL);
+
+    cairo_font_face_t *fallback;
+    guint              lang, i;
+
+    if (!g_atomic_int_dec_and_test (&set->ref_count))
+        return;
+
+    fallback = _ghwp_font_get_default_face ();
+    for (lang = 0; lang < GHWP_LANG_COUNT; lang++) {
+        for (i = 0; i < set->names[lang]->len; i++)
+            if (set->faces[lang][i] && set->faces[lang][i] != fallback)
+                _ghwp_font_release_face (set->faces[lang][i]);
+        g_free (set->faces[lang]);
+        g_ptr_array_unref (set->names[lang]);
+    }
+    g_free (set->face_ids);
+    g_mutex_clear (&set->lock);
+    g_slice_free (GHWPFontSet, set);
+}
+
+/**
+ * _ghwp_font_set_get_face:
+ * @set: (allow-none): a #GHWPFontSet
+ * @char_shape_id: character shape of the text
+ * @lang: language group of the text
+ *
+ * Return value: (transfer none): the face for text in @char_shape_id and
+ *     @lang, valid while @set is alive
+ */
+cairo_font_face_t *_ghwp_font_set_get_face (GHWPFontSet  *set,
+                                            guint         char_shape_id,
+                                            GHWPLanguage  lang)
+{
+    cairo_font_face_t *face;
+    guint              face_id = 0;
+
+    if (set == NULL || lang >= GHWP_LANG_COUNT)
+        return _ghwp_font_get_default_face ();
+
+    if (char_shape_id < set->n_char_shapes)
+        face_id = set->face_ids[char_shape_id * GHWP_LANG_COUNT + lang];
+
+    if (face_id >= set->names[lang]->len)
+        return _ghwp_font_get_default_face ();
+
+    g_mutex_lock (&set->lock);
+    face = set->faces[lang][face_id];
+    if (face == NULL) {
+        face = _ghwp_font_get_face_for_names (
+                   g_ptr_array_index (set->names[lang], face_id), lang);
+        if (face == NULL)
+            face = _ghwp_font_get_default_face ();
+        set->faces[lang][face_id] = face;
+    }
+    g_mutex_unlock (&set->lock);
+
+    return face;
+}
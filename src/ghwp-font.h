@@ -0,0 +1,51 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4; tab-width: 4 -*- */
+/*
+ * ghwp-font.h
+ *
+ * Copyright (C) 2013 Hodong Kim <cogniti@gmail.com>
+ *
+ * This library is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GHWP_FONT_H__
+#define __GHWP_FONT_H__
+
+#include <glib-object.h>
+#include <cairo.h>
+
+#include "ghwp-doc-info.h"
+
+G_BEGIN_DECLS
+
+typedef struct _GHWPFontSet GHWPFontSet;
+
+/* private */
+cairo_font_face_t *_ghwp_font_get_face         (const gchar  *family,
+                                                GHWPLanguage  lang);
+void               _ghwp_font_release_face     (cairo_font_face_t *face);
+const gchar       *_ghwp_font_get_face_id      (cairo_font_face_t *face);
+cairo_font_face_t *_ghwp_font_get_default_face (void);
+GHWPLanguage       _ghwp_font_get_language     (gunichar      c,
+                                                GHWPLanguage  prev);
+
+GHWPFontSet       *_ghwp_font_set_new          (GHWPDocInfo  *info);
+GHWPFontSet       *_ghwp_font_set_ref          (GHWPFontSet  *set);
+void               _ghwp_font_set_unref        (GHWPFontSet  *set);
+cairo_font_face_t *_ghwp_font_set_get_face     (GHWPFontSet  *set,
+                                                guint         char_shape_id,
+                                                GHWPLanguage  lang);
+
+G_END_DECLS
+
+#endif /* __GHWP_FONT_H__ */
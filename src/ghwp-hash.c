@@ -0,0 +1,169 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4; tab-width: 4 -*- */
+/*
+ * ghwp-hash.c
+ *
+ * Copyright (C) 2013 Hodong Kim <cogniti@gmail.com>
+ *
+ * This library is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/*
+ * 내용 지문에 쓰는 XXH64. 암호용이 아니며 빠른 것이 목적이다.
+ * 입력은 언제나 little-endian 으로 읽으므로 어느 기계에서나 같은 값이다.
+ */
+
+#include <string.h>
+
+#include "ghwp-hash.h"
+
+#define PRIME64_1 G_GUINT64_CONSTANT (0x9E3779B185EBCA87)
+#define PRIME64_2 G_GUINT64_CONSTANT (0xC2B2AE3D27D4EB4F)
+#define PRIME64_3 G_GUINT64_CONSTANT (0x165667B19E3779F9)
+#define PRIME64_4 G_GUINT64_CONSTANT (0x85EBCA77C2B2AE63)
+#define PRIME64_5 G_GUINT64_CONSTANT (0x27D4EB2F165667C5)
+
+#define ROTL64(x, r) (((x) << (r)) | ((x) >> (64 - (r))))
+
+static inline guint64 _read64 (const guint8 *p)
+{
+    guint64 v;
+    memcpy (&v, p, sizeof v);
+    return GUINT64_FROM_LE (v);
+}
+
+static inline guint32 _read32 (const guint8 *p)
+{
+    guint32 v;
+    memcpy (&v, p, sizeof v);
+    return GUINT32_FROM_LE (v);
+}
+
+static inline guint64 _round (guint64 acc, guint64 input)
+{
+    acc += input * PRIME64_2;
+    acc  = ROTL64 (acc, 31);
+    return acc * PRIME64_1;
+}
+
+static inline guint64 _merge_round (guint64 acc, guint64 val)
+{
+    acc ^= _round (0, val);
+    return acc * PRIME64_1 + PRIME64_4;
+}
+
+/* 32 바이트 단위로 v 에 섞는다. 남은 바이트 수를 돌려준다 */
+static gsize _consume (guint64 *v, const guint8 *p, gsize len)
+{
+    while (len >= 32) {
+        v[0] = _round (v[0], _read64 (p));
+        v[1] = _round (v[1], _read64 (p + 8));
+        v[2] = _round (v[2], _read64 (p + 16));
+        v[3] = _round (v[3], _read64 (p + 24));
+        p   += 32;
+        len -= 32;
+    }
+    return len;
+}
+
+void _ghwp_hash64_init (GHWPHash64 *state, guint64 seed)
+{
+    g_return_if_fail (state != NULL);
+
+    memset (state, 0, sizeof (GHWPHash64));
+    state->v[0] = seed + PRIME64_1 + PRIME64_2;
+    state->v[1] = seed + PRIME64_2;
+    state->v[2] = seed;
+    state->v[3] = seed - PRIME64_1;
+}
+
+void _ghwp_hash64_update (GHWPHash64    *state,
+                          gconstpointer  data,
+                          gsize          len)
+{
+    g_return_if_fail (state != NULL);
+    g_return_if_fail (data != NULL || len == 0);
+
+    const guint8 *p = data;
+    gsize         rest;
+
+    state->total_len += len;
+
+    /* 앞서 남은 것과 합쳐도 32 바이트가 안 되면 모아 둔다 */
+    if (state->mem_size + len < 32) {
+        memcpy (state->mem + state->mem_size, p, len);
+        state->mem_size += len;
+        return;
+    }
+
+    if (state->mem_size > 0) {
+        gsize fill = 32 - state->mem_size;
+        memcpy (state->mem + state->mem_size, p, fill);
+        _consume (state->v, state->mem, 32);
+        p   += fill;
+        len -= fill;
+        state->mem_size = 0;
+    }
+
+    rest = _consume (state->v, p, len);
+    memcpy (state->mem, p + len - rest, rest);
+    state->mem_size = rest;
+}
+
+guint64 _ghwp_hash64_digest (const GHWPHash64 *state)
+{
+    g_return_val_if_fail (state != NULL, 0);
+
+    const guint8 *p   = state->mem;
+    const guint8 *end = state->mem + state->mem_size;
+    guint64       h;
+
+    if (state->total_len >= 32) {
+        h = ROTL64 (state->v[0], 1)  + ROTL64 (state->v[1], 7) +
+            ROTL64 (state->v[2], 12) + ROTL64 (state->v[3], 18);
+        h = _merge_round (h, state->v[0]);
+        h = _merge_round (h, state->v[1]);
+        h = _merge_round (h, state->v[2]);
+        h = _merge_round (h, state->v[3]);
+    } else {
+        /* v[2] 는 seed 그대로다 */
+        h = state->v[2] + PRIME64_5;
+    }
+
+    h += state->total_len;
+
+    for (; p + 8 <= end; p += 8) {
+        h ^= _round (0, _read64 (p));
+        h  = ROTL64 (h, 27) * PRIME64_1 + PRIME64_4;
+    }
+
+    if (p + 4 <= end) {
+        h ^= (guint64) _read32 (p) * PRIME64_1;
+        h  = ROTL64 (h, 23) * PRIME64_2 + PRIME64_3;
+        p += 4;
+    }
+
+    for (; p < end; p++) {
+        h ^= *p * PRIME64_5;
+        h  = ROTL64 (h, 11) * PRIME64_1;
+    }
+
+    h ^= h >> 33;
+    h *= PRIME64_2;
+    h ^= h >> 29;
+    h *= PRIME64_3;
+    h ^= h >> 32;
+
+    return h;
+}
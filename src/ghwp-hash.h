@@ -0,0 +1,47 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4; tab-width: 4 -*- */
+/*
+ * ghwp-hash.h
+ *
+ * Copyright (C) 2013 Hodong Kim <cogniti@gmail.com>
+ *
+ * This library is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef __GHWP_HASH_H__
+#define __GHWP_HASH_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* XXH64, 조금씩 나누어 넣어도 한 번에 넣은 것과 같은 값이 나온다 */
+typedef struct
+{
+    guint64 total_len;
+    guint64 v[4];
+    guint8  mem[32];
+    guint   mem_size;
+} GHWPHash64;
+
+/* private */
+void    _ghwp_hash64_init   (GHWPHash64       *state, guint64 seed);
+void    _ghwp_hash64_update (GHWPHash64       *state,
+                             gconstpointer     data,
+                             gsize             len);
+guint64 _ghwp_hash64_digest (const GHWPHash64 *state);
+
+G_END_DECLS
+
+#endif /* __GHWP_HASH_H__ */
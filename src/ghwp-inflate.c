@@ -0,0 +1,327 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4; tab-width: 4 -*- */
+/*
+ * ghwp-inflate.c
+ *
+ * Copyright (C) 2013 Hodong Kim <cogniti@gmail.com>
+ *
+ * This library is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * DocInfo, BodyText/SectionN, BinData 의 raw deflate 를 푼다.
+ * libdeflate 가 있으면 압축된 스트림을 처음 읽을 때 통째로 읽어 한 번에
+ * 풀고, 이후 읽기는 메모리 복사로 끝난다. 한 번에 풀 수 없는 스트림
+ * (잘린 파일 등)은 예전처럼 zlib 으로 풀 수 있는 데까지 푼다.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#ifdef HAVE_LIBDEFLATE
+#include <libdeflate.h>
+#endif
+
+#include "ghwp-inflate.h"
+
+/* 압축을 푼 크기는 저장되어 있지 않으므로 이만큼 잡고 모자라면 늘린다 */
+#define GHWP_INFLATE_GUESS(size) ((size) * 4 + 4096)
+
+static GInputStream *
+_ghwp_inflate_converter_stream_new (GInputStream  *base,
+                                    GHWPStatsData *stats)
+{
+    GConverter   *converter;
+    GInputStream *stream;
+
+    converter = (GConverter *) g_zlib_decompressor_new (
+                                              G_ZLIB_COMPRESSOR_FORMAT_RAW);
+    if (stats) {
+        GConverter *timed = _ghwp_stats_converter_new (converter, stats);
+        g_object_unref (converter);
+        converter = timed;
+    }
+
+    stream = g_converter_input_stream_new (base, converter);
+    g_object_unref (converter);
+
+    return stream;
+}
+
+#ifdef HAVE_LIBDEFLATE
+/* 실패하면 NULL, 성공하면 딱 맞는 크기로 줄인 버퍼 */
+static guint8 *_ghwp_inflate_whole (const guint8 *data,
+                                    gsize         size,
+                                    gsize        *out_size)
+{
+    struct libdeflate_decompressor *decompressor;
+    enum libdeflate_result          result;
+    gsize                           avail = GHWP_INFLATE_GUESS (size);
+    guint8                         *out;
+
+    decompressor = libdeflate_alloc_decompressor ();
+    if (decompressor == NULL)
+        return NULL;
+
+    for (;;) {
+        out    = g_malloc (avail);
+        result = libdeflate_deflate_decompress (decompressor, data, size,
+                                                out, avail, out_size);
+        if (result != LIBDEFLATE_INSUFFICIENT_SPACE)
+            break;
+        g_free (out);
+        avail *= 2;
+    }
+
+    libdeflate_free_decompressor (decompressor);
+
+    if (result != LIBDEFLATE_SUCCESS) {
+        g_free (out);
+        return NULL;
+    }
+
+    return g_realloc (out, MAX (*out_size, 1));
+}
+
+/** GHWPInflateStream *********************************************************/
+
+/* 처음 읽을 때 base 를 다 읽어 한 번에 푼다. 그 전에는 버퍼도 zlib 상태도
+ * 잡지 않는다. */
+typedef struct
+{
+    GInputStream   parent_instance;
+    GInputStream  *base;
+    gsize          compressed_size;
+    GHWPStatsData *stats;
+    gboolean       loaded;
+    guint8        *data;
+    gsize          size;
+    gsize          pos;
+    GInputStream  *fallback; /* 한 번에 풀지 못했을 때 */
+} GHWPInflateStream;
+
+typedef struct
+{
+    GInputStreamClass parent_class;
+} GHWPInflateStreamClass;
+
+G_DEFINE_TYPE (GHWPInflateStream, _ghwp_inflate_stream, G_TYPE_INPUT_STREAM);
+
+static gboolean _ghwp_inflate_stream_load (GHWPInflateStream *self,
+                                           GCancellable      *cancellable,
+                                           GError           **error)
+{
+    guint8 *compressed;
+    gsize   n_read;
+    gint64  start;
+
+    self->loaded = TRUE;
+    compressed   = g_malloc (MAX (self->compressed_size, 1));
+
+    if (!g_input_stream_read_all (self->base, compressed,
+                                  self->compressed_size, &n_read,
+                                  cancellable, error)) {
+        g_free (compressed);
+        return FALSE;
+    }
+    g_clear_object (&self->base);
+
+    start      = g_get_monotonic_time ();
+    self->data = _ghwp_inflate_whole (compressed, n_read, &self->size);
+    if (self->data) {
+        _ghwp_stats_add_inflate (self->stats,
+                                 g_get_monotonic_time () - start, self->size);
+        g_free (compressed);
+        return TRUE;
+    }
+
+    /* 잘린 스트림은 zlib 으로 풀 수 있는 데까지 푼다 */
+    GBytes       *bytes  = g_bytes_new_take (compressed, n_read);
+    GInputStream *memory = g_memory_input_stream_new_from_bytes (bytes);
+
+    self->fallback = _ghwp_inflate_converter_stream_new (memory, self->stats);
+    g_object_unref (memory);
+    g_bytes_unref (bytes);
+
+    return TRUE;
+}
+
+static gssize _ghwp_inflate_stream_read (GInputStream  *stream,
+                                         void          *buffer,
+                                         gsize          count,
+                                         GCancellable  *cancellable,
+                                         GError       **error)
+{
+    GHWPInflateStream *self = (GHWPInflateStream *) stream;
+    gsize              n;
+
+    if (!self->loaded &&
+        !_ghwp_inflate_stream_load (self, cancellable, error))
+        return -1;
+
+    if (self->fallback)
+        return g_input_stream_read (self->fallback, buffer, count,
+                                    cancellable, error);
+
+    n = MIN (count, self->size - self->pos);
+    if (n > 0)
+        memcpy (buffer, self->data + self->pos, n);
+    self->pos += n;
+
+    return (gssize) n;
+}
+
+static gssize _ghwp_inflate_stream_skip (GInputStream  *stream,
+                                         gsize          count,
+                                         GCancellable  *cancellable,
+                                         GError       **error)
+{
+    GHWPInflateStream *self = (GHWPInflateStream *) stream;
+    gsize              n;
+
+    if (!self->loaded &&
+        !_ghwp_inflate_stream_load (self, cancellable, error))
+        return -1;
+
+    if (self->fallback)
+        return g_input_stream_skip (self->fallback, count,
+                                    cancellable, error);
+
+    n = MIN (count, self->size - self->pos);
+    self->pos += n;
+
+    return (gssize) n;
+}
+
+/* 다 읽은 구역의 내용을 바로 놓아 준다 */
+static gboolean _ghwp_inflate_stream_close (GInputStream  *stream,
+                                            GCancellable  *cancellable,
+                                            GError       **error)
+{
+    GHWPInflateStream *self = (GHWPInflateStream *) stream;
+
+    g_clear_object (&self->base);
+    g_clear_object (&self->fallback);
+    g_free (self->data);
+    self->data   = NULL;
+    self->size   = 0;
+    self->pos    = 0;
+    self->loaded = TRUE;
+
+    return TRUE;
+}
+
+static void _ghwp_inflate_stream_finalize (GObject *obj)
+{
+    GHWPInflateStream *self = (GHWPInflateStream *) obj;
+
+    g_clear_object (&self->base);
+    g_clear_object (&self->fallback);
+    g_free (self->data);
+    if (self->stats)
+        _ghwp_stats_data_unref (self->stats);
+    G_OBJECT_CLASS (_ghwp_inflate_stream_parent_class)->finalize (obj);
+}
+
+static void _ghwp_inflate_stream_class_init (GHWPInflateStreamClass *klass)
+{
+    GInputStreamClass *stream_class = G_INPUT_STREAM_CLASS (klass);
+
+    G_OBJECT_CLASS (klass)->finalize = _ghwp_inflate_stream_finalize;
+    stream_class->read_fn  = _ghwp_inflate_stream_read;
+    stream_class->skip     = _ghwp_inflate_stream_skip;
+    stream_class->close_fn = _ghwp_inflate_stream_close;
+}
+
+static void _ghwp_inflate_stream_init (GHWPInflateStream *self)
+{
+}
+#endif /* HAVE_LIBDEFLATE */
+
+/* base 의 raw deflate 를 푸는 새 스트림. compressed_size 는 base 의
+ * 바이트 수, stats 가 있으면 푸는 데 든 시간을 센다. */
+GInputStream *_ghwp_inflate_stream_new (GInputStream  *base,
+                                        gsize          compressed_size,
+                                        GHWPStatsData *stats)
+{
+    g_return_val_if_fail (G_IS_INPUT_STREAM (base), NULL);
+
+#ifdef HAVE_LIBDEFLATE
+    GHWPInflateStream *self;
+
+    self = g_object_new (_ghwp_inflate_stream_get_type (), NULL);
+    self->base            = g_object_ref (base);
+    self->compressed_size = compressed_size;
+    self->stats           = stats ? _ghwp_stats_data_ref (stats) : NULL;
+
+    return G_INPUT_STREAM (self);
+#else
+    return _ghwp_inflate_converter_stream_new (base, stats);
+#endif
+}
+
+/* 다 읽은 raw deflate 를 푼다. 실패하면 NULL */
+GBytes *_ghwp_inflate_bytes (const guint8 *data, gsize size, GError **error)
+{
+    GZlibDecompressor *zd;
+    GByteArray        *out;
+    GConverterResult   result;
+    GError            *tmp_error = NULL;
+    gsize              n_read, n_written;
+    gsize              filled    = 0;
+
+#ifdef HAVE_LIBDEFLATE
+    guint8 *whole = _ghwp_inflate_whole (data, size, &filled);
+    if (whole)
+        return g_bytes_new_take (whole, filled);
+    filled = 0;
+#endif
+
+    zd  = g_zlib_decompressor_new (G_ZLIB_COMPRESSOR_FORMAT_RAW);
+    out = g_byte_array_new ();
+    g_byte_array_set_size (out, (guint) GHWP_INFLATE_GUESS (size));
+
+    for (;;) {
+        result = g_converter_convert (G_CONVERTER (zd),
+                                      data, size,
+                                      out->data + filled, out->len - filled,
+                                      G_CONVERTER_INPUT_AT_END,
+                                      &n_read, &n_written, &tmp_error);
+
+        if (result == G_CONVERTER_ERROR) {
+            if (!g_error_matches (tmp_error, G_IO_ERROR,
+                                  G_IO_ERROR_NO_SPACE)) {
+                g_propagate_error (error, tmp_error);
+                g_object_unref (zd);
+                g_byte_array_unref (out);
+                return NULL;
+            }
+            g_clear_error (&tmp_error);
+            n_read = n_written = 0;
+        }
+
+        filled += n_written;
+        data   += n_read;
+        size   -= n_read;
+
+        if (result == G_CONVERTER_FINISHED)
+            break;
+        /* 입력을 모두 넘겼으므로 끝나지 않았다면 출력 공간이 모자란 것이다 */
+        g_byte_array_set_size (out, out->len * 2);
+    }
+
+    g_object_unref (zd);
+    g_byte_array_set_size (out, (guint) filled);
+    return g_byte_array_free_to_bytes (out);
+}
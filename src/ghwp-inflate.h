@@ -0,0 +1,41 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4; tab-width: 4 -*- */
+/*
+ * ghwp-inflate.h
+ *
+ * Copyright (C) 2013 Hodong Kim <cogniti@gmail.com>
+ *
+ * This library is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GHWP_INFLATE_H__
+#define __GHWP_INFLATE_H__
+
+#include <glib-object.h>
+#include <gio/gio.h>
+
+#include "ghwp.h"
+
+G_BEGIN_DECLS
+
+/* private */
+GInputStream *_ghwp_inflate_stream_new (GInputStream  *base,
+                                        gsize          compressed_size,
+                                        GHWPStatsData *stats);
+GBytes       *_ghwp_inflate_bytes      (const guint8  *data,
+                                        gsize          size,
+                                        GError       **error);
+
+G_END_DECLS
+
+#endif /* __GHWP_INFLATE_H__ */
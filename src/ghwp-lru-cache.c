@@ -0,0 +1,246 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4; tab-width: 4 -*- */
+/*
+ * ghwp-lru-cache.c
+ *
+ * Copyright (C) 2013 Hodong Kim <cogniti@gmail.com>
+ *
+ * This library is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * 비용(바이트 수 등) 합계가 max_cost 를 넘지 않도록 가장 오래 쓰지 않은
+ * 항목부터 버리는 캐시. 모든 함수는 여러 스레드에서 불러도 된다.
+ */
+
+#include "ghwp-lru-cache.h"
+
+typedef struct
+{
+    gpointer key;
+    gpointer value;
+    gsize    cost;
+} Entry;
+
+struct _GHWPLRUCache
+{
+    GMutex          lock;
+    GHashTable     *table; /* key -> GList (queue 의 링크) */
+    GQueue          queue; /* head 가 가장 최근 */
+    gsize           cost;
+    gsize           max_cost;
+    GDestroyNotify  key_destroy_func;
+    GBoxedCopyFunc  value_ref_func;
+    GDestroyNotify  value_destroy_func;
+};
+
+static void _entry_free (GHWPLRUCache *cache, Entry *entry)
+{
+    if (cache->key_destroy_func)
+        cache->key_destroy_func (entry->key);
+    if (cache->value_destroy_func)
+        cache->value_destroy_func (entry->value);
+    g_slice_free (Entry, entry);
+}
+
+/* lock 을 잡은 상태에서 부른다 */
+static void _unlink (GHWPLRUCache *cache, GList *link)
+{
+    Entry *entry = link->data;
+
+    g_hash_table_remove (cache->table, entry->key);
+    g_queue_delete_link (&cache->queue, link);
+    cache->cost -= entry->cost;
+    _entry_free (cache, entry);
+}
+
+static void _evict (GHWPLRUCache *cache)
+{
+    while (cache->cost > cache->max_cost && cache->queue.tail)
+        _unlink (cache, cache->queue.tail);
+}
+
+/**
+ * _ghwp_lru_cache_new:
+ * @hash_func: hash function for keys
+ * @key_equal_func: equality function for keys
+ * @key_destroy_func: (allow-none): called on keys when an entry goes away
+ * @value_ref_func: (allow-none): used by _ghwp_lru_cache_lookup() to return
+ *     a new reference, so the value survives being evicted by another thread
+ * @value_destroy_func: (allow-none): called on values when an entry goes away
+ * @max_cost: total cost the cache may hold
+ *
+ * Return value: a new #GHWPLRUCache
+ */
+GHWPLRUCache *_ghwp_lru_cache_new (GHashFunc      hash_func,
+                                   GEqualFunc     key_equal_func,
+                                   GDestroyNotify key_destroy_func,
+                                   GBoxedCopyFunc value_ref_func,
+                                   GDestroyNotify value_destroy_func,
+                                   gsize          max_cost)
+{
+    GHWPLRUCache *cache = g_slice_new0 (GHWPLRUCache);
+
+    g_mutex_init (&cache->lock);
+    cache->table              = g_hash_table_new (hash_func, key_equal_func);
+    cache->max_cost           = max_cost;
+    cache->key_destroy_func   = key_destroy_func;
+    cache->value_ref_func     = value_ref_func;
+    cache->value_destroy_func = value_destroy_func;
+
+    return cache;
+}
+
+void _ghwp_lru_cache_free (GHWPLRUCache *cache)
+{
+    if (cache == NULL)
+        return;
+
+    _ghwp_lru_cache_clear (cache);
+    g_hash_table_unref (cache->table);
+    g_mutex_clear (&cache->lock);
+    g_slice_free (GHWPLRUCache, cache);
+}
+
+/* 찾으면 가장 최근으로 옮긴다 */
+gpointer _ghwp_lru_cache_lookup (GHWPLRUCache *cache, gconstpointer key)
+{
+    g_return_val_if_fail (cache != NULL, NULL);
+
+    GList   *link;
+    gpointer value = NULL;
+
+    g_mutex_lock (&cache->lock);
+    link = g_hash_table_lookup (cache->table, key);
+    if (link) {
+        Entry *entry = link->data;
+
+        g_queue_unlink (&cache->queue, link);
+        g_queue_push_head_link (&cache->queue, link);
+
+        value = cache->value_ref_func ? cache->value_ref_func (entry->value)
+                                      : entry->value;
+    }
+    g_mutex_unlock (&cache->lock);
+
+    return value;
+}
+
+/* key, value 의 소유권을 가져간다. cost 가 max_cost 보다 크면 넣지 않고
+ * 바로 해제한다. */
+void _ghwp_lru_cache_insert (GHWPLRUCache *cache,
+                             gpointer      key,
+                             gpointer      value,
+                             gsize         cost)
+{
+    g_return_if_fail (cache != NULL);
+
+    Entry *entry;
+    GList *link;
+
+    entry        = g_slice_new (Entry);
+    entry->key   = key;
+    entry->value = value;
+    entry->cost  = cost;
+
+    g_mutex_lock (&cache->lock);
+
+    if (cost > cache->max_cost) {
+        _entry_free (cache, entry);
+        g_mutex_unlock (&cache->lock);
+        return;
+    }
+
+    link = g_hash_table_lookup (cache->table, key);
+    if (link)
+        _unlink (cache, link);
+
+    g_queue_push_head (&cache->queue, entry);
+    g_hash_table_insert (cache->table, entry->key, cache->queue.head);
+    cache->cost += cost;
+    _evict (cache);
+
+    g_mutex_unlock (&cache->lock);
+}
+
+void _ghwp_lru_cache_remove (GHWPLRUCache *cache, gconstpointer key)
+{
+    g_return_if_fail (cache != NULL);
+
+    GList *link;
+
+    g_mutex_lock (&cache->lock);
+    link = g_hash_table_lookup (cache->table, key);
+    if (link)
+        _unlink (cache, link);
+    g_mutex_unlock (&cache->lock);
+}
+
+void _ghwp_lru_cache_clear (GHWPLRUCache *cache)
+{
+    g_return_if_fail (cache != NULL);
+
+    g_mutex_lock (&cache->lock);
+    while (cache->queue.tail)
+        _unlink (cache, cache->queue.tail);
+    g_mutex_unlock (&cache->lock);
+}
+
+void _ghwp_lru_cache_set_max_cost (GHWPLRUCache *cache, gsize max_cost)
+{
+    g_return_if_fail (cache != NULL);
+
+    g_mutex_lock (&cache->lock);
+    cache->max_cost = max_cost;
+    _evict (cache);
+    g_mutex_unlock (&cache->lock);
+}
+
+gsize _ghwp_lru_cache_get_max_cost (GHWPLRUCache *cache)
+{
+    g_return_val_if_fail (cache != NULL, 0);
+
+    gsize max_cost;
+
+    g_mutex_lock (&cache->lock);
+    max_cost = cache->max_cost;
+    g_mutex_unlock (&cache->lock);
+
+    return max_cost;
+}
+
+gsize _ghwp_lru_cache_get_cost (GHWPLRUCache *cache)
+{
+    g_return_val_if_fail (cache != NULL, 0);
+
+    gsize cost;
+
+    g_mutex_lock (&cache->lock);
+    cost = cache->cost;
+    g_mutex_unlock (&cache->lock);
+
+    return cost;
+}
+
+guint _ghwp_lru_cache_get_size (GHWPLRUCache *cache)
+{
+    g_return_val_if_fail (cache != NULL, 0);
+
+    guint size;
+
+    g_mutex_lock (&cache->lock);
+    size = cache->queue.length;
+    g_mutex_unlock (&cache->lock);
+
+    return size;
+}
@@ -0,0 +1,55 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4; tab-width: 4 -*- */
+/*
+ * ghwp-lru-cache.h
+ *
+ * Copyright (C) 2013 Hodong Kim <cogniti@gmail.com>
+ *
+ * This library is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GHWP_LRU_CACHE_H__
+#define __GHWP_LRU_CACHE_H__
+
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GHWPLRUCache GHWPLRUCache;
+
+/* private */
+GHWPLRUCache *_ghwp_lru_cache_new          (GHashFunc       hash_func,
+                                            GEqualFunc      key_equal_func,
+                                            GDestroyNotify  key_destroy_func,
+                                            GBoxedCopyFunc  value_ref_func,
+                                            GDestroyNotify  value_destroy_func,
+                                            gsize           max_cost);
+void          _ghwp_lru_cache_free         (GHWPLRUCache   *cache);
+gpointer      _ghwp_lru_cache_lookup       (GHWPLRUCache   *cache,
+                                            gconstpointer   key);
+void          _ghwp_lru_cache_insert       (GHWPLRUCache   *cache,
+                                            gpointer        key,
+                                            gpointer        value,
+                                            gsize           cost);
+void          _ghwp_lru_cache_remove       (GHWPLRUCache   *cache,
+                                            gconstpointer   key);
+void          _ghwp_lru_cache_clear        (GHWPLRUCache   *cache);
+void          _ghwp_lru_cache_set_max_cost (GHWPLRUCache   *cache,
+                                            gsize           max_cost);
+gsize         _ghwp_lru_cache_get_max_cost (GHWPLRUCache   *cache);
+gsize         _ghwp_lru_cache_get_cost     (GHWPLRUCache   *cache);
+guint         _ghwp_lru_cache_get_size     (GHWPLRUCache   *cache);
+
+G_END_DECLS
+
+#endif /* __GHWP_LRU_CACHE_H__ */
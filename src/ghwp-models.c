@@ -25,11 +25,20 @@
  * 한글과컴퓨터의 한/글 문서 파일(.hwp) 공개 문서를 참고하여 개발하였습니다.
  */
 
+#include <string.h>
 #include <glib/gprintf.h>
 
 #include "ghwp-models.h"
 
 #define _g_free0(var) (var = (g_free (var), NULL))
+#define _g_object_unref0(var) ((var == NULL) ? NULL : (var = (g_object_unref (var), NULL)))
+
+/* GArray 의 clear func, 원소는 GObject 포인터 */
+static void _g_object_unref_element (gpointer element)
+{
+    GObject **object = element;
+    _g_object_unref0 (*object);
+}
 
 /** GHWPText *****************************************************************/
 
@@ -83,6 +92,10 @@ GHWPParagraph *ghwp_paragraph_new (void)
 
 static void ghwp_paragraph_finalize (GObject *obj)
 {
+    GHWPParagraph *paragraph = GHWP_PARAGRAPH (obj);
+    _g_object_unref0 (paragraph->ghwp_text);
+    _g_object_unref0 (paragraph->table);
+    _g_free0 (paragraph->char_shape_runs);
     G_OBJECT_CLASS (ghwp_paragraph_parent_class)->finalize (obj);
 }
 
@@ -96,11 +109,14 @@ static void ghwp_paragraph_init (GHWPParagraph *paragraph)
 {
 }
 
+/* ghwp_text 의 소유권을 가져간다 */
 void
 ghwp_paragraph_set_ghwp_text (GHWPParagraph *paragraph, GHWPText *ghwp_text)
 {
     g_return_if_fail (paragraph != NULL);
     g_return_if_fail (ghwp_text != NULL);
+    if (paragraph->ghwp_text != ghwp_text)
+        _g_object_unref0 (paragraph->ghwp_text);
     paragraph->ghwp_text = ghwp_text;
 }
 
@@ -110,10 +126,13 @@ GHWPText *ghwp_paragraph_get_ghwp_text (GHWPParagraph *paragraph)
     return paragraph->ghwp_text;
 }
 
+/* table 의 소유권을 가져간다 */
 void ghwp_paragraph_set_table (GHWPParagraph *paragraph, GHWPTable *table)
 {
     g_return_if_fail (paragraph != NULL);
     g_return_if_fail (table     != NULL);
+    if (paragraph->table != table)
+        _g_object_unref0 (paragraph->table);
     paragraph->table = table;
 }
 
@@ -123,6 +142,41 @@ GHWPTable *ghwp_paragraph_get_table (GHWPParagraph *paragraph)
     return paragraph->table;
 }
 
+/**
+ * ghwp_paragraph_get_char_shape_runs:
+ * @paragraph: a #GHWPParagraph
+ * @n_runs: (out): return location for the number of runs
+ *
+ * Returns the character shape runs of @paragraph, sorted by offset.
+ * Run i covers the bytes of the text from runs[i].offset up to
+ * runs[i + 1].offset, or up to the end of the text for the last run.
+ * Look up char_shape_id with ghwp_doc_info_get_char_shape().  Runs are
+ * only read when the file was loaded with %GHWP_LOAD_CHAR_SHAPES.
+ *
+ * Return value: (transfer none): the runs, or %NULL if there are none
+ */
+const GHWPCharShapeRun *
+ghwp_paragraph_get_char_shape_runs (GHWPParagraph *paragraph, guint *n_runs)
+{
+    g_return_val_if_fail (paragraph != NULL, NULL);
+    g_return_val_if_fail (n_runs    != NULL, NULL);
+
+    *n_runs = paragraph->n_char_shape_runs;
+    return paragraph->char_shape_runs;
+}
+
+/* runs 의 소유권을 가져간다 */
+void ghwp_paragraph_set_char_shape_runs (GHWPParagraph    *paragraph,
+                                         GHWPCharShapeRun *runs,
+                                         guint             n_runs)
+{
+    g_return_if_fail (paragraph != NULL);
+
+    _g_free0 (paragraph->char_shape_runs);
+    paragraph->char_shape_runs   = runs;
+    paragraph->n_char_shape_runs = runs ? n_runs : 0;
+}
+
 /** GHWPTable ****************************************************************/
 
 G_DEFINE_TYPE (GHWPTable, ghwp_table, G_TYPE_OBJECT);
@@ -200,12 +254,24 @@ static void
 ghwp_table_init (GHWPTable *table)
 {
     table->cells = g_array_new (TRUE, TRUE, sizeof (GHWPTableCell *));
+    g_array_set_clear_func (table->cells, _g_object_unref_element);
+}
+
+static void _ghwp_table_layout_free (GHWPTableLayout *layout)
+{
+    if (layout == NULL)
+        return;
+
+    g_free (layout->col_offsets);
+    g_free (layout->row_offsets);
+    g_slice_free (GHWPTableLayout, layout);
 }
 
 static void
 ghwp_table_finalize (GObject *object)
 {
     GHWPTable *table = GHWP_TABLE(object);
+    _ghwp_table_layout_free (table->layout);
     _g_free0 (table->row_sizes);
     _g_free0 (table->zones);
     g_array_free (table->cells, TRUE);
@@ -226,11 +292,131 @@ GHWPTableCell *ghwp_table_get_last_cell (GHWPTable *table)
                           table->cells->len - 1);
 }
 
+/* cell 의 소유권을 가져간다 */
 void ghwp_table_add_cell (GHWPTable *table, GHWPTableCell *cell)
 {
     g_return_if_fail (table != NULL);
     g_return_if_fail (cell  != NULL);
     g_array_append_val (table->cells, cell);
+    /* 다시 계산해야 한다 */
+    _ghwp_table_layout_free (table->layout);
+    table->layout = NULL;
+}
+
+/* 셀의 끝 열(행) 순서로 정렬하기 위해 쓴다 */
+static gint _compare_col_end (gconstpointer a, gconstpointer b)
+{
+    const GHWPTableCell *c1 = *(GHWPTableCell **) a;
+    const GHWPTableCell *c2 = *(GHWPTableCell **) b;
+    return (c1->col_addr + c1->col_span) - (c2->col_addr + c2->col_span);
+}
+
+static gint _compare_row_end (gconstpointer a, gconstpointer b)
+{
+    const GHWPTableCell *c1 = *(GHWPTableCell **) a;
+    const GHWPTableCell *c2 = *(GHWPTableCell **) b;
+    return (c1->row_addr + c1->row_span) - (c2->row_addr + c2->row_span);
+}
+
+/*
+ * 셀의 폭(높이)과 병합 정보로 열(행) 경계를 구한다.
+ * 끝 열이 작은 셀부터 처리하면 셀의 시작 경계는 이미 정해져 있으므로
+ * offsets[끝] = max (offsets[끝], offsets[시작] + 크기 + 셀 간격) 한 번으로 된다.
+ */
+static void _ghwp_table_resolve_offsets (GPtrArray *cells,
+                                         gdouble   *offsets,
+                                         guint      n,
+                                         gboolean   is_col,
+                                         gdouble    spacing)
+{
+    guint i, k = 0;
+
+    g_ptr_array_sort (cells, is_col ? _compare_col_end : _compare_row_end);
+
+    for (i = 0; i < cells->len; i++) {
+        GHWPTableCell *cell  = g_ptr_array_index (cells, i);
+        guint          start = is_col ? cell->col_addr : cell->row_addr;
+        guint          span  = is_col ? cell->col_span : cell->row_span;
+        gdouble        size  = (is_col ? cell->width : cell->height) / 100.0;
+        guint          end;
+
+        if (start >= n)
+            continue;
+        end = MIN (start + MAX (span, 1), n);
+
+        /* 앞 경계들은 단조 증가해야 한다 */
+        for (; k < end; k++)
+            offsets[k + 1] = MAX (offsets[k + 1], offsets[k]);
+
+        offsets[end] = MAX (offsets[end], offsets[start] + size + spacing);
+    }
+
+    for (; k < n; k++)
+        offsets[k + 1] = MAX (offsets[k + 1], offsets[k]);
+}
+
+/**
+ * ghwp_table_get_layout:
+ * @table: a #GHWPTable
+ *
+ * Resolves column and row boundaries from the cell sizes, spans and
+ * cell spacing, and stores each cell's rectangle in its x, y,
+ * layout_width and layout_height fields.  The result is cached on
+ * @table until another cell is added.  The loader computes it before
+ * the page holding @table is published, so readers on other threads
+ * only see the cached value.
+ *
+ * Return value: (transfer none): the layout of @table
+ */
+const GHWPTableLayout *ghwp_table_get_layout (GHWPTable *table)
+{
+    g_return_val_if_fail (GHWP_IS_TABLE (table), NULL);
+
+    GHWPTableLayout *layout;
+    GPtrArray       *cells;
+    gdouble          spacing = table->cell_spacing / 100.0;
+    guint            i;
+
+    if (table->layout)
+        return table->layout;
+
+    layout = g_slice_new0 (GHWPTableLayout);
+    layout->col_offsets = g_new0 (gdouble, table->n_cols + 1);
+    layout->row_offsets = g_new0 (gdouble, table->n_rows + 1);
+
+    /* 정렬은 복사본에서 한다. cells 의 순서는 파일 순서를 유지한다. */
+    cells = g_ptr_array_sized_new (table->cells->len);
+    for (i = 0; i < table->cells->len; i++)
+        g_ptr_array_add (cells, g_array_index (table->cells,
+                                               GHWPTableCell *, i));
+
+    _ghwp_table_resolve_offsets (cells, layout->col_offsets,
+                                 table->n_cols, TRUE, spacing);
+    _ghwp_table_resolve_offsets (cells, layout->row_offsets,
+                                 table->n_rows, FALSE, spacing);
+    g_ptr_array_unref (cells);
+
+    layout->width  = layout->col_offsets[table->n_cols];
+    layout->height = layout->row_offsets[table->n_rows];
+
+    for (i = 0; i < table->cells->len; i++) {
+        GHWPTableCell *cell = g_array_index (table->cells, GHWPTableCell *, i);
+        guint col_end, row_end;
+
+        if (cell->col_addr >= table->n_cols || cell->row_addr >= table->n_rows)
+            continue;
+
+        col_end = MIN (cell->col_addr + MAX (cell->col_span, 1), table->n_cols);
+        row_end = MIN (cell->row_addr + MAX (cell->row_span, 1), table->n_rows);
+
+        cell->x             = layout->col_offsets[cell->col_addr];
+        cell->y             = layout->row_offsets[cell->row_addr];
+        cell->layout_width  = layout->col_offsets[col_end] - cell->x - spacing;
+        cell->layout_height = layout->row_offsets[row_end] - cell->y - spacing;
+    }
+
+    table->layout = layout;
+    return layout;
 }
 
 /** GHWPTableCell ************************************************************/
@@ -241,6 +427,7 @@ static void
 ghwp_table_cell_init (GHWPTableCell *cell)
 {
     cell->paragraphs = g_array_new (TRUE, TRUE, sizeof (GHWPParagraph *));
+    g_array_set_clear_func (cell->paragraphs, _g_object_unref_element);
 }
 
 static void
@@ -318,6 +505,7 @@ GHWPParagraph *ghwp_table_cell_get_last_paragraph (GHWPTableCell *cell)
                           cell->paragraphs->len - 1);
 }
 
+/* paragraph 의 소유권을 가져간다 */
 void
 ghwp_table_cell_add_paragraph (GHWPTableCell *cell, GHWPParagraph *paragraph)
 {
@@ -325,3 +513,48 @@ ghwp_table_cell_add_paragraph (GHWPTableCell *cell, GHWPParagraph *paragraph)
     g_return_if_fail (paragraph  != NULL);
     g_array_append_val (cell->paragraphs, paragraph);
 }
+
+/* private
+ * paragraph 와 그 아래의 표, 셀, 문단이 차지하는 바이트 수를 더한다.
+ * 글자는 text_bytes 에, 나머지는 model_bytes 에 더한다. */
+void _ghwp_paragraph_add_memory_usage (GHWPParagraph *paragraph,
+                                       gsize         *text_bytes,
+                                       gsize         *model_bytes)
+{
+    g_return_if_fail (GHWP_IS_PARAGRAPH (paragraph));
+
+    GHWPTable *table = paragraph->table;
+    guint      i, j;
+
+    *model_bytes += sizeof (GHWPParagraph) +
+                    paragraph->n_char_shape_runs * sizeof (GHWPCharShapeRun);
+
+    if (paragraph->ghwp_text) {
+        *model_bytes += sizeof (GHWPText);
+        if (paragraph->ghwp_text->text)
+            *text_bytes += strlen (paragraph->ghwp_text->text) + 1;
+    }
+
+    if (table == NULL)
+        return;
+
+    *model_bytes += sizeof (GHWPTable) +
+                    table->n_rows * sizeof (guint16) +
+                    table->valid_zone_info_size * sizeof (guint16) +
+                    table->cells->len * sizeof (GHWPTableCell *);
+    if (table->layout)
+        *model_bytes += sizeof (GHWPTableLayout) +
+                        (table->n_cols + table->n_rows + 2) * sizeof (gdouble);
+
+    for (i = 0; i < table->cells->len; i++) {
+        GHWPTableCell *cell = g_array_index (table->cells, GHWPTableCell *, i);
+
+        *model_bytes += sizeof (GHWPTableCell) +
+                        cell->paragraphs->len * sizeof (GHWPParagraph *);
+
+        for (j = 0; j < cell->paragraphs->len; j++)
+            _ghwp_paragraph_add_memory_usage (
+                g_array_index (cell->paragraphs, GHWPParagraph *, j),
+                text_bytes, model_bytes);
+    }
+}
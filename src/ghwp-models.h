@@ -48,12 +48,22 @@ typedef struct _GHWPTableCell GHWPTableCell;
 
 typedef struct _GHWPParagraph      GHWPParagraph;
 typedef struct _GHWPParagraphClass GHWPParagraphClass;
+typedef struct _GHWPCharShapeRun   GHWPCharShapeRun;
+
+/* 글자 모양이 바뀌는 위치. offset 은 ghwp_text->text 의 UTF-8 바이트 위치 */
+struct _GHWPCharShapeRun
+{
+    guint32 offset;
+    guint32 char_shape_id;
+};
 
 struct _GHWPParagraph
 {
-    GObject    parent_instance;
-    GHWPText  *ghwp_text;
-    GHWPTable *table;
+    GObject           parent_instance;
+    GHWPText         *ghwp_text;
+    GHWPTable        *table;
+    GHWPCharShapeRun *char_shape_runs;
+    guint             n_char_shape_runs;
 };
 
 struct _GHWPParagraphClass
@@ -69,6 +79,14 @@ GHWPText      *ghwp_paragraph_get_ghwp_text (GHWPParagraph *paragraph);
 GHWPTable     *ghwp_paragraph_get_table     (GHWPParagraph *paragraph);
 void           ghwp_paragraph_set_table     (GHWPParagraph *paragraph,
                                              GHWPTable     *table);
+const GHWPCharShapeRun *
+               ghwp_paragraph_get_char_shape_runs
+                                            (GHWPParagraph *paragraph,
+                                             guint         *n_runs);
+void           ghwp_paragraph_set_char_shape_runs
+                                            (GHWPParagraph    *paragraph,
+                                             GHWPCharShapeRun *runs,
+                                             guint             n_runs);
 
 /** GHWPText *****************************************************************/
 
@@ -108,8 +126,18 @@ GHWPText *ghwp_text_append   (GHWPText *ghwp_text, const gchar *text);
 #define GHWP_IS_TABLE_CLASS(klass)  (G_TYPE_CHECK_CLASS_TYPE ((klass), GHWP_TYPE_TABLE))
 #define GHWP_TABLE_GET_CLASS(obj)   (G_TYPE_INSTANCE_GET_CLASS ((obj), GHWP_TYPE_TABLE, GHWPTableClass))
 
-typedef struct _GHWPTable      GHWPTable;
-typedef struct _GHWPTableClass GHWPTableClass;
+typedef struct _GHWPTable       GHWPTable;
+typedef struct _GHWPTableClass  GHWPTableClass;
+typedef struct _GHWPTableLayout GHWPTableLayout;
+
+/* 표 배치 결과, 단위는 point (1pt = 100 hwpunit), 표의 왼쪽 위가 원점 */
+struct _GHWPTableLayout
+{
+    gdouble  width;
+    gdouble  height;
+    gdouble *col_offsets; /* n_cols + 1 개 */
+    gdouble *row_offsets; /* n_rows + 1 개 */
+};
 
 struct _GHWPTableClass
 {
@@ -129,12 +157,15 @@ struct _GHWPTable
     guint16  top_margin;
     guint16  bottom_margin;
 
-    guint16 *row_sizes;
+    guint16 *row_sizes; /* 행마다 셀 개수 */
     guint16  border_fill_id;
     guint16  valid_zone_info_size;
     guint16 *zones;
 
     GArray  *cells;
+
+    /* ghwp_table_get_layout 이 처음 불릴 때 계산한다 */
+    GHWPTableLayout *layout;
 };
 
 GType          ghwp_table_get_type         (void) G_GNUC_CONST;
@@ -143,6 +174,8 @@ GHWPTable     *ghwp_table_new_from_context (GHWPContext   *context);
 GHWPTableCell *ghwp_table_get_last_cell    (GHWPTable     *table);
 void           ghwp_table_add_cell         (GHWPTable     *table,
                                             GHWPTableCell *cell);
+const GHWPTableLayout *
+               ghwp_table_get_layout       (GHWPTable     *table);
 
 /** GHWPTableCell ************************************************************/
 
@@ -180,6 +213,12 @@ struct _GHWPTableCell
     guint16 border_fill_id;
 
     GArray *paragraphs;
+
+    /* ghwp_table_get_layout 이 채운다, 단위는 point, 표 기준 */
+    gdouble x;
+    gdouble y;
+    gdouble layout_width;
+    gdouble layout_height;
 };
 
 struct _GHWPTableCellClass
@@ -194,6 +233,11 @@ GHWPParagraph *ghwp_table_cell_get_last_paragraph (GHWPTableCell *cell);
 void           ghwp_table_cell_add_paragraph      (GHWPTableCell *cell,
                                                    GHWPParagraph *paragraph);
 
+/* private */
+void _ghwp_paragraph_add_memory_usage (GHWPParagraph *paragraph,
+                                       gsize         *text_bytes,
+                                       gsize         *model_bytes);
+
 G_END_DECLS
 
 #endif /* __GHWP_MODELS_H__ */
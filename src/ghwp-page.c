@@ -18,11 +18,26 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <string.h>
+
 #include "ghwp-page.h"
+#include "ghwp-shape.h"
+#include "ghwp-font.h"
+#include "ghwp-lru-cache.h"
+
+/* 모든 페이지의 기록을 합쳐 이 크기까지 캐시한다 */
+#define GHWP_PAGE_DISPLAY_LIST_CACHE_SIZE (32 * 1024 * 1024)
 
 G_DEFINE_TYPE (GHWPPage, ghwp_page, G_TYPE_OBJECT);
 
 #define _g_free0(var) (var = (g_free (var), NULL))
+#define _g_object_unref0(var) ((var == NULL) ? NULL : (var = (g_object_unref (var), NULL)))
+
+static void _g_object_unref_element (gpointer element)
+{
+    GObject **object = element;
+    _g_object_unref0 (*object);
+}
 
 void ghwp_page_get_size (GHWPPage *page,
                          gdouble  *width,
@@ -33,68 +48,179 @@ void ghwp_page_get_size (GHWPPage *page,
     *height = 842.0;
 }
 
-#include <cairo-ft.h>
-#include <ft2build.h>
-#include FT_FREETYPE_H
+/* 글자 묶음 하나가 차지하는 상자, 좌표는 pt */
+typedef struct
+{
+    gdouble        x1, y1, x2, y2;
+    GHWPParagraph *paragraph;
+    guint          offset;    /* 문단 글자의 바이트 위치 */
+    guint          length;
+    guint          line;      /* 페이지 안의 줄 번호 */
+} TextBox;
+
+/* 줄 높이(16pt) 단위로 나눈 격자. 줄마다 겹치는 상자 번호를 오름차순으로
+ * 모아 두어, 점에서 가까운 상자를 그 근처 줄만 보고 찾는다. */
+#define GHWP_PAGE_GRID_ROW 16.0
 
-static FT_Library ft_lib;
-static FT_Face    ft_face;
-/*한 번만 초기화, 로드 */
-static void
-once_ft_init_and_new (void)
+struct _GHWPPageTextIndex
 {
-    static gsize ft_init = 0;
+    GArray *boxes;     /* TextBox, 읽는 차례 */
+    guint   n_rows;
+    guint  *row_start; /* n_rows + 1 */
+    guint  *row_boxes;
+};
 
-    if (g_once_init_enter (&ft_init)) {
+/* 한 번 그리는 동안 쓰는 글꼴 상태. 글꼴이 바뀔 때만 scaled font 를
+ * 다시 만든다. */
+typedef struct
+{
+    cairo_t              *cr;
+    GHWPFontSet          *fonts;
+    cairo_matrix_t        font_matrix;
+    cairo_matrix_t        ctm;
+    cairo_font_options_t *font_options;
+    cairo_font_face_t    *font_face;
+    cairo_scaled_font_t  *scaled_font;
+    /* 기록한 그리기 명령의 크기를 어림한다 */
+    gsize                 n_glyphs;
+    gsize                 n_ops;
+    /* 글자 상자를 모을 때만 NULL 이 아니다 */
+    GArray               *boxes;
+    GHWPParagraph        *paragraph;
+    guint                 line;
+} TextContext;
 
-        FT_Init_FreeType (&ft_lib);
-        FT_New_Face (ft_lib, "/usr/share/fonts/truetype/nanum/NanumGothic.ttf",
-                     0, &ft_face);
+static void _text_context_set_font_face (TextContext       *ctx,
+                                         cairo_font_face_t *font_face)
+{
+    if (ctx->font_face == font_face)
+        return;
 
-        g_once_init_leave (&ft_init, (gsize)1);
-    }
+    if (ctx->scaled_font)
+        cairo_scaled_font_destroy (ctx->scaled_font);
+    ctx->font_face   = font_face;
+    ctx->scaled_font = cairo_scaled_font_create (font_face, &ctx->font_matrix,
+                                                 &ctx->ctm, ctx->font_options);
+    cairo_set_scaled_font (ctx->cr, ctx->scaled_font);
 }
 
-static void draw_text(cairo_t             *cr,
-                      cairo_text_extents_t extents,
-                      cairo_glyph_t       *glyphs,
-                      cairo_scaled_font_t *scaled_font,
-                      const gchar         *text,
-                      double              *x,
-                      double              *y)
-{
-    gchar *ch = NULL;
-    int    num_glyphs;
-    guint  j;
-    for (j = 0; j < g_utf8_strlen(text, -1); j++) {
-        ch = g_utf8_substring(text, j, j+1);
-
-        cairo_scaled_font_text_to_glyphs (scaled_font, *x, *y, ch, -1,
-                                          &glyphs, &num_glyphs,
-                                          NULL, NULL, NULL);
-        _g_free0 (ch);
-        cairo_glyph_extents(cr, glyphs, num_glyphs, &extents);
-
-        if (*x >= 595.0 - extents.x_advance - 20.0) {
-            glyphs[0].x  = 20.0;
-            glyphs[0].y += 16.0;
-            *x  = 20.0 + extents.x_advance;
-            *y += 16.0;
+/* 글자열을 통째로 셰이핑하고, 글자 묶음(cluster) 단위로 줄을 바꾼다 */
+static void draw_run(TextContext *ctx,
+                     const gchar *text,
+                     gsize        length,
+                     double       left,
+                     double       right,
+                     double      *x,
+                     double      *y)
+{
+    GHWPShapedRun *run = _ghwp_shape_text (ctx->scaled_font, text, length);
+    cairo_glyph_t *glyphs;
+    guint          i, j;
+
+    if (run->n_glyphs > 0) {
+        glyphs = cairo_glyph_allocate (run->n_glyphs);
+
+        for (i = 0; i < run->n_glyphs; i++) {
+            GHWPShapedGlyph *glyph = &run->glyphs[i];
+
+            if (i == 0 || glyph->cluster != run->glyphs[i - 1].cluster) {
+                double advance = 0.0;
+                for (j = i; j < run->n_glyphs &&
+                            run->glyphs[j].cluster == glyph->cluster; j++)
+                    advance += run->glyphs[j].x_advance;
+
+                if (*x >= right - advance && *x > left) {
+                    *x  = left;
+                    *y += 16.0;
+                    ctx->line++;
+                }
+
+                if (ctx->boxes) {
+                    TextBox box;
+                    guint   end = j < run->n_glyphs ? run->glyphs[j].cluster
+                                                    : (guint) length;
+                    box.x1        = *x;
+                    box.y1        = *y - 12.0;
+                    box.x2        = *x + advance;
+                    box.y2        = *y + 4.0;
+                    box.paragraph = ctx->paragraph;
+                    box.offset    = (guint) (text - ctx->paragraph->ghwp_text->text) +
+                                    glyph->cluster;
+                    box.length    = end > glyph->cluster ? end - glyph->cluster : 1;
+                    box.line      = ctx->line;
+                    g_array_append_val (ctx->boxes, box);
+                }
+            }
+
+            glyphs[i].index = glyph->index;
+            glyphs[i].x     = *x + glyph->x_offset;
+            glyphs[i].y     = *y + glyph->y_offset;
+            *x += glyph->x_advance;
         }
-        else {
-            *x += extents.x_advance;
+
+        cairo_show_glyphs (ctx->cr, glyphs, run->n_glyphs);
+        ctx->n_glyphs += run->n_glyphs;
+        ctx->n_ops++;
+        cairo_glyph_free (glyphs);
+    }
+
+    _ghwp_shaped_run_unref (run);
+}
+
+/* 글자 모양과 언어가 같은 구간마다 글꼴을 골라 그린다 */
+static void draw_text(TextContext   *ctx,
+                      GHWPParagraph *paragraph,
+                      double         left,
+                      double         right,
+                      double        *x,
+                      double        *y)
+{
+    const gchar            *text  = paragraph->ghwp_text->text;
+    const gchar            *start = text;
+    const gchar            *p;
+    const GHWPCharShapeRun *runs;
+    guint                   n_runs, r = 0;
+    guint                   shape_id  = 0;
+    GHWPLanguage            lang      = GHWP_LANG_HANGUL;
+
+    ctx->paragraph = paragraph;
+    ctx->line++;
+
+    runs = ghwp_paragraph_get_char_shape_runs (paragraph, &n_runs);
+    if (n_runs > 0)
+        shape_id = runs[0].char_shape_id;
+
+    for (p = text; *p; p = g_utf8_next_char (p)) {
+        guint32      offset = (guint32) (p - text);
+        guint        next_shape = shape_id;
+        GHWPLanguage next_lang;
+
+        while (r + 1 < n_runs && runs[r + 1].offset <= offset)
+            next_shape = runs[++r].char_shape_id;
+        next_lang = _ghwp_font_get_language (g_utf8_get_char (p), lang);
+
+        if (p > start && (next_shape != shape_id || next_lang != lang)) {
+            _text_context_set_font_face (ctx,
+                _ghwp_font_set_get_face (ctx->fonts, shape_id, lang));
+            draw_run (ctx, start, p - start, left, right, x, y);
+            start = p;
         }
+        shape_id = next_shape;
+        lang     = next_lang;
+    }
 
-        cairo_show_glyphs (cr, glyphs, num_glyphs);
+    if (p > start) {
+        _text_context_set_font_face (ctx,
+            _ghwp_font_set_get_face (ctx->fonts, shape_id, lang));
+        draw_run (ctx, start, p - start, left, right, x, y);
     }
 
     *y += 18.0;
 }
 
-gboolean ghwp_page_render (GHWPPage *page, cairo_t *cr)
+/* 그린 명령이 recording surface 에서 차지할 바이트 수를 돌려준다 */
+static gsize _ghwp_page_draw (GHWPPage *page, cairo_t *cr, GArray *boxes)
 {
-    g_return_val_if_fail (page != NULL, FALSE);
-    g_return_val_if_fail (cr   != NULL, FALSE);
     cairo_save (cr);
 
     guint          i, j, k;
@@ -103,78 +229,403 @@ gboolean ghwp_page_render (GHWPPage *page, cairo_t *cr)
     GHWPTable     *table;
     GHWPTableCell *cell;
 
-    cairo_glyph_t        *glyphs = NULL; /* NULL로 지정하면 자동 할당됨 */
-    cairo_scaled_font_t  *scaled_font;
-    cairo_font_face_t    *font_face;
-    cairo_matrix_t        font_matrix;
-    cairo_matrix_t        ctm;
-    cairo_font_options_t *font_options;
-    cairo_text_extents_t  extents;
+    TextContext ctx;
 
     double x = 20.0;
     double y = 40.0;
 
-    /* create scaled font */
-    once_ft_init_and_new(); /*한 번만 초기화, 로드*/
-    font_face = cairo_ft_font_face_create_for_ft_face (ft_face, 0);
-    cairo_matrix_init_identity (&font_matrix);
-    cairo_matrix_scale (&font_matrix, 12.0, 12.0);
-    cairo_get_matrix (cr, &ctm);
-    font_options = cairo_font_options_create ();
-    cairo_get_font_options (cr, font_options);
-    scaled_font = cairo_scaled_font_create (font_face,
-                                           &font_matrix, &ctm, font_options);
-    cairo_font_options_destroy (font_options);
-
-    cairo_set_scaled_font(cr, scaled_font); /* 요 문장 없으면 fault 떨어짐 */
+    ctx.cr          = cr;
+    ctx.fonts       = page->fonts;
+    ctx.font_face   = NULL;
+    ctx.scaled_font = NULL;
+    ctx.n_glyphs    = 0;
+    ctx.n_ops       = 0;
+    ctx.boxes       = boxes;
+    ctx.paragraph   = NULL;
+    ctx.line        = 0;
+    cairo_matrix_init_identity (&ctx.font_matrix);
+    cairo_matrix_scale (&ctx.font_matrix, 12.0, 12.0);
+    cairo_get_matrix (cr, &ctx.ctm);
+    ctx.font_options = cairo_font_options_create ();
+    cairo_get_font_options (cr, ctx.font_options);
+
     cairo_set_source_rgb (cr, 0.0, 0.0, 0.0);
 
-    for (i = 0; i < page->paragraphs->len; i++) {
-        paragraph = g_array_index (page->paragraphs, GHWPParagraph *, i);
+    for (i = 0; i < page->entries->len; i++) {
+        GHWPPageEntry *entry = &g_array_index (page->entries, GHWPPageEntry, i);
+        paragraph = entry->paragraph;
         ghwp_text = paragraph->ghwp_text;
         x = 20.0;
-        /* draw text */
-        if ((ghwp_text != NULL) && !(g_str_equal(ghwp_text->text, "\n\r"))) {
-            draw_text(cr, extents, glyphs, scaled_font, ghwp_text->text,
-                      &x, &y);
+        /* draw text, 앞 페이지에서 이어지는 표이면 이미 그렸다 */
+        if ((ghwp_text != NULL) && !(g_str_equal(ghwp_text->text, "\n\r")) &&
+            entry->first_row == 0) {
+            draw_text(&ctx, paragraph, 20.0, 575.0, &x, &y);
         }
         /* draw table */
         table = ghwp_paragraph_get_table (paragraph);
-        if (table != NULL) {
+        if (table != NULL && entry->first_row < table->n_rows) {
+            const GHWPTableLayout *layout = ghwp_table_get_layout (table);
+            guint  row_end  = entry->n_rows > table->n_rows - entry->first_row ?
+                              table->n_rows : entry->first_row + entry->n_rows;
+            /* 표의 왼쪽 위, 첫 줄의 기준선이 y 이므로 한 줄만큼 올린다.
+             * 이 페이지의 첫 행이 맨 위에 오도록 옮긴다. */
+            double origin_x = 20.0;
+            double origin_y = y - 12.0 - layout->row_offsets[entry->first_row];
+
+            cairo_set_line_width (cr, 0.5);
             for (j = 0; j < table->cells->len; j++) {
+                double left, right;
                 cell = g_array_index(table->cells, GHWPTableCell *, j);
+                /* 이 페이지에서 시작하는 셀만 그린다 */
+                if (cell->row_addr < entry->first_row || cell->row_addr >= row_end)
+                    continue;
+
+                cairo_rectangle (cr, origin_x + cell->x, origin_y + cell->y,
+                                 cell->layout_width, cell->layout_height);
+                cairo_stroke (cr);
+                ctx.n_ops++;
+
+                /* 셀 안쪽 여백, hwpunit -> pt */
+                left  = origin_x + cell->x + cell->left_margin / 100.0;
+                right = origin_x + cell->x + cell->layout_width -
+                        cell->right_margin / 100.0;
+                y     = origin_y + cell->y + cell->top_margin / 100.0 + 12.0;
+
                 for (k = 0; k < cell->paragraphs->len; k++) {
-                    paragraph = g_array_index(cell->paragraphs,
-                                              GHWPParagraph *, k);
-                    if (paragraph->ghwp_text) {
-                        /* FIXME x, y 좌표 */
-                        x = 40.0 + (595.5 - 40.0) / table->n_cols * cell->col_addr;
-                        if (cell->col_addr != 0)
-                            y -= 16.0;
-                        draw_text(cr, extents, glyphs, scaled_font,
-                                  paragraph->ghwp_text->text, &x, &y);
+                    GHWPParagraph *c_paragraph;
+                    c_paragraph = g_array_index(cell->paragraphs,
+                                                GHWPParagraph *, k);
+                    if (c_paragraph->ghwp_text) {
+                        x = left;
+                        draw_text(&ctx, c_paragraph, left, right, &x, &y);
                     }
                 }
             }
+            y = origin_y + layout->row_offsets[row_end] + 12.0;
         }
     }
 
-    cairo_glyph_free (glyphs);
-    cairo_scaled_font_destroy (scaled_font);
+    if (ctx.scaled_font)
+        cairo_scaled_font_destroy (ctx.scaled_font);
+    cairo_font_options_destroy (ctx.font_options);
 
     cairo_restore (cr);
+    return 1024 + ctx.n_glyphs * sizeof (cairo_glyph_t) + ctx.n_ops * 256;
+}
+
+static GHWPLRUCache *_ghwp_page_get_display_lists (void)
+{
+    static gsize cache = 0;
+
+    if (g_once_init_enter (&cache)) {
+        GHWPLRUCache *tmp;
+        tmp = _ghwp_lru_cache_new (g_direct_hash, g_direct_equal, NULL,
+                                   (GBoxedCopyFunc) cairo_surface_reference,
+                                   (GDestroyNotify) cairo_surface_destroy,
+                                   GHWP_PAGE_DISPLAY_LIST_CACHE_SIZE);
+        g_once_init_leave (&cache, (gsize) tmp);
+    }
+
+    return (GHWPLRUCache *) cache;
+}
+
+static void _ghwp_page_text_index_free (struct _GHWPPageTextIndex *index)
+{
+    if (index == NULL)
+        return;
+
+    g_array_unref (index->boxes);
+    g_free (index->row_start);
+    g_free (index->row_boxes);
+    g_slice_free (struct _GHWPPageTextIndex, index);
+}
+
+static guint _text_index_row (struct _GHWPPageTextIndex *index, gdouble y)
+{
+    if (y <= 0.0)
+        return 0;
+    return MIN ((guint) (y / GHWP_PAGE_GRID_ROW), index->n_rows - 1);
+}
+
+/* boxes 의 소유권을 가져간다 */
+static struct _GHWPPageTextIndex *_ghwp_page_text_index_new (GArray *boxes)
+{
+    struct _GHWPPageTextIndex *index;
+    gdouble                    bottom = 0.0;
+    guint                      i, r, r1, r2;
+    guint                     *fill;
+
+    index = g_slice_new (struct _GHWPPageTextIndex);
+    index->boxes = boxes;
+
+    for (i = 0; i < boxes->len; i++)
+        bottom = MAX (bottom, g_array_index (boxes, TextBox, i).y2);
+    index->n_rows    = (guint) (bottom / GHWP_PAGE_GRID_ROW) + 1;
+    index->row_start = g_new0 (guint, index->n_rows + 1);
+
+    /* 줄마다 상자 수를 세고, 누적해서 시작 위치를 구한 뒤 채운다 */
+    for (i = 0; i < boxes->len; i++) {
+        TextBox *box = &g_array_index (boxes, TextBox, i);
+        r2 = _text_index_row (index, box->y2);
+        for (r = _text_index_row (index, box->y1); r <= r2; r++)
+            index->row_start[r + 1]++;
+    }
+    for (r = 0; r < index->n_rows; r++)
+        index->row_start[r + 1] += index->row_start[r];
+
+    index->row_boxes = g_new (guint, index->row_start[index->n_rows] + 1);
+    fill = g_new (guint, index->n_rows);
+    memcpy (fill, index->row_start, index->n_rows * sizeof (guint));
+    for (i = 0; i < boxes->len; i++) {
+        TextBox *box = &g_array_index (boxes, TextBox, i);
+        r1 = _text_index_row (index, box->y1);
+        r2 = _text_index_row (index, box->y2);
+        for (r = r1; r <= r2; r++)
+            index->row_boxes[fill[r]++] = i;
+    }
+    g_free (fill);
+
+    return index;
+}
+
+/* 다른 스레드가 먼저 만들었으면 그것을 쓴다 */
+static void _ghwp_page_set_text_index (GHWPPage *page, GArray *boxes)
+{
+    struct _GHWPPageTextIndex *index = _ghwp_page_text_index_new (boxes);
+
+    if (!g_atomic_pointer_compare_and_exchange (&page->text_index, NULL, index))
+        _ghwp_page_text_index_free (index);
+}
+
+static cairo_surface_t *_ghwp_page_record_full (GHWPPage *page,
+                                                gsize    *cost,
+                                                GArray   *boxes)
+{
+    cairo_surface_t   *surface;
+    cairo_rectangle_t  extents = { 0.0, 0.0, 0.0, 0.0 };
+    cairo_t           *cr;
+    gsize              tmp;
+
+    ghwp_page_get_size (page, &extents.width, &extents.height);
+    surface = cairo_recording_surface_create (CAIRO_CONTENT_COLOR_ALPHA,
+                                              &extents);
+    cr  = cairo_create (surface);
+    tmp = _ghwp_page_draw (page, cr, boxes);
+    cairo_destroy (cr);
+
+    if (cost)
+        *cost = tmp;
+
+    return surface;
+}
+
+/* private
+ * 페이지를 새 recording surface 에 그린다. 캐시에 넣지 않는다. */
+cairo_surface_t *_ghwp_page_record (GHWPPage *page, gsize *cost)
+{
+    g_return_val_if_fail (GHWP_IS_PAGE (page), NULL);
+
+    cairo_surface_t *surface;
+    gint64           start = _GHWP_STATS_BEGIN (GHWP_PHASE_RENDER);
+
+    surface = _ghwp_page_record_full (page, cost, NULL);
+    _GHWP_STATS_END (page->stats, GHWP_PHASE_RENDER, start);
+
+    return surface;
+}
+
+/* 기록이 없으면 그리면서, 글자 상자가 없으면 함께 모은다 */
+static cairo_surface_t *_ghwp_page_get_display_list (GHWPPage *page,
+                                                     gboolean  force)
+{
+    GHWPLRUCache    *cache = _ghwp_page_get_display_lists ();
+    cairo_surface_t *surface;
+    GArray          *boxes = NULL;
+    gsize            cost;
+
+    surface = force ? NULL : _ghwp_lru_cache_lookup (cache, page);
+    if (surface)
+        return surface;
+
+    if (g_atomic_pointer_get (&page->text_index) == NULL)
+        boxes = g_array_new (FALSE, FALSE, sizeof (TextBox));
+
+    surface = _ghwp_page_record_full (page, &cost, boxes);
+    if (boxes)
+        _ghwp_page_set_text_index (page, boxes);
+    _ghwp_lru_cache_insert (cache, page, cairo_surface_reference (surface), cost);
+
+    return surface;
+}
+
+static struct _GHWPPageTextIndex *_ghwp_page_get_text_index (GHWPPage *page)
+{
+    if (g_atomic_pointer_get (&page->text_index) == NULL)
+        cairo_surface_destroy (_ghwp_page_get_display_list (page, TRUE));
+
+    return g_atomic_pointer_get (&page->text_index);
+}
+
+/* 페이지 내용이 바뀌면 기록과 글자 상자를 버린다. 로더는 발행하기 전에만
+ * 페이지를 고치므로 다른 스레드가 상자를 읽고 있지 않다. */
+static void _ghwp_page_invalidate (GHWPPage *page)
+{
+    _ghwp_lru_cache_remove (_ghwp_page_get_display_lists (), page);
+    _ghwp_page_text_index_free (g_atomic_pointer_get (&page->text_index));
+    g_atomic_pointer_set (&page->text_index, NULL);
+}
+
+/**
+ * ghwp_page_render:
+ * @page: a #GHWPPage
+ * @cr: a cairo context
+ *
+ * Draws @page on @cr.  The first call records the drawing into a
+ * display list, later calls at any scale only replay it.  Display lists
+ * of all pages share one budget, see ghwp_page_set_cache_size().
+ *
+ * Return value: %TRUE on success
+ */
+gboolean ghwp_page_render (GHWPPage *page, cairo_t *cr)
+{
+    g_return_val_if_fail (page != NULL, FALSE);
+    g_return_val_if_fail (cr   != NULL, FALSE);
+
+    cairo_surface_t *surface;
+    gint64           start = _GHWP_STATS_BEGIN (GHWP_PHASE_RENDER);
+
+    surface = _ghwp_page_get_display_list (page, FALSE);
+
+    cairo_save (cr);
+    cairo_set_source_surface (cr, surface, 0.0, 0.0);
+    cairo_paint (cr);
+    cairo_restore (cr);
+    cairo_surface_destroy (surface);
+
+    _GHWP_STATS_END (page->stats, GHWP_PHASE_RENDER, start);
+
     return TRUE;
 }
 
+/**
+ * ghwp_page_set_cache_size:
+ * @max_bytes: bytes the display lists of all pages may hold
+ *
+ * Sets the budget for recorded pages kept by ghwp_page_render().  The
+ * least recently drawn pages are dropped first.  0 disables the cache.
+ */
+void ghwp_page_set_cache_size (gsize max_bytes)
+{
+    _ghwp_lru_cache_set_max_cost (_ghwp_page_get_display_lists (), max_bytes);
+}
+
 GHWPPage *ghwp_page_new (void)
 {
     return (GHWPPage *) g_object_new (GHWP_TYPE_PAGE, NULL);
 }
 
+/**
+ * ghwp_page_add_paragraph:
+ * @page: a #GHWPPage
+ * @paragraph: a #GHWPParagraph
+ *
+ * Appends @paragraph to @page, which keeps a reference to it.  Adding
+ * the paragraph that is already last on @page does nothing, so a
+ * paragraph is stored once per page.
+ * Tables owned by @paragraph are drawn in full until
+ * ghwp_page_set_table_rows() narrows the range.
+ */
+void ghwp_page_add_paragraph (GHWPPage *page, GHWPParagraph *paragraph)
+{
+    g_return_if_fail (GHWP_IS_PAGE (page));
+    g_return_if_fail (paragraph != NULL);
+
+    GHWPPageEntry entry;
+
+    if (page->entries->len > 0 &&
+        g_array_index (page->entries, GHWPPageEntry,
+                       page->entries->len - 1).paragraph == paragraph)
+        return;
+
+    entry.paragraph = paragraph;
+    entry.first_row = 0;
+    entry.n_rows    = G_MAXUINT;
+    g_array_append_val (page->entries, entry);
+    _ghwp_page_invalidate (page);
+    /* 문서가 먼저 해제되어도 페이지는 쓸 수 있어야 한다 */
+    g_object_ref (paragraph);
+    g_array_append_val (page->paragraphs, paragraph);
+}
+
+/**
+ * ghwp_page_set_table_rows:
+ * @page: a #GHWPPage
+ * @paragraph: a #GHWPParagraph already on @page
+ * @first_row: first table row drawn on @page
+ * @n_rows: number of rows drawn on @page, or %G_MAXUINT for the rest
+ *
+ * Sets which rows of the table owned by @paragraph belong to @page.
+ */
+void ghwp_page_set_table_rows (GHWPPage      *page,
+                               GHWPParagraph *paragraph,
+                               guint          first_row,
+                               guint          n_rows)
+{
+    g_return_if_fail (GHWP_IS_PAGE (page));
+
+    guint i;
+
+    for (i = page->entries->len; i > 0; i--) {
+        GHWPPageEntry *entry = &g_array_index (page->entries,
+                                               GHWPPageEntry, i - 1);
+        if (entry->paragraph == paragraph) {
+            entry->first_row = first_row;
+            entry->n_rows    = n_rows;
+            _ghwp_page_invalidate (page);
+            return;
+        }
+    }
+
+    g_return_if_reached ();
+}
+
+/* private
+ * 페이지를 그릴 때 쓸 글꼴. 문서의 페이지들이 하나를 함께 쓴다. */
+void _ghwp_page_set_font_set (GHWPPage *page, struct _GHWPFontSet *fonts)
+{
+    g_return_if_fail (GHWP_IS_PAGE (page));
+
+    _ghwp_page_invalidate (page);
+    if (fonts)
+        _ghwp_font_set_ref (fonts);
+    if (page->fonts)
+        _ghwp_font_set_unref (page->fonts);
+    page->fonts = fonts;
+}
+
+/* private
+ * 그리는 시간을 더할 곳. 페이지가 문서보다 오래 남을 수 있어 참조를 잡는다. */
+void _ghwp_page_set_stats (GHWPPage *page, struct _GHWPStatsData *stats)
+{
+    g_return_if_fail (GHWP_IS_PAGE (page));
+
+    if (stats)
+        _ghwp_stats_data_ref (stats);
+    if (page->stats)
+        _ghwp_stats_data_unref (page->stats);
+    page->stats = stats;
+}
+
 static void ghwp_page_finalize (GObject *obj)
 {
     GHWPPage *page = GHWP_PAGE(obj);
     g_array_free (page->paragraphs, TRUE);
+    g_array_free (page->entries, TRUE);
+    _ghwp_page_invalidate (page);
+    if (page->fonts)
+        _ghwp_font_set_unref (page->fonts);
+    if (page->stats)
+        _ghwp_stats_data_unref (page->stats);
     G_OBJECT_CLASS (ghwp_page_parent_class)->finalize (obj);
 }
 
@@ -187,9 +638,169 @@ static void ghwp_page_class_init (GHWPPageClass * klass)
 static void ghwp_page_init (GHWPPage *page)
 {
     page->paragraphs = g_array_new (TRUE, TRUE, sizeof (GHWPParagraph *));
+    g_array_set_clear_func (page->paragraphs, _g_object_unref_element);
+    page->entries    = g_array_new (FALSE, FALSE, sizeof (GHWPPageEntry));
 }
 
-/* experimental */
+static gboolean _text_box_is_space (TextBox *box)
+{
+    return g_unichar_isspace (g_utf8_get_char (box->paragraph->ghwp_text->text +
+                                               box->offset));
+}
+
+static gdouble _distance (gdouble v, gdouble lo, gdouble hi)
+{
+    return v < lo ? lo - v : v > hi ? v - hi : 0.0;
+}
+
+/* 점에서 가장 가까운 상자. 세로 거리를 먼저 보고, 같으면 가로 거리를 본다.
+ * 점이 있는 격자 줄에서 위아래로 넓혀 가다가 더 가까운 상자가 나올 수
+ * 없으면 멈춘다. */
+static gint _text_index_hit (struct _GHWPPageTextIndex *index,
+                             gdouble                    x,
+                             gdouble                    y)
+{
+    gint    best   = -1;
+    gdouble best_d = G_MAXDOUBLE;
+    guint   row, k, n, i;
+
+    if (index->boxes->len == 0)
+        return -1;
+
+    row = _text_index_row (index, y);
+    for (k = 0; k < index->n_rows; k++) {
+        guint rows[2];
+
+        if (best >= 0 && k > 0 &&
+            best_d < (k - 1) * GHWP_PAGE_GRID_ROW * 1000.0)
+            break;
+
+        n = 0;
+        if (row >= k)
+            rows[n++] = row - k;
+        if (k > 0 && row + k < index->n_rows)
+            rows[n++] = row + k;
+        if (n == 0)
+            break;
+
+        while (n-- > 0) {
+            for (i = index->row_start[rows[n]];
+                 i < index->row_start[rows[n] + 1]; i++) {
+                guint    id  = index->row_boxes[i];
+                TextBox *box = &g_array_index (index->boxes, TextBox, id);
+                gdouble  d   = _distance (y, box->y1, box->y2) * 1000.0 +
+                               _distance (x, box->x1, box->x2);
+
+                if (d < best_d || (d == best_d && (gint) id < best)) {
+                    best   = id;
+                    best_d = d;
+                }
+            }
+        }
+    }
+
+    return best;
+}
+
+/* 선택한 상자의 범위를 읽는 차례로 구한다 */
+static gboolean _text_index_get_range (struct _GHWPPageTextIndex *index,
+                                       GHWPSelectionStyle         style,
+                                       GHWPRectangle             *selection,
+                                       guint                     *first,
+                                       guint                     *last)
+{
+    TextBox *boxes = (TextBox *) index->boxes->data;
+    guint    len   = index->boxes->len;
+    gint     start, end, tmp;
+
+    start = _text_index_hit (index, selection->x1, selection->y1);
+    end   = _text_index_hit (index, selection->x2, selection->y2);
+    if (start < 0 || end < 0)
+        return FALSE;
+    if (start > end) {
+        tmp   = start;
+        start = end;
+        end   = tmp;
+    }
+
+    switch (style) {
+    case GHWP_SELECTION_WORD:
+        while (start > 0 && boxes[start - 1].line == boxes[start].line &&
+               !_text_box_is_space (&boxes[start - 1]))
+            start--;
+        while (end + 1 < (gint) len && boxes[end + 1].line == boxes[end].line &&
+               !_text_box_is_space (&boxes[end + 1]))
+            end++;
+        break;
+    case GHWP_SELECTION_LINE:
+        while (start > 0 && boxes[start - 1].line == boxes[start].line)
+            start--;
+        while (end + 1 < (gint) len && boxes[end + 1].line == boxes[end].line)
+            end++;
+        break;
+    default:
+        break;
+    }
+
+    *first = start;
+    *last  = end;
+    return TRUE;
+}
+
+/* 같은 줄에 이어진 상자를 사각형 하나로 합친다 */
+static GList *_text_index_get_region (struct _GHWPPageTextIndex *index,
+                                      guint                      first,
+                                      guint                      last,
+                                      GHWPParagraph             *paragraph,
+                                      guint                      begin,
+                                      guint                      end,
+                                      gdouble                    scale)
+{
+    GList         *region = NULL;
+    GHWPRectangle *rect   = NULL;
+    guint          line   = 0;
+    guint          i;
+
+    for (i = first; i <= last && i < index->boxes->len; i++) {
+        TextBox *box = &g_array_index (index->boxes, TextBox, i);
+
+        if (paragraph && (box->paragraph != paragraph ||
+                          box->offset + box->length <= begin ||
+                          box->offset >= end)) {
+            rect = NULL;
+            continue;
+        }
+
+        if (rect && box->line == line) {
+            rect->x1 = MIN (rect->x1, box->x1 * scale);
+            rect->x2 = MAX (rect->x2, box->x2 * scale);
+            continue;
+        }
+
+        rect = g_slice_new (GHWPRectangle);
+        rect->x1 = box->x1 * scale;
+        rect->y1 = box->y1 * scale;
+        rect->x2 = box->x2 * scale;
+        rect->y2 = box->y2 * scale;
+        line     = box->line;
+        region   = g_list_prepend (region, rect);
+    }
+
+    return g_list_reverse (region);
+}
+
+/**
+ * ghwp_page_render_selection:
+ * @page: a #GHWPPage
+ * @cr: a cairo context
+ * @selection: start and end point of the selection, in points
+ * @old_selection: (allow-none): previous selection, not used
+ * @style: a #GHWPSelectionStyle
+ * @glyph_color: color of the selected text
+ * @background_color: color behind the selected text
+ *
+ * Draws the selected part of @page in the given colors.
+ */
 void
 ghwp_page_render_selection (GHWPPage           *page,
                             cairo_t            *cr,
@@ -200,21 +811,89 @@ ghwp_page_render_selection (GHWPPage           *page,
                             GHWPColor          *background_color)
 {
     g_return_if_fail (page != NULL);
-    /* TODO */
+    g_return_if_fail (cr != NULL);
+    g_return_if_fail (selection != NULL);
+
+    cairo_surface_t *surface;
+    GList           *region, *l;
+
+    region = ghwp_page_get_selection_region (page, 1.0, style, selection);
+    if (region == NULL)
+        return;
+
+    cairo_save (cr);
+    for (l = region; l; l = l->next) {
+        GHWPRectangle *rect = l->data;
+        cairo_rectangle (cr, rect->x1, rect->y1,
+                         rect->x2 - rect->x1, rect->y2 - rect->y1);
+    }
+    cairo_clip (cr);
+    g_list_free_full (region, (GDestroyNotify) ghwp_rectangle_free);
+
+    cairo_set_source_rgb (cr, background_color->red   / 65535.0,
+                              background_color->green / 65535.0,
+                              background_color->blue  / 65535.0);
+    cairo_paint (cr);
+
+    /* 기록한 페이지의 알파를 마스크로 써서 글자만 다른 색으로 칠한다 */
+    surface = _ghwp_page_get_display_list (page, FALSE);
+    cairo_set_source_rgb (cr, glyph_color->red   / 65535.0,
+                              glyph_color->green / 65535.0,
+                              glyph_color->blue  / 65535.0);
+    cairo_mask_surface (cr, surface, 0.0, 0.0);
+    cairo_surface_destroy (surface);
+
+    cairo_restore (cr);
 }
 
-/* experimental */
+/**
+ * ghwp_page_get_selected_text:
+ * @page: a #GHWPPage
+ * @style: a #GHWPSelectionStyle
+ * @selection: start and end point of the selection, in points
+ *
+ * Return value: a newly allocated string with the selected text, lines
+ *     separated by "\n", or %NULL if @page has no text
+ */
 char *
 ghwp_page_get_selected_text (GHWPPage          *page,
                              GHWPSelectionStyle style,
                              GHWPRectangle     *selection)
 {
     g_return_val_if_fail (page != NULL, NULL);
-    /* TODO */
-    return NULL;
+    g_return_val_if_fail (selection != NULL, NULL);
+
+    struct _GHWPPageTextIndex *index = _ghwp_page_get_text_index (page);
+    GString                   *text;
+    guint                      first, last, i;
+
+    if (!_text_index_get_range (index, style, selection, &first, &last))
+        return NULL;
+
+    text = g_string_new (NULL);
+    for (i = first; i <= last; i++) {
+        TextBox *box = &g_array_index (index->boxes, TextBox, i);
+
+        if (i > first && box->line != g_array_index (index->boxes, TextBox,
+                                                     i - 1).line)
+            g_string_append_c (text, '\n');
+        g_string_append_len (text, box->paragraph->ghwp_text->text +
+                                   box->offset, box->length);
+    }
+
+    return g_string_free (text, FALSE);
 }
 
-/* experimental */
+/**
+ * ghwp_page_get_selection_region:
+ * @page: a #GHWPPage
+ * @scale: scale applied to the rectangles
+ * @style: a #GHWPSelectionStyle
+ * @selection: start and end point of the selection, in points
+ *
+ * Return value: (element-type GHWPRectangle) (transfer full): one
+ *     rectangle per selected line, free with ghwp_rectangle_free()
+ */
 GList *
 ghwp_page_get_selection_region (GHWPPage          *page,
                                 gdouble            scale,
@@ -222,8 +901,59 @@ ghwp_page_get_selection_region (GHWPPage          *page,
                                 GHWPRectangle     *selection)
 {
     g_return_val_if_fail (page != NULL, NULL);
-    /* TODO */
-    return NULL;
+    g_return_val_if_fail (selection != NULL, NULL);
+
+    struct _GHWPPageTextIndex *index = _ghwp_page_get_text_index (page);
+    guint                      first, last;
+
+    if (!_text_index_get_range (index, style, selection, &first, &last))
+        return NULL;
+
+    return _text_index_get_region (index, first, last, NULL, 0, 0, scale);
+}
+
+/**
+ * ghwp_page_get_text_region:
+ * @page: a #GHWPPage
+ * @paragraph: a #GHWPParagraph on @page
+ * @offset: offset in characters of the text of @paragraph
+ * @length: length in characters
+ * @scale: scale applied to the rectangles
+ *
+ * Returns the area covered by part of a paragraph, for example a
+ * #GHWPFindResult to highlight.
+ *
+ * Return value: (element-type GHWPRectangle) (transfer full): one
+ *     rectangle per line, free with ghwp_rectangle_free()
+ */
+GList *
+ghwp_page_get_text_region (GHWPPage      *page,
+                           GHWPParagraph *paragraph,
+                           guint          offset,
+                           guint          length,
+                           gdouble        scale)
+{
+    g_return_val_if_fail (page != NULL, NULL);
+    g_return_val_if_fail (paragraph != NULL, NULL);
+
+    struct _GHWPPageTextIndex *index = _ghwp_page_get_text_index (page);
+    const gchar               *text;
+    glong                      n_chars;
+    guint                      begin, end;
+
+    if (paragraph->ghwp_text == NULL || index->boxes->len == 0)
+        return NULL;
+
+    text    = paragraph->ghwp_text->text;
+    n_chars = g_utf8_strlen (text, -1);
+    if ((glong) offset > n_chars)
+        return NULL;
+    length = MIN (length, (guint) (n_chars - offset));
+    begin  = g_utf8_offset_to_pointer (text, offset) - text;
+    end    = g_utf8_offset_to_pointer (text, offset + length) - text;
+
+    return _text_index_get_region (index, 0, index->boxes->len - 1,
+                                   paragraph, begin, end, scale);
 }
 
 /**
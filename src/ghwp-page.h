@@ -35,11 +35,26 @@ G_BEGIN_DECLS
 #define GHWP_PAGE_GET_CLASS(obj)   (G_TYPE_INSTANCE_GET_CLASS ((obj), GHWP_TYPE_PAGE, GHWPPageClass))
 
 typedef struct _GHWPPageClass   GHWPPageClass;
+typedef struct _GHWPPageEntry   GHWPPageEntry;
+
+/* 페이지에 놓인 문단. 표가 여러 페이지에 걸치면 페이지마다
+ * 그릴 행 범위를 가진다. */
+struct _GHWPPageEntry
+{
+    GHWPParagraph *paragraph;
+    guint          first_row;
+    guint          n_rows;    /* G_MAXUINT 이면 끝까지 */
+};
 
 struct _GHWPPage
 {
     GObject  parent_instance;
-    GArray  *paragraphs;
+    GArray  *paragraphs; /* 중복 없음, entries 와 같은 순서 */
+    GArray  *entries;    /* GHWPPageEntry */
+    /* private */
+    struct _GHWPFontSet       *fonts;
+    struct _GHWPPageTextIndex *text_index; /* 글자 상자, 처음 그릴 때 만든다 */
+    struct _GHWPStatsData     *stats;
 };
 
 struct _GHWPPageClass
@@ -53,6 +68,16 @@ void      ghwp_page_get_size   (GHWPPage *page,
                                 gdouble  *width,
                                 gdouble  *height);
 gboolean  ghwp_page_render     (GHWPPage *page, cairo_t *cr);
+void      ghwp_page_set_cache_size
+                               (gsize     max_bytes);
+void      ghwp_page_add_paragraph
+                               (GHWPPage      *page,
+                                GHWPParagraph *paragraph);
+void      ghwp_page_set_table_rows
+                               (GHWPPage      *page,
+                                GHWPParagraph *paragraph,
+                                guint          first_row,
+                                guint          n_rows);
 /* experimental */
 void
 ghwp_page_render_selection     (GHWPPage           *page,
@@ -71,8 +96,23 @@ ghwp_page_get_selection_region (GHWPPage          *page,
                                 gdouble            scale,
                                 GHWPSelectionStyle style,
                                 GHWPRectangle     *selection);
+GList *
+ghwp_page_get_text_region      (GHWPPage          *page,
+                                GHWPParagraph     *paragraph,
+                                guint              offset,
+                                guint              length,
+                                gdouble            scale);
 void
 ghwp_rectangle_free            (GHWPRectangle     *rectangle);
+/* private */
+cairo_surface_t *
+          _ghwp_page_record    (GHWPPage            *page,
+                                gsize               *cost);
+void      _ghwp_page_set_font_set
+                               (GHWPPage            *page,
+                                struct _GHWPFontSet *fonts);
+void      _ghwp_page_set_stats (GHWPPage              *page,
+                                struct _GHWPStatsData *stats);
 
 struct _GHWPColor
 {
@@ -35,23 +35,37 @@ G_DEFINE_TYPE (GHWPContext, ghwp_context, G_TYPE_OBJECT);
 
 static void ghwp_context_finalize (GObject* obj);
 
-gboolean context_skip (GHWPContext *context, guint16 count)
+struct _GHWPTagTable
+{
+    gint ref_count;
+    struct {
+        GHWPTagFunc func;
+        gpointer    user_data;
+        gboolean    ignored;
+    } entries[GHWP_N_TAGS];
+};
+
+gboolean context_skip (GHWPContext *context, guint32 count)
 {
     g_return_val_if_fail (context != NULL, FALSE);
 
     gboolean is_success = FALSE;
-    guint8  *buf        = g_malloc (count);
-    /* FIXME g_input_stream_skip 가 작동하지 않아 아래처럼 처리했다. */
-    is_success = g_input_stream_read_all (context->stream, buf, (gsize) count,
-                                          &context->priv->bytes_read,
-                                          NULL, NULL);
-    g_free (buf);
-
-    if ((is_success == FALSE) || (context->priv->bytes_read != (gsize) count))
-    {
-        g_warning ("%s:%d:skip size mismatch\n", __FILE__, __LINE__);
-        g_input_stream_close (context->stream, NULL, NULL);
-        return FALSE;
+    guint8   buf[4096];
+    guint32  remain     = count;
+    /* FIXME g_input_stream_skip 가 작동하지 않아 아래처럼 처리했다.
+     * 레코드가 커도 힙을 쓰지 않도록 나누어 읽는다. */
+    while (remain > 0) {
+        gsize size = MIN (remain, sizeof (buf));
+        is_success = g_input_stream_read_all (context->stream, buf, size,
+                                              &context->priv->bytes_read,
+                                              context->cancellable, NULL);
+        if ((is_success == FALSE) || (context->priv->bytes_read != size))
+        {
+            g_warning ("%s:%d:skip size mismatch\n", __FILE__, __LINE__);
+            g_input_stream_close (context->stream, NULL, NULL);
+            return FALSE;
+        }
+        remain -= size;
     }
 
     context->data_count += count;
@@ -61,12 +75,12 @@ gboolean context_skip (GHWPContext *context, guint16 count)
 gboolean context_read_uint16 (GHWPContext *context, guint16 *i)
 {
     g_return_val_if_fail (context != NULL, FALSE);
-    g_return_val_if_fail (context->data_count <= context->data_len - 2, FALSE);
+    g_return_val_if_fail (context->data_count + 2 <= context->data_len, FALSE);
 
     gboolean is_success = FALSE;
     is_success = g_input_stream_read_all (context->stream, i, 2,
                                           &context->priv->bytes_read,
-                                          NULL, NULL);
+                                          context->cancellable, NULL);
     if ((is_success == FALSE) ||
         (context->priv->bytes_read != 2) ||
         (context->priv->bytes_read == 0))
@@ -83,12 +97,12 @@ gboolean context_read_uint16 (GHWPContext *context, guint16 *i)
 gboolean context_read_uint32 (GHWPContext *context, guint32 *i)
 {
     g_return_val_if_fail (context != NULL, FALSE);
-    g_return_val_if_fail (context->data_count <= context->data_len - 4, FALSE);
+    g_return_val_if_fail (context->data_count + 4 <= context->data_len, FALSE);
 
     gboolean is_success = FALSE;
     is_success = g_input_stream_read_all (context->stream, i, 4,
                                           &context->priv->bytes_read,
-                                          NULL, NULL);
+                                          context->cancellable, NULL);
     if ((is_success == FALSE) ||
         (context->priv->bytes_read != 4) ||
         (context->priv->bytes_read == 0))
@@ -102,6 +116,28 @@ gboolean context_read_uint32 (GHWPContext *context, guint32 *i)
     return TRUE;
 }
 
+/* 현재 레코드의 남은 데이터에서 count 바이트를 buffer 로 읽는다 */
+gboolean context_read_data (GHWPContext *context, guint8 *buffer, guint32 count)
+{
+    g_return_val_if_fail (context != NULL, FALSE);
+    g_return_val_if_fail (count <= context->data_len - context->data_count,
+                          FALSE);
+
+    gboolean is_success = FALSE;
+    is_success = g_input_stream_read_all (context->stream, buffer,
+                                          (gsize) count,
+                                          &context->priv->bytes_read,
+                                          context->cancellable, NULL);
+    if ((is_success == FALSE) ||
+        (context->priv->bytes_read != (gsize) count))
+    {
+        g_input_stream_close (context->stream, NULL, NULL);
+        return FALSE;
+    }
+    context->data_count += count;
+    return TRUE;
+}
+
 GHWPContext* ghwp_context_new (GInputStream* stream)
 {
     g_return_val_if_fail (stream != NULL, NULL);
@@ -110,13 +146,96 @@ GHWPContext* ghwp_context_new (GInputStream* stream)
     return context;
 }
 
-/* 에러일 경우 FALSE 반환, error 설정,
- * 성공일 경우 TRUE 반환,
- * end-of-stream 일 경우 FALSE 반환, error 설정 안 함 */
-gboolean ghwp_context_pull (GHWPContext *context, GError **error)
+/**
+ * ghwp_context_set_cancellable:
+ * @context: a #GHWPContext
+ * @cancellable: (allow-none): a #GCancellable, or %NULL
+ *
+ * Sets the #GCancellable used for every read on the underlying stream.
+ * Once it is cancelled, ghwp_context_pull() fails with
+ * %G_IO_ERROR_CANCELLED.
+ */
+void ghwp_context_set_cancellable (GHWPContext  *context,
+                                   GCancellable *cancellable)
 {
-    g_return_val_if_fail (context != NULL, FALSE);
-    gboolean is_success = TRUE;
+    g_return_if_fail (GHWP_IS_CONTEXT (context));
+
+    if (cancellable)
+        g_object_ref (cancellable);
+    _g_object_unref0 (context->cancellable);
+    context->cancellable = cancellable;
+}
+
+/* private
+ * 레코드 수와 헤더를 읽는 데 든 시간을 stats 에 더한다. 읽기 전에 부른다. */
+void _ghwp_context_set_stats (GHWPContext           *context,
+                              struct _GHWPStatsData *stats)
+{
+    g_return_if_fail (GHWP_IS_CONTEXT (context));
+    g_return_if_fail (context->priv->stats == NULL);
+
+    if (stats == NULL)
+        return;
+
+    context->priv->stats     = _ghwp_stats_data_ref (stats);
+    context->priv->tag_count = g_new0 (guint32, GHWP_STATS_N_TAGS);
+}
+
+/**
+ * ghwp_context_set_tag_table:
+ * @context: a #GHWPContext
+ * @table: (allow-none): a #GHWPTagTable, or %NULL
+ *
+ * Sets the handlers used by ghwp_context_dispatch().  Records whose tag
+ * is ignored in @table are skipped by ghwp_context_pull() without being
+ * returned.
+ */
+void ghwp_context_set_tag_table (GHWPContext *context, GHWPTagTable *table)
+{
+    g_return_if_fail (GHWP_IS_CONTEXT (context));
+
+    if (table)
+        ghwp_tag_table_ref (table);
+    if (context->priv->tag_table)
+        ghwp_tag_table_unref (context->priv->tag_table);
+    context->priv->tag_table = table;
+}
+
+/**
+ * ghwp_context_dispatch:
+ * @context: a #GHWPContext
+ * @error: (allow-none): Return location for an error, or %NULL
+ *
+ * Calls the handler registered for the current record's tag, if any.
+ *
+ * Return value: the handler's result, or %TRUE if there is no handler
+ */
+gboolean ghwp_context_dispatch (GHWPContext *context, GError **error)
+{
+    g_return_val_if_fail (GHWP_IS_CONTEXT (context), FALSE);
+
+    GHWPTagTable *table = context->priv->tag_table;
+
+    if (table == NULL || table->entries[context->tag_id].func == NULL)
+        return TRUE;
+
+    return table->entries[context->tag_id].func (context,
+                               table->entries[context->tag_id].user_data,
+                               error);
+}
+
+static gboolean _ghwp_context_pull_record (GHWPContext *context,
+                                           GError     **error)
+{
+    gboolean      is_success = TRUE;
+    GHWPTagTable *table      = context->priv->tag_table;
+
+pull:
+    /* 취소된 경우 */
+    if (g_cancellable_set_error_if_cancelled (context->cancellable, error)) {
+        g_input_stream_close (context->stream, NULL, NULL);
+        return FALSE;
+    }
     if (context->data_len - context->data_count > 0)
         context_skip (context, context->data_len - context->data_count);
     /* 4바이트 읽기 */
@@ -124,7 +243,7 @@ gboolean ghwp_context_pull (GHWPContext *context, GError **error)
                                           &context->priv->header,
                                           (gsize) 4,
                                           &context->priv->bytes_read,
-                                          NULL, error);
+                                          context->cancellable, error);
 
     if (is_success == FALSE) {
         /* g_input_stream_read_all이 에러를 설정했으므로
@@ -150,7 +269,7 @@ gboolean ghwp_context_pull (GHWPContext *context, GError **error)
     /* 4바이트 헤더 디코딩하기 */
     context->tag_id   = (guint16) ( context->priv->header        & 0x3ff);
     context->level    = (guint16) ((context->priv->header >> 10) & 0x3ff);
-    context->data_len = (guint16) ((context->priv->header >> 20) & 0xfff);
+    context->data_len = (guint32) ((context->priv->header >> 20) & 0xfff);
     /* 비정상 */
     if (context->data_len == 0) {
         g_set_error_literal (error, GHWP_ERROR, GHWP_ERROR_INVALID,
@@ -163,7 +282,7 @@ gboolean ghwp_context_pull (GHWPContext *context, GError **error)
         is_success = g_input_stream_read_all (context->stream,
                                               &context->data_len, (gsize) 4,
                                               &context->priv->bytes_read,
-                                              NULL, error);
+                                              context->cancellable, error);
 
         if (is_success == FALSE) {
             /* g_input_stream_read_all이 에러를 설정했으므로
@@ -185,9 +304,52 @@ gboolean ghwp_context_pull (GHWPContext *context, GError **error)
 
     context->data_count = 0;
 
+    if (context->priv->tag_count) {
+        context->priv->tag_count[context->tag_id]++;
+        context->priv->n_records++;
+    }
+
+    /* 무시하는 태그는 내용을 풀지 않고 건너뛴다 */
+    if (table && table->entries[context->tag_id].ignored) {
+        if (!context_skip (context, context->data_len)) {
+            g_set_error_literal (error, GHWP_ERROR, GHWP_ERROR_INVALID,
+                                 _("File corrupted"));
+            return FALSE;
+        }
+        goto pull;
+    }
+
     return TRUE;
 }
 
+/* 에러일 경우 FALSE 반환, error 설정,
+ * 성공일 경우 TRUE 반환,
+ * end-of-stream 일 경우 FALSE 반환, error 설정 안 함 */
+gboolean ghwp_context_pull (GHWPContext *context, GError **error)
+{
+    g_return_val_if_fail (context != NULL, FALSE);
+
+    GHWPContextPrivate *priv = context->priv;
+    gboolean            is_success;
+    guint64             inflate;
+    gint64              start;
+
+    if (G_LIKELY (priv->stats == NULL))
+        return _ghwp_context_pull_record (context, error);
+
+    /* 압축 풀기는 따로 세므로 그동안 늘어난 만큼 뺀다 */
+    inflate = _ghwp_stats_get_time (priv->stats, GHWP_PHASE_INFLATE);
+    start   = g_get_monotonic_time ();
+
+    is_success = _ghwp_context_pull_record (context, error);
+
+    priv->decode_time += g_get_monotonic_time () - start -
+        (gint64) (_ghwp_stats_get_time (priv->stats, GHWP_PHASE_INFLATE) -
+                  inflate);
+
+    return is_success;
+}
+
 
 static void ghwp_context_class_init (GHWPContextClass * klass)
 {
@@ -209,6 +371,109 @@ static void ghwp_context_finalize (GObject *obj)
     GHWPContext *context = GHWP_CONTEXT(obj);
     g_input_stream_close (context->stream, NULL, NULL);
     g_object_unref (context->stream);
+    _g_object_unref0 (context->cancellable);
+    if (context->priv->tag_table)
+        ghwp_tag_table_unref (context->priv->tag_table);
+    if (context->priv->stats) {
+        _ghwp_stats_add_time (context->priv->stats,
+                              GHWP_PHASE_RECORD_DECODE,
+                              context->priv->decode_time);
+        _ghwp_stats_add_records (context->priv->stats,
+                                 context->priv->tag_count,
+                                 context->priv->n_records);
+        _ghwp_stats_data_unref (context->priv->stats);
+        g_free (context->priv->tag_count);
+    }
 /*    context->data = (g_free (context->data), NULL);*/
     G_OBJECT_CLASS (ghwp_context_parent_class)->finalize (obj);
 }
+
+/**
+ * ghwp_tag_table_new:
+ *
+ * Creates a table of record handlers indexed by tag ID, see
+ * ghwp_context_set_tag_table().  No tag has a handler or is ignored.
+ *
+ * Return value: a new #GHWPTagTable, release it with ghwp_tag_table_unref()
+ */
+GHWPTagTable *ghwp_tag_table_new (void)
+{
+    GHWPTagTable *table = g_slice_new0 (GHWPTagTable);
+    table->ref_count = 1;
+    return table;
+}
+
+GHWPTagTable *ghwp_tag_table_ref (GHWPTagTable *table)
+{
+    g_return_val_if_fail (table != NULL, NULL);
+    g_atomic_int_inc (&table->ref_count);
+    return table;
+}
+
+void ghwp_tag_table_unref (GHWPTagTable *table)
+{
+    g_return_if_fail (table != NULL);
+
+    if (g_atomic_int_dec_and_test (&table->ref_count))
+        g_slice_free (GHWPTagTable, table);
+}
+
+/**
+ * ghwp_tag_table_set_handler:
+ * @table: a #GHWPTagTable
+ * @tag_id: a tag ID, see #GHWPTag
+ * @func: (allow-none) (scope notified): the handler, or %NULL to remove it
+ * @user_data: user data for @func
+ *
+ * Sets the handler ghwp_context_dispatch() calls for @tag_id.  This also
+ * stops ignoring @tag_id.
+ */
+void ghwp_tag_table_set_handler (GHWPTagTable *table,
+                                 guint16       tag_id,
+                                 GHWPTagFunc   func,
+                                 gpointer      user_data)
+{
+    g_return_if_fail (table != NULL);
+    g_return_if_fail (tag_id < GHWP_N_TAGS);
+
+    table->entries[tag_id].func      = func;
+    table->entries[tag_id].user_data = user_data;
+    table->entries[tag_id].ignored   = FALSE;
+}
+
+/**
+ * ghwp_tag_table_set_ignored:
+ * @table: a #GHWPTagTable
+ * @tag_id: a tag ID, see #GHWPTag
+ * @ignored: whether to skip records with @tag_id
+ *
+ * Ignored records are skipped by ghwp_context_pull() without decoding
+ * their body, their handler is never called.
+ */
+void ghwp_tag_table_set_ignored (GHWPTagTable *table,
+                                 guint16       tag_id,
+                                 gboolean      ignored)
+{
+    g_return_if_fail (table != NULL);
+    g_return_if_fail (tag_id < GHWP_N_TAGS);
+
+    table->entries[tag_id].ignored = ignored;
+}
+
+/**
+ * ghwp_tag_table_ignore_unhandled:
+ * @table: a #GHWPTagTable
+ *
+ * Ignores every tag that has no handler, so that only records of
+ * interest are returned by ghwp_context_pull().
+ */
+void ghwp_tag_table_ignore_unhandled (GHWPTagTable *table)
+{
+    g_return_if_fail (table != NULL);
+
+    guint i;
+
+    for (i = 0; i < GHWP_N_TAGS; i++)
+        if (table->entries[i].func == NULL)
+            table->entries[i].ignored = TRUE;
+}
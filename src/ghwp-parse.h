@@ -51,10 +51,11 @@ struct _GHWPContext {
     GObject             parent_instance;
     GHWPContextPrivate *priv;
     GInputStream       *stream;
+    GCancellable       *cancellable;
     guint16             tag_id;
     guint16             level;
-    guint16             data_len;
-    guint16             data_count;
+    guint32             data_len;
+    guint32             data_count;
     guint8              status;
 };
 
@@ -62,21 +63,73 @@ struct _GHWPContextClass {
     GObjectClass parent_class;
 };
 
+typedef struct _GHWPTagTable GHWPTagTable;
+
+/**
+ * GHWPTagFunc:
+ * @context: a #GHWPContext positioned at the start of a record body
+ * @user_data: user data given to ghwp_tag_table_set_handler()
+ * @error: (allow-none): Return location for an error, or %NULL
+ *
+ * Handles one record.  The handler may read any part of the body, the
+ * rest is skipped by the next ghwp_context_pull().
+ *
+ * Return value: %FALSE to stop reading, with @error set on failure
+ */
+typedef gboolean (*GHWPTagFunc) (GHWPContext *context,
+                                 gpointer     user_data,
+                                 GError     **error);
+
 struct _GHWPContextPrivate {
     guint32           header;
     gsize             bytes_read;
     gboolean          ret;
+    GHWPTagTable     *tag_table;
+    /* 통계를 켰을 때만 쓴다 */
+    struct _GHWPStatsData *stats;
+    guint32          *tag_count;
+    guint64           n_records;
+    gint64            decode_time;
 };
 
 GType        ghwp_context_get_type (void) G_GNUC_CONST;
 GHWPContext *ghwp_context_new      (GInputStream *stream);
+void         ghwp_context_set_cancellable
+                                   (GHWPContext  *context,
+                                    GCancellable *cancellable);
 gboolean     ghwp_context_pull     (GHWPContext  *context, GError **error);
+void         ghwp_context_set_tag_table
+                                   (GHWPContext  *context,
+                                    GHWPTagTable *table);
+gboolean     ghwp_context_dispatch (GHWPContext  *context, GError **error);
 gboolean     context_read_uint16   (GHWPContext  *context,
                                     guint16      *i);
 gboolean     context_read_uint32   (GHWPContext  *context,
                                     guint32      *i);
+gboolean     context_read_data     (GHWPContext  *context,
+                                    guint8       *buffer,
+                                    guint32       count);
 gboolean     context_skip          (GHWPContext  *context,
-                                    guint16       count);
+                                    guint32       count);
+
+GHWPTagTable *ghwp_tag_table_new   (void);
+GHWPTagTable *ghwp_tag_table_ref   (GHWPTagTable *table);
+void          ghwp_tag_table_unref (GHWPTagTable *table);
+void          ghwp_tag_table_set_handler
+                                   (GHWPTagTable *table,
+                                    guint16       tag_id,
+                                    GHWPTagFunc   func,
+                                    gpointer      user_data);
+void          ghwp_tag_table_set_ignored
+                                   (GHWPTagTable *table,
+                                    guint16       tag_id,
+                                    gboolean      ignored);
+void          ghwp_tag_table_ignore_unhandled
+                                   (GHWPTagTable *table);
+/* private */
+void         _ghwp_context_set_stats
+                                   (GHWPContext           *context,
+                                    struct _GHWPStatsData *stats);
 
 G_END_DECLS
 
@@ -0,0 +1,539 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4; tab-width: 4 -*- */
+/*
+ * ghwp-search.c
+ *
+ * Copyright (C) 2013 Hodong Kim <cogniti@gmail.com>
+ *
+ * This library is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * 문서의 모든 문단 글자를 정규화(NFKC, 대소문자 접기)하여 한 버퍼에
+ * 이어 붙여 두고, 찾기는 그 버퍼를 한 번 훑는 것으로 끝낸다.
+ * 문단은 '\0' 으로 끝나므로 찾은 곳이 두 문단에 걸치지 않는다.
+ */
+
+#include <string.h>
+
+#include "ghwp-search.h"
+#include "ghwp-file-v5.h"
+
+/* 정규화하는 단위. 원래 글자 위치로 되돌리는 데 쓴다. */
+typedef struct
+{
+    guint32 norm_offset; /* 문단 시작에서의 바이트 위치 */
+    guint32 char_offset; /* 원래 글자에서의 문자 위치 */
+} Run;
+
+/* 문단은 포인터 대신 doc->paragraphs 의 번호로 가리킨다. 버린 구역의
+ * 문단은 다시 읽으면 새 객체가 되기 때문이다. */
+typedef struct
+{
+    gsize          start;  /* buf 안의 정규화된 글자 범위 */
+    gsize          end;
+    guint          page;
+    guint          paragraph;
+    guint          cell;   /* G_MAXUINT 이면 표 밖의 문단 */
+    guint          cell_paragraph;
+    guint          first_run;
+    guint          n_runs;
+    guint          n_chars; /* 원래 글자의 문자 수 */
+} Segment;
+
+struct _GHWPSearchIndex
+{
+    GString       *buf;
+    GArray        *runs;
+    GArray        *segments;
+    gboolean       fold;
+    guint          n_pages;        /* 색인한 페이지 수 */
+};
+
+/* 결합 문자, 한글 중성/종성 자모, 호환 모음 자모는 앞 글자와 합쳐질 수
+ * 있으므로 앞 글자와 함께 정규화한다. */
+static inline gboolean _is_joining (gunichar c)
+{
+    return (c >= 0x1160 && c <= 0x11ff) ||
+           (c >= 0xd7b0 && c <= 0xd7ff) ||
+           (c >= 0x314f && c <= 0x3163) ||
+           (c >= 0x3187 && c <= 0x318e) ||
+           g_unichar_combining_class (c) != 0;
+}
+
+static gchar *_ghwp_search_normalize (const gchar *str,
+                                      gssize       len,
+                                      gboolean     fold)
+{
+    gchar *tmp;
+    gchar *normalized;
+
+    tmp = fold ? g_utf8_casefold (str, len) : g_strndup (str, len);
+    normalized = g_utf8_normalize (tmp, -1, G_NORMALIZE_ALL_COMPOSE);
+    g_free (tmp);
+
+    return normalized;
+}
+
+/* text 를 정규화하여 buf 에 붙이고 Run 을 runs 에 더한다.
+ * 원래 글자의 문자 수를 돌려준다. */
+static guint _ghwp_search_append (GString     *buf,
+                                  GArray      *runs,
+                                  const gchar *text,
+                                  gboolean     fold)
+{
+    gsize        start = buf->len;
+    const gchar *p     = text;
+    guint        n_chars = 0;
+
+    while (*p) {
+        const gchar *run_start = p;
+        Run          run;
+
+        run.norm_offset = (guint32) (buf->len - start);
+        run.char_offset = n_chars;
+        g_array_append_val (runs, run);
+
+        p = g_utf8_next_char (p);
+        n_chars++;
+        while (*p && _is_joining (g_utf8_get_char (p))) {
+            p = g_utf8_next_char (p);
+            n_chars++;
+        }
+
+        /* ASCII 한 글자는 정규화해도 같다 */
+        if (p - run_start == 1 && !(*run_start & 0x80)) {
+            g_string_append_c (buf, fold ? g_ascii_tolower (*run_start)
+                                         : *run_start);
+        } else {
+            gchar *normalized;
+            normalized = _ghwp_search_normalize (run_start, p - run_start,
+                                                 fold);
+            if (normalized) {
+                g_string_append (buf, normalized);
+                g_free (normalized);
+            }
+        }
+    }
+
+    return n_chars;
+}
+
+static void _ghwp_search_index_add (struct _GHWPSearchIndex *index,
+                                    GHWPParagraph           *paragraph,
+                                    guint                    page,
+                                    guint                    n_paragraph,
+                                    guint                    cell,
+                                    guint                    cell_paragraph)
+{
+    Segment seg;
+
+    if (paragraph->ghwp_text == NULL || paragraph->ghwp_text->text == NULL ||
+        !g_utf8_validate (paragraph->ghwp_text->text, -1, NULL))
+        return;
+
+    seg.start          = index->buf->len;
+    seg.page           = page;
+    seg.paragraph      = n_paragraph;
+    seg.cell           = cell;
+    seg.cell_paragraph = cell_paragraph;
+    seg.first_run = index->runs->len;
+    seg.n_chars   = _ghwp_search_append (index->buf, index->runs,
+                                         paragraph->ghwp_text->text,
+                                         index->fold);
+    seg.n_runs    = index->runs->len - seg.first_run;
+    seg.end       = index->buf->len;
+    g_string_append_c (index->buf, '\0');
+
+    g_array_append_val (index->segments, seg);
+}
+
+/* n_page 의 첫 문단이 앞 페이지의 마지막 문단과 같은지, 곧 앞 페이지에서
+ * 표가 이어지는지 */
+static gboolean _ghwp_search_continues (GHWPDocument *doc, guint n_page)
+{
+    const GHWPPageRange *prev;
+    const GHWPPageRange *range;
+
+    if (n_page == 0)
+        return FALSE;
+
+    prev  = &g_array_index (doc->page_ranges, GHWPPageRange, n_page - 1);
+    range = &g_array_index (doc->page_ranges, GHWPPageRange, n_page);
+
+    return prev->n_paragraphs > 0 && range->n_paragraphs > 0 &&
+           prev->first_paragraph + prev->n_paragraphs - 1 ==
+           range->first_paragraph;
+}
+
+/* doc 의 lock 을 잡은 상태에서 부른다. 새로 더해진 페이지만 색인한다. */
+static void _ghwp_search_index_update (struct _GHWPSearchIndex *index,
+                                       GHWPDocument            *doc)
+{
+    guint i, j, k, l;
+
+    for (i = index->n_pages; i < doc->page_ranges->len; i++) {
+        const GHWPPageRange *range;
+
+        range = &g_array_index (doc->page_ranges, GHWPPageRange, i);
+
+        for (j = 0; j < range->n_paragraphs; j++) {
+            GHWPParagraph *paragraph;
+            GHWPTable     *table;
+            guint          n_paragraph = range->first_paragraph + j;
+            guint          first_row   = j == 0 ? range->first_row : 0;
+            guint          row_end     = G_MAXUINT;
+
+            paragraph = _ghwp_document_peek_paragraph (doc, n_paragraph);
+            /* 버린 구역을 다시 읽지 못했다 */
+            if (paragraph == NULL)
+                break;
+
+            /* 앞 페이지에서 이어지는 표이면 글자는 이미 색인했다 */
+            if (j > 0 || !_ghwp_search_continues (doc, i))
+                _ghwp_search_index_add (index, paragraph, i, n_paragraph,
+                                        G_MAXUINT, 0);
+
+            table = paragraph->table;
+            if (table == NULL)
+                continue;
+
+            if (j + 1 == range->n_paragraphs)
+                row_end = range->end_row;
+
+            for (k = 0; k < table->cells->len; k++) {
+                GHWPTableCell *cell;
+                cell = g_array_index (table->cells, GHWPTableCell *, k);
+
+                if (cell->row_addr < first_row || cell->row_addr >= row_end)
+                    continue;
+
+                for (l = 0; l < cell->paragraphs->len; l++)
+                    _ghwp_search_index_add (index,
+                        g_array_index (cell->paragraphs, GHWPParagraph *, l),
+                        i, n_paragraph, k, l);
+            }
+        }
+    }
+
+    index->n_pages = doc->page_ranges->len;
+}
+
+/* doc 의 lock 을 잡은 상태에서 부른다. seg 의 문단을 찾는다. */
+static GHWPParagraph *_ghwp_search_get_paragraph (GHWPDocument  *doc,
+                                                  const Segment *seg)
+{
+    GHWPParagraph *paragraph;
+    GHWPTableCell *cell;
+
+    paragraph = _ghwp_document_peek_paragraph (doc, seg->paragraph);
+    if (paragraph == NULL || seg->cell == G_MAXUINT)
+        return paragraph;
+
+    cell = g_array_index (paragraph->table->cells, GHWPTableCell *, seg->cell);
+    return g_array_index (cell->paragraphs, GHWPParagraph *,
+                          seg->cell_paragraph);
+}
+
+static struct _GHWPSearchIndex *_ghwp_search_index_new (gboolean fold)
+{
+    struct _GHWPSearchIndex *index = g_slice_new0 (struct _GHWPSearchIndex);
+
+    index->buf      = g_string_new (NULL);
+    index->runs     = g_array_new (FALSE, FALSE, sizeof (Run));
+    index->segments = g_array_new (FALSE, FALSE, sizeof (Segment));
+    index->fold     = fold;
+
+    return index;
+}
+
+void _ghwp_search_index_free (struct _GHWPSearchIndex *index)
+{
+    if (index == NULL)
+        return;
+
+    g_string_free (index->buf, TRUE);
+    g_array_free (index->runs, TRUE);
+    g_array_free (index->segments, TRUE);
+    g_slice_free (struct _GHWPSearchIndex, index);
+}
+
+gsize _ghwp_search_index_get_memory_usage (struct _GHWPSearchIndex *index)
+{
+    if (index == NULL)
+        return 0;
+
+    return sizeof (struct _GHWPSearchIndex) +
+           index->buf->allocated_len +
+           index->runs->len * sizeof (Run) +
+           index->segments->len * sizeof (Segment);
+}
+
+static const gchar *_ghwp_memmem (const gchar *haystack,
+                                  gsize        haystack_len,
+                                  const gchar *needle,
+                                  gsize        needle_len)
+{
+    const gchar *p   = haystack;
+    const gchar *end = haystack + haystack_len;
+
+    while ((gsize) (end - p) >= needle_len) {
+        p = memchr (p, needle[0], (end - p) - needle_len + 1);
+        if (p == NULL)
+            return NULL;
+        if (memcmp (p, needle, needle_len) == 0)
+            return p;
+        p++;
+    }
+
+    return NULL;
+}
+
+/* 정규화된 글자의 위치 pos 가 속한 Run */
+static guint _find_run (const Segment *seg, GArray *runs, gsize pos)
+{
+    guint lo = seg->first_run;
+    guint hi = seg->first_run + seg->n_runs;
+
+    /* norm_offset <= pos 인 마지막 Run */
+    while (hi - lo > 1) {
+        guint mid = lo + (hi - lo) / 2;
+        if (g_array_index (runs, Run, mid).norm_offset <= pos)
+            lo = mid;
+        else
+            hi = mid;
+    }
+
+    return lo;
+}
+
+/* 정규화된 글자에서 찾은 범위를 원래 글자의 문자 위치로 바꾼다 */
+static void _ghwp_search_map (const Segment *seg,
+                              GArray        *runs,
+                              gsize          pos,
+                              gsize          len,
+                              guint         *offset,
+                              guint         *length)
+{
+    guint first = _find_run (seg, runs, pos);
+    guint last  = _find_run (seg, runs, pos + len - 1);
+    guint end;
+
+    end = last + 1 < seg->first_run + seg->n_runs ?
+          g_array_index (runs, Run, last + 1).char_offset : seg->n_chars;
+
+    *offset = g_array_index (runs, Run, first).char_offset;
+    *length = end - *offset;
+}
+
+/**
+ * ghwp_document_find_text:
+ * @doc: a #GHWPDocument
+ * @needle: text to find
+ * @flags: a #GHWPFindFlags
+ *
+ * Finds every occurrence of @needle in the paragraphs and table cells of
+ * @doc.  The first search builds a normalized copy of the text of all
+ * pages and keeps it on @doc; later searches scan that buffer once and
+ * only index pages added since.  Safe to call while @doc is loading, in
+ * which case only the pages published so far are searched.
+ *
+ * Return value: (element-type GHWPFindResult) (transfer full): a #GList
+ *     of #GHWPFindResult in document order.  Free each with
+ *     ghwp_find_result_free() and the list with g_list_free().
+ */
+GList *ghwp_document_find_text (GHWPDocument  *doc,
+                                const gchar   *needle,
+                                GHWPFindFlags  flags)
+{
+    g_return_val_if_fail (GHWP_IS_DOCUMENT (doc), NULL);
+    g_return_val_if_fail (needle != NULL, NULL);
+
+    struct _GHWPSearchIndex *index;
+    gboolean     fold = !(flags & GHWP_FIND_CASE_SENSITIVE);
+    gchar       *norm;
+    gsize        norm_len;
+    const gchar *p;
+    const gchar *end;
+    guint        seg_i   = 0;
+    GList       *results = NULL;
+
+    norm = _ghwp_search_normalize (needle, -1, fold);
+    if (norm == NULL || *norm == '\0') {
+        g_free (norm);
+        return NULL;
+    }
+    norm_len = strlen (norm);
+
+    g_mutex_lock (&doc->priv->lock);
+
+    index = doc->priv->search_index[fold];
+    if (index == NULL)
+        index = doc->priv->search_index[fold] = _ghwp_search_index_new (fold);
+    _ghwp_search_index_update (index, doc);
+
+    p   = index->buf->str;
+    end = index->buf->str + index->buf->len;
+
+    while ((p = _ghwp_memmem (p, end - p, norm, norm_len)) != NULL) {
+        gsize           pos = p - index->buf->str;
+        const Segment  *seg;
+        GHWPFindResult *result;
+        GHWPParagraph  *paragraph;
+
+        /* 찾은 곳은 순서대로 나오므로 문단도 앞으로만 움직인다 */
+        while (g_array_index (index->segments, Segment, seg_i).end < pos)
+            seg_i++;
+        seg = &g_array_index (index->segments, Segment, seg_i);
+        p  += norm_len;
+
+        paragraph = _ghwp_search_get_paragraph (doc, seg);
+        if (paragraph == NULL)
+            continue;
+
+        result            = g_slice_new (GHWPFindResult);
+        result->page      = seg->page;
+        result->paragraph = g_object_ref (paragraph);
+        _ghwp_search_map (seg, index->runs, pos - seg->start, norm_len,
+                          &result->offset, &result->length);
+        results = g_list_prepend (results, result);
+    }
+
+    g_mutex_unlock (&doc->priv->lock);
+    g_free (norm);
+
+    return g_list_reverse (results);
+}
+
+typedef struct
+{
+    const gchar  *needle;
+    gsize         needle_len;
+    gboolean      fold;
+    GString      *buf;  /* 문단마다 다시 쓴다 */
+    GArray       *runs;
+    GHWPFindFunc  func;
+    gpointer      user_data;
+} FindData;
+
+static gboolean _ghwp_search_paragraph (guint        section,
+                                        guint        paragraph,
+                                        const gchar *text,
+                                        gpointer     user_data)
+{
+    FindData    *data = user_data;
+    Segment      seg;
+    const gchar *p;
+    const gchar *end;
+
+    if (!g_utf8_validate (text, -1, NULL))
+        return TRUE;
+
+    g_string_truncate (data->buf, 0);
+    g_array_set_size (data->runs, 0);
+
+    seg.start     = 0;
+    seg.first_run = 0;
+    seg.n_chars   = _ghwp_search_append (data->buf, data->runs, text,
+                                         data->fold);
+    seg.n_runs    = data->runs->len;
+    seg.end       = data->buf->len;
+
+    p   = data->buf->str;
+    end = data->buf->str + data->buf->len;
+
+    while ((p = _ghwp_memmem (p, end - p,
+                              data->needle, data->needle_len)) != NULL) {
+        guint offset, length;
+
+        _ghwp_search_map (&seg, data->runs, p - data->buf->str,
+                          data->needle_len, &offset, &length);
+        if (!data->func (section, paragraph, offset, length, data->user_data))
+            return FALSE;
+
+        p += data->needle_len;
+    }
+
+    return TRUE;
+}
+
+/**
+ * ghwp_file_v5_find_text:
+ * @file: a #GHWPFileV5
+ * @needle: text to find
+ * @flags: a #GHWPFindFlags
+ * @func: (scope call): called for each match
+ * @user_data: user data for @func
+ * @cancellable: (allow-none): a #GCancellable, or %NULL
+ * @error: (allow-none): Return location for an error, or %NULL
+ *
+ * Finds @needle by streaming the body text records of @file with
+ * ghwp_file_v5_foreach_paragraph_text(), without building a document.
+ * Only one paragraph is held in memory at a time.  Stops early when
+ * @func returns %FALSE.
+ *
+ * Return value: %FALSE if an error occurred
+ */
+gboolean ghwp_file_v5_find_text (GHWPFileV5    *file,
+                                 const gchar   *needle,
+                                 GHWPFindFlags  flags,
+                                 GHWPFindFunc   func,
+                                 gpointer       user_data,
+                                 GCancellable  *cancellable,
+                                 GError       **error)
+{
+    g_return_val_if_fail (GHWP_IS_FILE_V5 (file), FALSE);
+    g_return_val_if_fail (needle != NULL, FALSE);
+    g_return_val_if_fail (func   != NULL, FALSE);
+
+    FindData data;
+    gchar   *norm;
+    gboolean ret;
+
+    data.fold = !(flags & GHWP_FIND_CASE_SENSITIVE);
+    norm = _ghwp_search_normalize (needle, -1, data.fold);
+    if (norm == NULL || *norm == '\0') {
+        g_free (norm);
+        return TRUE;
+    }
+
+    data.needle     = norm;
+    data.needle_len = strlen (norm);
+    data.buf        = g_string_new (NULL);
+    data.runs       = g_array_new (FALSE, FALSE, sizeof (Run));
+    data.func       = func;
+    data.user_data  = user_data;
+
+    ret = ghwp_file_v5_foreach_paragraph_text (file, _ghwp_search_paragraph,
+                                               &data, cancellable, error);
+
+    g_string_free (data.buf, TRUE);
+    g_array_free (data.runs, TRUE);
+    g_free (norm);
+
+    return ret;
+}
+
+/**
+ * ghwp_find_result_free:
+ * @result: a #GHWPFindResult
+ *
+ * Frees the given #GHWPFindResult
+ */
+void ghwp_find_result_free (GHWPFindResult *result)
+{
+    g_return_if_fail (result != NULL);
+
+    g_object_unref (result->paragraph);
+    g_slice_free (GHWPFindResult, result);
+}
@@ -0,0 +1,100 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4; tab-width: 4 -*- */
+/*
+ * ghwp-search.h
+ *
+ * Copyright (C) 2013 Hodong Kim <cogniti@gmail.com>
+ *
+ * This library is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GHWP_SEARCH_H__
+#define __GHWP_SEARCH_H__
+
+#include <glib-object.h>
+#include <gio/gio.h>
+
+#include "ghwp.h"
+
+G_BEGIN_DECLS
+
+/**
+ * GHWPFindFlags:
+ * @GHWP_FIND_DEFAULT: case-insensitive search
+ * @GHWP_FIND_CASE_SENSITIVE: do not fold case
+ *
+ * Both the text and the needle are always normalized to NFKC, so
+ * compatibility jamo such as "ㄱㅏ" match the syllable "가" and
+ * full-width letters match their ASCII forms.
+ */
+typedef enum
+{
+    GHWP_FIND_DEFAULT        = 0,
+    GHWP_FIND_CASE_SENSITIVE = 1 << 0
+} GHWPFindFlags;
+
+typedef struct _GHWPFindResult GHWPFindResult;
+
+/**
+ * GHWPFindResult:
+ * @page: index of the page holding the match
+ * @paragraph: the paragraph holding the match, which may be inside a
+ *     table cell
+ * @offset: offset of the match in characters of the paragraph text
+ * @length: length of the match in characters of the paragraph text
+ */
+struct _GHWPFindResult
+{
+    guint          page;
+    GHWPParagraph *paragraph;
+    guint          offset;
+    guint          length;
+};
+
+/**
+ * GHWPFindFunc:
+ * @section: index of the BodyText section
+ * @paragraph: index of the paragraph within @section, in record order
+ * @offset: offset of the match in characters of the paragraph text
+ * @length: length of the match in characters of the paragraph text
+ * @user_data: user data
+ *
+ * Return value: %FALSE to stop searching
+ */
+typedef gboolean (*GHWPFindFunc) (guint    section,
+                                  guint    paragraph,
+                                  guint    offset,
+                                  guint    length,
+                                  gpointer user_data);
+
+GList   *ghwp_document_find_text (GHWPDocument  *doc,
+                                  const gchar   *needle,
+                                  GHWPFindFlags  flags);
+gboolean ghwp_file_v5_find_text  (GHWPFileV5    *file,
+                                  const gchar   *needle,
+                                  GHWPFindFlags  flags,
+                                  GHWPFindFunc   func,
+                                  gpointer       user_data,
+                                  GCancellable  *cancellable,
+                                  GError       **error);
+void     ghwp_find_result_free   (GHWPFindResult *result);
+
+/* private */
+struct _GHWPSearchIndex;
+void     _ghwp_search_index_free (struct _GHWPSearchIndex *index);
+gsize    _ghwp_search_index_get_memory_usage
+                                 (struct _GHWPSearchIndex *index);
+
+G_END_DECLS
+
+#endif /* __GHWP_SEARCH_H__ */
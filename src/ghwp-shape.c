@@ -0,0 +1,299 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4; tab-width: 4 -*- */
+/*
+ * ghwp-shape.c
+ *
+ * Copyright (C) 2013 Hodong Kim <cogniti@gmail.com>
+ *
+ * This library is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * 글자열을 글리프로 바꾼다. HarfBuzz 가 있으면 글자열 전체를 셰이핑하므로
+ * 커닝, 합자, 옛한글 자모(L+V+T) 조합이 된다. 결과는 (글자열, 글꼴, 크기)
+ * 를 열쇠로 프로세스 전체가 함께 쓰는 LRU 캐시에 넣어, 머리말, 꼬리말,
+ * 표 제목처럼 되풀이되는 글자열은 한 번만 셰이핑한다.
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <cairo-ft.h>
+
+#ifdef HAVE_HARFBUZZ
+#include <hb.h>
+#include <hb-ft.h>
+#include <hb-ot.h>
+#endif
+
+#include "ghwp-shape.h"
+#include "ghwp-font.h"
+#include "ghwp-lru-cache.h"
+
+#define GHWP_SHAPE_CACHE_SIZE (4 * 1024 * 1024)
+
+typedef struct
+{
+    gchar             *text;
+    gsize              length;
+    gconstpointer      face_id;   /* _ghwp_font_get_face_id, 참조는 잡지 않는다 */
+    gdouble            size;
+} ShapeKey;
+
+static guint _shape_key_hash (gconstpointer data)
+{
+    const ShapeKey *key = data;
+    guint32         h   = 5381;
+    gsize           i;
+
+    for (i = 0; i < key->length; i++)
+        h = (h << 5) + h + (guchar) key->text[i];
+
+    return h ^ g_direct_hash (key->face_id) ^ (guint) (key->size * 64.0);
+}
+
+static gboolean _shape_key_equal (gconstpointer a, gconstpointer b)
+{
+    const ShapeKey *key_a = a;
+    const ShapeKey *key_b = b;
+
+    return key_a->face_id   == key_b->face_id   &&
+           key_a->size      == key_b->size      &&
+           key_a->length    == key_b->length    &&
+           memcmp (key_a->text, key_b->text, key_a->length) == 0;
+}
+
+static void _shape_key_free (ShapeKey *key)
+{
+    g_free (key->text);
+    g_slice_free (ShapeKey, key);
+}
+
+static GHWPLRUCache *_ghwp_shape_get_cache (void)
+{
+    static gsize cache = 0;
+
+    if (g_once_init_enter (&cache)) {
+        GHWPLRUCache *tmp;
+        tmp = _ghwp_lru_cache_new (_shape_key_hash, _shape_key_equal,
+                                   (GDestroyNotify) _shape_key_free,
+                                   (GBoxedCopyFunc) _ghwp_shaped_run_ref,
+                                   (GDestroyNotify) _ghwp_shaped_run_unref,
+                                   GHWP_SHAPE_CACHE_SIZE);
+        g_once_init_leave (&cache, (gsize) tmp);
+    }
+
+    return (GHWPLRUCache *) cache;
+}
+
+GHWPShapedRun *_ghwp_shaped_run_ref (GHWPShapedRun *run)
+{
+    g_return_val_if_fail (run != NULL, NULL);
+    g_atomic_int_inc (&run->ref_count);
+    return run;
+}
+
+void _ghwp_shaped_run_unref (GHWPShapedRun *run)
+{
+    g_return_if_fail (run != NULL);
+
+    if (g_atomic_int_dec_and_test (&run->ref_count)) {
+        g_free (run->glyphs);
+        g_slice_free (GHWPShapedRun, run);
+    }
+}
+
+#ifdef HAVE_HARFBUZZ
+static cairo_user_data_key_t hb_face_key;
+
+static gboolean _ghwp_shape_harfbuzz (cairo_scaled_font_t *scaled_font,
+                                      gdouble              size,
+                                      const gchar         *text,
+                                      gsize                length,
+                                      GHWPShapedRun       *run)
+{
+    cairo_font_face_t   *font_face = cairo_scaled_font_get_font_face (scaled_font);
+    FT_Face              ft_face;
+    hb_face_t           *hb_face;
+    hb_font_t           *hb_font;
+    hb_buffer_t         *buffer;
+    hb_glyph_info_t     *infos;
+    hb_glyph_position_t *positions;
+    unsigned int         n_glyphs;
+    guint                i;
+
+    if (cairo_font_face_get_type (font_face) != CAIRO_FONT_TYPE_FT)
+        return FALSE;
+
+    /* FT_Face 는 스레드에 안전하지 않다. 잠근 동안에만 hb_face 를 쓰고,
+     * 표(GSUB, GPOS 등)를 다시 읽지 않도록 글꼴에 붙여 둔다. */
+    ft_face = cairo_ft_scaled_font_lock_face (scaled_font);
+    if (ft_face == NULL)
+        return FALSE;
+
+    hb_face = cairo_font_face_get_user_data (font_face, &hb_face_key);
+    if (hb_face == NULL) {
+        hb_face = hb_ft_face_create_referenced (ft_face);
+        if (cairo_font_face_set_user_data (font_face, &hb_face_key, hb_face,
+                                   (cairo_destroy_func_t) hb_face_destroy)) {
+            hb_face_destroy (hb_face);
+            cairo_ft_scaled_font_unlock_face (scaled_font);
+            return FALSE;
+        }
+    }
+
+    /* 힌팅하지 않은 설계 단위 진행폭을 pt 로 받는다 */
+    hb_font = hb_font_create (hb_face);
+    hb_ot_font_set_funcs (hb_font);
+    hb_font_set_scale (hb_font, (int) (size * 64.0), (int) (size * 64.0));
+
+    buffer = hb_buffer_create ();
+    hb_buffer_add_utf8 (buffer, text, (int) length, 0, (int) length);
+    hb_buffer_guess_segment_properties (buffer);
+    hb_shape (hb_font, buffer, NULL, 0);
+
+    hb_font_destroy (hb_font);
+    cairo_ft_scaled_font_unlock_face (scaled_font);
+
+    infos     = hb_buffer_get_glyph_infos (buffer, &n_glyphs);
+    positions = hb_buffer_get_glyph_positions (buffer, NULL);
+
+    run->n_glyphs = n_glyphs;
+    run->glyphs   = g_new (GHWPShapedGlyph, n_glyphs);
+    for (i = 0; i < n_glyphs; i++) {
+        run->glyphs[i].index     = infos[i].codepoint;
+        run->glyphs[i].cluster   = infos[i].cluster;
+        run->glyphs[i].x_advance = positions[i].x_advance / 64.0;
+        run->glyphs[i].x_offset  = positions[i].x_offset  / 64.0;
+        /* HarfBuzz 는 y 가 위로 커진다 */
+        run->glyphs[i].y_offset  = -positions[i].y_offset / 64.0;
+    }
+
+    hb_buffer_destroy (buffer);
+    return TRUE;
+}
+#endif
+
+/* HarfBuzz 가 없으면 cairo 로 글자마다 글리프를 찾는다 */
+static void _ghwp_shape_cairo (cairo_scaled_font_t *scaled_font,
+                               const gchar         *text,
+                               gsize                length,
+                               GHWPShapedRun       *run)
+{
+    cairo_glyph_t              *glyphs   = NULL;
+    cairo_text_cluster_t       *clusters = NULL;
+    cairo_text_cluster_flags_t  flags;
+    cairo_text_extents_t        extents;
+    int                         n_glyphs   = 0;
+    int                         n_clusters = 0;
+    int                         i, j, k    = 0;
+    guint                       cluster    = 0;
+
+    if (cairo_scaled_font_text_to_glyphs (scaled_font, 0.0, 0.0,
+                                          text, (int) length,
+                                          &glyphs, &n_glyphs,
+                                          &clusters, &n_clusters,
+                                          &flags) != CAIRO_STATUS_SUCCESS) {
+        run->n_glyphs = 0;
+        run->glyphs   = NULL;
+        return;
+    }
+
+    run->n_glyphs = n_glyphs;
+    run->glyphs   = g_new (GHWPShapedGlyph, n_glyphs);
+
+    for (i = 0; i < n_clusters; i++) {
+        for (j = 0; j < clusters[i].num_glyphs && k < n_glyphs; j++, k++)
+            run->glyphs[k].cluster = cluster;
+        cluster += clusters[i].num_bytes;
+    }
+
+    for (i = 0; i < n_glyphs; i++) {
+        run->glyphs[i].index    = glyphs[i].index;
+        run->glyphs[i].x_offset = 0.0;
+        run->glyphs[i].y_offset = 0.0;
+        if (i + 1 < n_glyphs) {
+            run->glyphs[i].x_advance = glyphs[i + 1].x - glyphs[i].x;
+        } else {
+            cairo_scaled_font_glyph_extents (scaled_font, &glyphs[i], 1,
+                                             &extents);
+            run->glyphs[i].x_advance = extents.x_advance;
+        }
+    }
+
+    cairo_glyph_free (glyphs);
+    cairo_text_cluster_free (clusters);
+}
+
+/**
+ * _ghwp_shape_text:
+ * @scaled_font: a #cairo_scaled_font_t
+ * @text: UTF-8 text of one run
+ * @length: length of @text in bytes, or -1 if it is nul-terminated
+ *
+ * Converts @text to positioned glyphs.  Results are cached by text,
+ * font face and size, so shaping the same run again is a lookup.
+ *
+ * Return value: a new reference to the shaped run, release it with
+ *     _ghwp_shaped_run_unref()
+ */
+GHWPShapedRun *_ghwp_shape_text (cairo_scaled_font_t *scaled_font,
+                                 const gchar         *text,
+                                 gssize               length)
+{
+    g_return_val_if_fail (scaled_font != NULL, NULL);
+    g_return_val_if_fail (text != NULL, NULL);
+
+    GHWPLRUCache      *cache = _ghwp_shape_get_cache ();
+    GHWPShapedRun     *run;
+    ShapeKey           lookup;
+    ShapeKey          *key;
+    cairo_matrix_t     font_matrix;
+    cairo_font_face_t *font_face;
+
+    cairo_scaled_font_get_font_matrix (scaled_font, &font_matrix);
+    font_face = cairo_scaled_font_get_font_face (scaled_font);
+
+    lookup.text    = (gchar *) text;
+    lookup.length  = length < 0 ? strlen (text) : (gsize) length;
+    /* 글꼴 파일로 찾으므로 닫았다 다시 연 글꼴도 같은 열쇠다. ghwp-font 가
+     * 만들지 않은 글꼴은 프로세스가 끝날 때까지 있는 기본 글꼴뿐이다. */
+    lookup.face_id = _ghwp_font_get_face_id (font_face);
+    if (lookup.face_id == NULL)
+        lookup.face_id = font_face;
+    lookup.size    = font_matrix.yy;
+
+    run = _ghwp_lru_cache_lookup (cache, &lookup);
+    if (run)
+        return run;
+
+    run = g_slice_new (GHWPShapedRun);
+    run->ref_count = 1;
+#ifdef HAVE_HARFBUZZ
+    if (!_ghwp_shape_harfbuzz (scaled_font, lookup.size, text,
+                               lookup.length, run))
+#endif
+        _ghwp_shape_cairo (scaled_font, text, lookup.length, run);
+
+    key          = g_slice_new (ShapeKey);
+    key->text    = g_strndup (text, lookup.length);
+    key->length  = lookup.length;
+    key->face_id = lookup.face_id;
+    key->size    = lookup.size;
+
+    _ghwp_lru_cache_insert (cache, key, _ghwp_shaped_run_ref (run),
+                            sizeof (GHWPShapedRun) + sizeof (ShapeKey) +
+                            run->n_glyphs * sizeof (GHWPShapedGlyph) +
+                            lookup.length + 1);
+    return run;
+}
@@ -0,0 +1,56 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4; tab-width: 4 -*- */
+/*
+ * ghwp-shape.h
+ *
+ * Copyright (C) 2013 Hodong Kim <cogniti@gmail.com>
+ *
+ * This library is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GHWP_SHAPE_H__
+#define __GHWP_SHAPE_H__
+
+#include <glib-object.h>
+#include <cairo.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GHWPShapedGlyph GHWPShapedGlyph;
+typedef struct _GHWPShapedRun   GHWPShapedRun;
+
+/* 위치는 글꼴 행렬의 사용자 공간 단위(pt) */
+struct _GHWPShapedGlyph {
+    gulong  index;
+    guint   cluster;   /* 글자의 바이트 오프셋 */
+    gdouble x_advance;
+    gdouble x_offset;
+    gdouble y_offset;
+};
+
+struct _GHWPShapedRun {
+    gint             ref_count;
+    guint            n_glyphs;
+    GHWPShapedGlyph *glyphs;
+};
+
+/* private */
+GHWPShapedRun *_ghwp_shape_text       (cairo_scaled_font_t *scaled_font,
+                                       const gchar         *text,
+                                       gssize               length);
+GHWPShapedRun *_ghwp_shaped_run_ref   (GHWPShapedRun       *run);
+void           _ghwp_shaped_run_unref (GHWPShapedRun       *run);
+
+G_END_DECLS
+
+#endif /* __GHWP_SHAPE_H__ */
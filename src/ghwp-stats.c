@@ -0,0 +1,373 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4; tab-width: 4 -*- */
+/*
+ * ghwp-stats.c
+ *
+ * Copyright (C) 2013 Hodong Kim <cogniti@gmail.com>
+ *
+ * This library is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * 읽기와 그리기의 단계별 시간, 레코드 수를 센다. 환경 변수 GHWP_STATS 를
+ * 설정하거나 ghwp_stats_set_enabled() 를 부른 뒤에 연 파일만 센다.
+ * 꺼져 있으면 전역 변수 하나를 보는 것 말고는 하는 일이 없다.
+ * sys/sdt.h 가 있으면 켜져 있는 동안 단계마다 USDT 표시를 남기므로
+ * perf, bpftrace, sysprof 등으로 볼 수 있다.
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef HAVE_SYS_SDT_H
+#include <sys/sdt.h>
+#endif
+
+#include "ghwp-stats.h"
+#include "ghwp-document.h"
+#include "ghwp-file.h"
+
+gboolean _ghwp_stats_enabled = FALSE;
+
+struct _GHWPStatsData
+{
+    gint      ref_count;
+    GMutex    lock;
+    GHWPStats stats;
+};
+
+static const gchar *phase_names[GHWP_PHASE_COUNT] = {
+    "ole-open",
+    "inflate",
+    "record-decode",
+    "model-build",
+    "pagination",
+    "render"
+};
+
+void _ghwp_stats_init (void)
+{
+    static gsize init = 0;
+
+    if (g_once_init_enter (&init)) {
+        const gchar *env = g_getenv ("GHWP_STATS");
+        if (env && *env && strcmp (env, "0") != 0)
+            _ghwp_stats_enabled = TRUE;
+        g_once_init_leave (&init, 1);
+    }
+}
+
+/**
+ * ghwp_stats_set_enabled:
+ * @enabled: whether to collect statistics
+ *
+ * Turns statistics on or off for files opened from now on.  Setting the
+ * GHWP_STATS environment variable turns them on at startup, and also
+ * prints a summary when each document is freed.
+ */
+void ghwp_stats_set_enabled (gboolean enabled)
+{
+    _ghwp_stats_init ();
+    _ghwp_stats_enabled = enabled;
+}
+
+gboolean ghwp_stats_get_enabled (void)
+{
+    _ghwp_stats_init ();
+    return _ghwp_stats_enabled;
+}
+
+const gchar *ghwp_phase_get_name (GHWPPhase phase)
+{
+    g_return_val_if_fail (phase < GHWP_PHASE_COUNT, NULL);
+    return phase_names[phase];
+}
+
+GHWPStatsData *_ghwp_stats_data_new (void)
+{
+    GHWPStatsData *data = g_slice_new0 (GHWPStatsData);
+
+    data->ref_count = 1;
+    g_mutex_init (&data->lock);
+
+    return data;
+}
+
+GHWPStatsData *_ghwp_stats_data_ref (GHWPStatsData *data)
+{
+    g_return_val_if_fail (data != NULL, NULL);
+    g_atomic_int_inc (&data->ref_count);
+    return data;
+}
+
+void _ghwp_stats_data_unref (GHWPStatsData *data)
+{
+    g_return_if_fail (data != NULL);
+
+    if (g_atomic_int_dec_and_test (&data->ref_count)) {
+        g_mutex_clear (&data->lock);
+        g_slice_free (GHWPStatsData, data);
+    }
+}
+
+gint64 _ghwp_stats_begin (GHWPPhase phase)
+{
+#ifdef HAVE_SYS_SDT_H
+    DTRACE_PROBE1 (ghwp, phase__begin, phase);
+#endif
+    /* 0 은 꺼져 있다는 뜻으로 쓴다 */
+    return MAX (g_get_monotonic_time (), 1);
+}
+
+void _ghwp_stats_end (GHWPStatsData *data, GHWPPhase phase, gint64 start)
+{
+    gint64 usec = g_get_monotonic_time () - start;
+
+#ifdef HAVE_SYS_SDT_H
+    DTRACE_PROBE2 (ghwp, phase__end, phase, usec);
+#endif
+    if (data == NULL)
+        return;
+
+    g_mutex_lock (&data->lock);
+    data->stats.time[phase] += usec;
+    data->stats.count[phase]++;
+    g_mutex_unlock (&data->lock);
+}
+
+/* 다른 단계에 포함된 시간을 더하거나 빼 맞출 때 쓴다. 횟수는 세지 않는다. */
+void _ghwp_stats_add_time (GHWPStatsData *data, GHWPPhase phase, gint64 usec)
+{
+    if (data == NULL)
+        return;
+
+    g_mutex_lock (&data->lock);
+    data->stats.time[phase] += usec;
+    g_mutex_unlock (&data->lock);
+}
+
+guint64 _ghwp_stats_get_time (GHWPStatsData *data, GHWPPhase phase)
+{
+    guint64 usec;
+
+    if (data == NULL)
+        return 0;
+
+    g_mutex_lock (&data->lock);
+    usec = data->stats.time[phase];
+    g_mutex_unlock (&data->lock);
+
+    return usec;
+}
+
+/* 스트림 하나를 한 번에 풀었을 때 */
+void _ghwp_stats_add_inflate (GHWPStatsData *data,
+                              gint64         usec,
+                              guint64        n_bytes)
+{
+    if (data == NULL)
+        return;
+
+    g_mutex_lock (&data->lock);
+    data->stats.time[GHWP_PHASE_INFLATE] += usec;
+    data->stats.count[GHWP_PHASE_INFLATE]++;
+    data->stats.n_inflated_bytes += n_bytes;
+    g_mutex_unlock (&data->lock);
+}
+
+/* 컨텍스트가 스트림을 다 읽은 뒤 한꺼번에 더한다 */
+void _ghwp_stats_add_records (GHWPStatsData *data,
+                              const guint32 *tag_count,
+                              guint64        n_records)
+{
+    guint i;
+
+    if (data == NULL)
+        return;
+
+    g_mutex_lock (&data->lock);
+    for (i = 0; i < GHWP_STATS_N_TAGS; i++)
+        data->stats.tag_count[i] += tag_count[i];
+    data->stats.n_records += n_records;
+    g_mutex_unlock (&data->lock);
+}
+
+void _ghwp_stats_get (GHWPStatsData *data, GHWPStats *stats)
+{
+    g_mutex_lock (&data->lock);
+    *stats = data->stats;
+    g_mutex_unlock (&data->lock);
+}
+
+/**
+ * ghwp_document_get_stats:
+ * @doc: a #GHWPDocument
+ * @stats: (out caller-allocates): return location for the counters
+ *
+ * Return value: %TRUE if statistics were collected for @doc.  Otherwise
+ *     @stats is zeroed.
+ */
+gboolean ghwp_document_get_stats (GHWPDocument *doc, GHWPStats *stats)
+{
+    g_return_val_if_fail (GHWP_IS_DOCUMENT (doc), FALSE);
+    g_return_val_if_fail (stats != NULL, FALSE);
+
+    memset (stats, 0, sizeof (GHWPStats));
+
+    if (doc->file == NULL || doc->file->priv->stats == NULL)
+        return FALSE;
+
+    _ghwp_stats_get (doc->file->priv->stats, stats);
+    return TRUE;
+}
+
+static gint _compare_tags (gconstpointer a, gconstpointer b, gpointer data)
+{
+    const guint64 *count = data;
+    guint64        ca    = count[*(const guint *) a];
+    guint64        cb    = count[*(const guint *) b];
+
+    return ca < cb ? 1 : ca > cb ? -1 : 0;
+}
+
+/**
+ * ghwp_stats_to_string:
+ * @stats: a #GHWPStats
+ *
+ * Return value: a newly allocated multi-line summary of @stats
+ */
+gchar *ghwp_stats_to_string (const GHWPStats *stats)
+{
+    g_return_val_if_fail (stats != NULL, NULL);
+
+    GString *str = g_string_new (NULL);
+    guint    tags[GHWP_STATS_N_TAGS];
+    guint    i;
+
+    for (i = 0; i < GHWP_PHASE_COUNT; i++)
+        g_string_append_printf (str, "%-14s %8" G_GUINT64_FORMAT " x %10.3f ms\n",
+                                phase_names[i], stats->count[i],
+                                stats->time[i] / 1000.0);
+    g_string_append_printf (str, "records        %8" G_GUINT64_FORMAT "\n",
+                            stats->n_records);
+    g_string_append_printf (str, "inflated bytes %8" G_GUINT64_FORMAT "\n",
+                            stats->n_inflated_bytes);
+
+    /* 많이 나온 태그 열 개 */
+    for (i = 0; i < GHWP_STATS_N_TAGS; i++)
+        tags[i] = i;
+    g_qsort_with_data (tags, GHWP_STATS_N_TAGS, sizeof (guint),
+                       _compare_tags, (gpointer) stats->tag_count);
+    for (i = 0; i < 10 && stats->tag_count[tags[i]] > 0; i++)
+        g_string_append_printf (str, "tag %-10u %8" G_GUINT64_FORMAT "\n",
+                                tags[i], stats->tag_count[tags[i]]);
+
+    return g_string_free (str, FALSE);
+}
+
+/** GHWPStatsConverter ********************************************************/
+
+/* 감싼 변환기가 쓴 시간과 풀어낸 바이트 수를 inflate 로 센다 */
+typedef struct
+{
+    GObject        parent_instance;
+    GConverter    *converter;
+    GHWPStatsData *data;
+} GHWPStatsConverter;
+
+typedef struct
+{
+    GObjectClass parent_class;
+} GHWPStatsConverterClass;
+
+static void _ghwp_stats_converter_iface_init (GConverterIface *iface);
+
+G_DEFINE_TYPE_WITH_CODE (GHWPStatsConverter, _ghwp_stats_converter,
+                         G_TYPE_OBJECT,
+                         G_IMPLEMENT_INTERFACE (G_TYPE_CONVERTER,
+                                           _ghwp_stats_converter_iface_init));
+
+static GConverterResult
+_ghwp_stats_converter_convert (GConverter      *converter,
+                               const void      *inbuf,
+                               gsize            inbuf_size,
+                               void            *outbuf,
+                               gsize            outbuf_size,
+                               GConverterFlags  flags,
+                               gsize           *bytes_read,
+                               gsize           *bytes_written,
+                               GError         **error)
+{
+    GHWPStatsConverter *self  = (GHWPStatsConverter *) converter;
+    gint64              start = g_get_monotonic_time ();
+    GConverterResult    result;
+
+    result = g_converter_convert (self->converter, inbuf, inbuf_size,
+                                  outbuf, outbuf_size, flags,
+                                  bytes_read, bytes_written, error);
+
+    g_mutex_lock (&self->data->lock);
+    self->data->stats.time[GHWP_PHASE_INFLATE] += g_get_monotonic_time () - start;
+    if (result != G_CONVERTER_ERROR)
+        self->data->stats.n_inflated_bytes += *bytes_written;
+    g_mutex_unlock (&self->data->lock);
+
+    return result;
+}
+
+static void _ghwp_stats_converter_reset (GConverter *converter)
+{
+    g_converter_reset (((GHWPStatsConverter *) converter)->converter);
+}
+
+static void _ghwp_stats_converter_iface_init (GConverterIface *iface)
+{
+    iface->convert = _ghwp_stats_converter_convert;
+    iface->reset   = _ghwp_stats_converter_reset;
+}
+
+static void _ghwp_stats_converter_finalize (GObject *obj)
+{
+    GHWPStatsConverter *self = (GHWPStatsConverter *) obj;
+
+    g_object_unref (self->converter);
+    _ghwp_stats_data_unref (self->data);
+    G_OBJECT_CLASS (_ghwp_stats_converter_parent_class)->finalize (obj);
+}
+
+static void _ghwp_stats_converter_class_init (GHWPStatsConverterClass *klass)
+{
+    G_OBJECT_CLASS (klass)->finalize = _ghwp_stats_converter_finalize;
+}
+
+static void _ghwp_stats_converter_init (GHWPStatsConverter *self)
+{
+}
+
+GConverter *_ghwp_stats_converter_new (GConverter    *converter,
+                                       GHWPStatsData *data)
+{
+    GHWPStatsConverter *self;
+
+    self = g_object_new (_ghwp_stats_converter_get_type (), NULL);
+    self->converter = g_object_ref (converter);
+    self->data      = _ghwp_stats_data_ref (data);
+
+    g_mutex_lock (&data->lock);
+    data->stats.count[GHWP_PHASE_INFLATE]++;
+    g_mutex_unlock (&data->lock);
+
+    return G_CONVERTER (self);
+}
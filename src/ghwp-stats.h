@@ -0,0 +1,125 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4; tab-width: 4 -*- */
+/*
+ * ghwp-stats.h
+ *
+ * Copyright (C) 2013 Hodong Kim <cogniti@gmail.com>
+ *
+ * This library is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GHWP_STATS_H__
+#define __GHWP_STATS_H__
+
+#include <glib-object.h>
+#include <gio/gio.h>
+
+#include "ghwp.h"
+
+G_BEGIN_DECLS
+
+/**
+ * GHWPPhase:
+ * @GHWP_PHASE_OLE_OPEN: opening the OLE container and its streams
+ * @GHWP_PHASE_INFLATE: decompressing DocInfo and BodyText sections
+ * @GHWP_PHASE_RECORD_DECODE: reading record headers and bodies,
+ *     not counting inflate
+ * @GHWP_PHASE_MODEL_BUILD: building paragraphs, tables and DocInfo
+ * @GHWP_PHASE_PAGINATION: laying out tables and breaking pages
+ * @GHWP_PHASE_RENDER: recording and replaying pages
+ * @GHWP_PHASE_COUNT: number of phases
+ */
+typedef enum
+{
+    GHWP_PHASE_OLE_OPEN,
+    GHWP_PHASE_INFLATE,
+    GHWP_PHASE_RECORD_DECODE,
+    GHWP_PHASE_MODEL_BUILD,
+    GHWP_PHASE_PAGINATION,
+    GHWP_PHASE_RENDER,
+    GHWP_PHASE_COUNT
+} GHWPPhase;
+
+#define GHWP_STATS_N_TAGS GHWP_N_TAGS
+
+typedef struct _GHWPStats GHWPStats;
+
+/**
+ * GHWPStats:
+ * @time: microseconds spent in each #GHWPPhase
+ * @count: number of times each phase ran
+ * @n_records: number of records read
+ * @n_inflated_bytes: bytes produced by inflate
+ * @tag_count: number of records read for each tag ID
+ *
+ * Counters collected while a document is loaded and drawn, see
+ * ghwp_document_get_stats().
+ */
+struct _GHWPStats
+{
+    guint64 time[GHWP_PHASE_COUNT];
+    guint64 count[GHWP_PHASE_COUNT];
+    guint64 n_records;
+    guint64 n_inflated_bytes;
+    guint64 tag_count[GHWP_STATS_N_TAGS];
+};
+
+void         ghwp_stats_set_enabled    (gboolean         enabled);
+gboolean     ghwp_stats_get_enabled    (void);
+const gchar *ghwp_phase_get_name       (GHWPPhase        phase);
+gchar       *ghwp_stats_to_string      (const GHWPStats *stats);
+gboolean     ghwp_document_get_stats   (GHWPDocument    *doc,
+                                        GHWPStats       *stats);
+
+/* private */
+typedef struct _GHWPStatsData GHWPStatsData;
+
+extern gboolean _ghwp_stats_enabled;
+
+/* 꺼져 있으면 전역 변수 하나만 본다 */
+#define _GHWP_STATS_BEGIN(phase) \
+    (G_UNLIKELY (_ghwp_stats_enabled) ? _ghwp_stats_begin (phase) : 0)
+#define _GHWP_STATS_END(data, phase, start) \
+    G_STMT_START { \
+        if (G_UNLIKELY ((start) != 0)) \
+            _ghwp_stats_end ((data), (phase), (start)); \
+    } G_STMT_END
+
+void           _ghwp_stats_init        (void);
+GHWPStatsData *_ghwp_stats_data_new    (void);
+GHWPStatsData *_ghwp_stats_data_ref    (GHWPStatsData   *data);
+void           _ghwp_stats_data_unref  (GHWPStatsData   *data);
+gint64         _ghwp_stats_begin       (GHWPPhase        phase);
+void           _ghwp_stats_end         (GHWPStatsData   *data,
+                                        GHWPPhase        phase,
+                                        gint64           start);
+void           _ghwp_stats_add_time    (GHWPStatsData   *data,
+                                        GHWPPhase        phase,
+                                        gint64           usec);
+guint64        _ghwp_stats_get_time    (GHWPStatsData   *data,
+                                        GHWPPhase        phase);
+void           _ghwp_stats_add_inflate (GHWPStatsData   *data,
+                                        gint64           usec,
+                                        guint64          n_bytes);
+void           _ghwp_stats_add_records (GHWPStatsData   *data,
+                                        const guint32   *tag_count,
+                                        guint64          n_records);
+void           _ghwp_stats_get         (GHWPStatsData   *data,
+                                        GHWPStats       *stats);
+GConverter    *_ghwp_stats_converter_new
+                                       (GConverter      *converter,
+                                        GHWPStatsData   *data);
+
+G_END_DECLS
+
+#endif /* __GHWP_STATS_H__ */
@@ -0,0 +1,342 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4; tab-width: 4 -*- */
+/*
+ * ghwp-text-store.c
+ *
+ * Copyright (C) 2013 Hodong Kim <cogniti@gmail.com>
+ *
+ * This library is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * 문서의 글자를 한 UTF-8 버퍼에 모아 둔다. 문단마다 '\n' 으로 끝나므로
+ * 버퍼를 그대로 쓰면 문서 전체의 글자가 된다. 문단의 위치, 길이, 표 안
+ * 여부는 문단 번호로 찾는 배열에 따로 둔다.
+ */
+
+#include <string.h>
+
+#include "ghwp-text-store.h"
+
+struct _GHWPTextStore
+{
+    gint     ref_count;
+    gchar   *data;
+    gsize    size;
+    guint    n_texts;
+    guint32 *offsets;
+    guint32 *lengths;    /* '\n' 은 빼고 */
+    guint8  *flags;      /* GHWPTextFlags */
+    guint32 *cells;      /* 표 안이면 셀 번호 */
+    guint32 *paragraphs; /* doc->paragraphs 의 번호, 표 안이면 표의 문단 */
+    guint    n_pages;    /* 만들 때의 doc->page_ranges->len */
+};
+
+typedef struct
+{
+    GString *data;
+    GArray  *offsets;
+    GArray  *lengths;
+    GArray  *flags;
+    GArray  *cells;
+    GArray  *paragraphs;
+} Builder;
+
+static void _ghwp_text_store_add (Builder       *builder,
+                                  GHWPParagraph *paragraph,
+                                  guint          n_paragraph,
+                                  guint8         flags,
+                                  guint32        cell)
+{
+    guint32 offset, length;
+
+    if (paragraph->ghwp_text == NULL || paragraph->ghwp_text->text == NULL ||
+        *paragraph->ghwp_text->text == '\0')
+        return;
+
+    offset = builder->data->len;
+    g_string_append (builder->data, paragraph->ghwp_text->text);
+    length = builder->data->len - offset;
+    g_string_append_c (builder->data, '\n');
+
+    g_array_append_val (builder->offsets,    offset);
+    g_array_append_val (builder->lengths,    length);
+    g_array_append_val (builder->flags,      flags);
+    g_array_append_val (builder->cells,      cell);
+    g_array_append_val (builder->paragraphs, n_paragraph);
+}
+
+/* doc 의 lock 을 잡은 상태에서 부른다. 읽는 중에는 마지막 문단에 아직
+ * 글자나 셀이 더해질 수 있으므로, 내보낸 페이지에 놓인 문단까지만 쓴다. */
+static GHWPTextStore *_ghwp_text_store_new (GHWPDocument *doc)
+{
+    GHWPTextStore *store = g_slice_new0 (GHWPTextStore);
+    Builder        builder;
+    guint          n_paragraphs;
+    guint          i, j, k;
+
+    n_paragraphs = _ghwp_document_get_n_published_paragraphs (doc);
+
+    builder.data       = g_string_new (NULL);
+    builder.offsets    = g_array_new (FALSE, FALSE, sizeof (guint32));
+    builder.lengths    = g_array_new (FALSE, FALSE, sizeof (guint32));
+    builder.flags      = g_array_new (FALSE, FALSE, sizeof (guint8));
+    builder.cells      = g_array_new (FALSE, FALSE, sizeof (guint32));
+    builder.paragraphs = g_array_new (FALSE, FALSE, sizeof (guint32));
+
+    for (i = 0; i < n_paragraphs; i++) {
+        GHWPParagraph *paragraph = _ghwp_document_peek_paragraph (doc, i);
+        GHWPTable     *table;
+
+        /* 버린 구역을 다시 읽지 못했다 */
+        if (paragraph == NULL)
+            continue;
+
+        _ghwp_text_store_add (&builder, paragraph, i, GHWP_TEXT_DEFAULT, 0);
+
+        table = paragraph->table;
+        if (table == NULL)
+            continue;
+
+        for (j = 0; j < table->cells->len; j++) {
+            GHWPTableCell *cell;
+            cell = g_array_index (table->cells, GHWPTableCell *, j);
+
+            for (k = 0; k < cell->paragraphs->len; k++)
+                _ghwp_text_store_add (&builder,
+                    g_array_index (cell->paragraphs, GHWPParagraph *, k),
+                    i, GHWP_TEXT_IN_TABLE, j);
+        }
+    }
+
+    store->ref_count  = 1;
+    store->n_texts    = builder.offsets->len;
+    store->n_pages    = doc->page_ranges->len;
+    store->size       = builder.data->len;
+    store->data       = g_string_free (builder.data, FALSE);
+    store->offsets    = (guint32 *) g_array_free (builder.offsets,    FALSE);
+    store->lengths    = (guint32 *) g_array_free (builder.lengths,    FALSE);
+    store->flags      = (guint8  *) g_array_free (builder.flags,      FALSE);
+    store->cells      = (guint32 *) g_array_free (builder.cells,      FALSE);
+    store->paragraphs = (guint32 *) g_array_free (builder.paragraphs, FALSE);
+
+    return store;
+}
+
+/**
+ * ghwp_document_get_text_store:
+ * @doc: a #GHWPDocument
+ *
+ * Returns the text of @doc gathered in one buffer.  Every paragraph that
+ * has text is included, followed by the paragraphs of its table cells.
+ * The store is built on the first call and kept by @doc; it is rebuilt
+ * when pages have been added since, so a store taken while @doc is
+ * loading covers only the pages completed so far.  Safe to call from any
+ * thread.
+ *
+ * Return value: (transfer full): a #GHWPTextStore, free with
+ *     ghwp_text_store_unref()
+ */
+GHWPTextStore *ghwp_document_get_text_store (GHWPDocument *doc)
+{
+    g_return_val_if_fail (GHWP_IS_DOCUMENT (doc), NULL);
+
+    GHWPTextStore *store;
+
+    g_mutex_lock (&doc->priv->lock);
+
+    store = doc->priv->text_store;
+    if (store == NULL || store->n_pages != doc->page_ranges->len) {
+        if (store)
+            ghwp_text_store_unref (store);
+        store = doc->priv->text_store = _ghwp_text_store_new (doc);
+    }
+    ghwp_text_store_ref (store);
+
+    g_mutex_unlock (&doc->priv->lock);
+
+    return store;
+}
+
+/**
+ * ghwp_text_store_ref:
+ * @store: a #GHWPTextStore
+ *
+ * Return value: @store, with its reference count increased
+ */
+GHWPTextStore *ghwp_text_store_ref (GHWPTextStore *store)
+{
+    g_return_val_if_fail (store != NULL, NULL);
+
+    g_atomic_int_inc (&store->ref_count);
+    return store;
+}
+
+/**
+ * ghwp_text_store_unref:
+ * @store: a #GHWPTextStore
+ *
+ * Decreases the reference count of @store and frees it when it drops
+ * to zero.
+ */
+void ghwp_text_store_unref (GHWPTextStore *store)
+{
+    g_return_if_fail (store != NULL);
+
+    if (!g_atomic_int_dec_and_test (&store->ref_count))
+        return;
+
+    g_free (store->data);
+    g_free (store->offsets);
+    g_free (store->lengths);
+    g_free (store->flags);
+    g_free (store->cells);
+    g_free (store->paragraphs);
+    g_slice_free (GHWPTextStore, store);
+}
+
+/**
+ * ghwp_text_store_get_n_texts:
+ * @store: a #GHWPTextStore
+ *
+ * Return value: the number of paragraphs in @store, counting those in
+ *     table cells
+ */
+guint ghwp_text_store_get_n_texts (GHWPTextStore *store)
+{
+    g_return_val_if_fail (store != NULL, 0);
+
+    return store->n_texts;
+}
+
+/**
+ * ghwp_text_store_get_data:
+ * @store: a #GHWPTextStore
+ * @size: (out) (allow-none): return location for the size in bytes
+ *
+ * Returns the whole text of @store.  Each paragraph ends with '\n', so
+ * the buffer can be written out as it is.  It is also nul-terminated.
+ *
+ * Return value: (transfer none): the text, owned by @store
+ */
+const gchar *ghwp_text_store_get_data (GHWPTextStore *store, gsize *size)
+{
+    g_return_val_if_fail (store != NULL, NULL);
+
+    if (size)
+        *size = store->size;
+    return store->data;
+}
+
+/**
+ * ghwp_text_store_get_text:
+ * @store: a #GHWPTextStore
+ * @index: index of the paragraph in @store
+ * @length: (out) (allow-none): return location for the length in bytes
+ *
+ * Returns the text of a paragraph.  It is not nul-terminated; it ends
+ * with the '\n' that separates it from the next paragraph.
+ *
+ * Return value: (transfer none): the text, owned by @store
+ */
+const gchar *ghwp_text_store_get_text (GHWPTextStore *store,
+                                       guint          index,
+                                       gsize         *length)
+{
+    g_return_val_if_fail (store != NULL, NULL);
+    g_return_val_if_fail (index < store->n_texts, NULL);
+
+    if (length)
+        *length = store->lengths[index];
+    return store->data + store->offsets[index];
+}
+
+/**
+ * ghwp_text_store_get_flags:
+ * @store: a #GHWPTextStore
+ * @index: index of the paragraph in @store
+ *
+ * Return value: where the paragraph comes from
+ */
+GHWPTextFlags ghwp_text_store_get_flags (GHWPTextStore *store, guint index)
+{
+    g_return_val_if_fail (store != NULL, GHWP_TEXT_DEFAULT);
+    g_return_val_if_fail (index < store->n_texts, GHWP_TEXT_DEFAULT);
+
+    return (GHWPTextFlags) store->flags[index];
+}
+
+/**
+ * ghwp_text_store_get_cell:
+ * @store: a #GHWPTextStore
+ * @index: index of the paragraph in @store
+ *
+ * Return value: index in #GHWPTable.cells of the cell holding the
+ *     paragraph, or %G_MAXUINT when it is not in a table
+ */
+guint ghwp_text_store_get_cell (GHWPTextStore *store, guint index)
+{
+    g_return_val_if_fail (store != NULL, G_MAXUINT);
+    g_return_val_if_fail (index < store->n_texts, G_MAXUINT);
+
+    if (!(store->flags[index] & GHWP_TEXT_IN_TABLE))
+        return G_MAXUINT;
+    return store->cells[index];
+}
+
+/**
+ * ghwp_text_store_get_paragraph:
+ * @store: a #GHWPTextStore
+ * @index: index of the paragraph in @store
+ *
+ * Return value: index in #GHWPDocument.paragraphs of the paragraph, or of
+ *     the paragraph holding its table
+ */
+guint ghwp_text_store_get_paragraph (GHWPTextStore *store, guint index)
+{
+    g_return_val_if_fail (store != NULL, 0);
+    g_return_val_if_fail (index < store->n_texts, 0);
+
+    return store->paragraphs[index];
+}
+
+/**
+ * ghwp_text_store_get_ghwp_text:
+ * @store: a #GHWPTextStore
+ * @index: index of the paragraph in @store
+ *
+ * Returns a paragraph of @store as a #GHWPText, for code written against
+ * the paragraph model.  Since #GHWPText.text is nul-terminated, the text
+ * of that one paragraph is copied.
+ *
+ * Return value: (transfer full): a new #GHWPText
+ */
+GHWPText *ghwp_text_store_get_ghwp_text (GHWPTextStore *store, guint index)
+{
+    g_return_val_if_fail (store != NULL, NULL);
+    g_return_val_if_fail (index < store->n_texts, NULL);
+
+    GHWPText *ghwp_text = (GHWPText *) g_object_new (GHWP_TYPE_TEXT, NULL);
+    ghwp_text->text = g_strndup (store->data + store->offsets[index],
+                                 store->lengths[index]);
+    return ghwp_text;
+}
+
+gsize _ghwp_text_store_get_memory_usage (GHWPTextStore *store)
+{
+    if (store == NULL)
+        return 0;
+
+    return sizeof (GHWPTextStore) + store->size + 1 +
+           store->n_texts * (sizeof (guint32) * 4 + sizeof (guint8));
+}
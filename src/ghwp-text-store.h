@@ -0,0 +1,71 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4; tab-width: 4 -*- */
+/*
+ * ghwp-text-store.h
+ *
+ * Copyright (C) 2013 Hodong Kim <cogniti@gmail.com>
+ *
+ * This library is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GHWP_TEXT_STORE_H__
+#define __GHWP_TEXT_STORE_H__
+
+#include <glib-object.h>
+
+#include "ghwp.h"
+
+G_BEGIN_DECLS
+
+/**
+ * GHWPTextFlags:
+ * @GHWP_TEXT_DEFAULT: the paragraph is in the body
+ * @GHWP_TEXT_IN_TABLE: the paragraph is inside a table cell
+ *
+ * Where a paragraph of a #GHWPTextStore comes from.
+ */
+typedef enum
+{
+    GHWP_TEXT_DEFAULT  = 0,
+    GHWP_TEXT_IN_TABLE = 1 << 0
+} GHWPTextFlags;
+
+typedef struct _GHWPTextStore GHWPTextStore;
+
+GHWPTextStore *ghwp_document_get_text_store (GHWPDocument  *doc);
+
+GHWPTextStore *ghwp_text_store_ref          (GHWPTextStore *store);
+void           ghwp_text_store_unref        (GHWPTextStore *store);
+guint          ghwp_text_store_get_n_texts  (GHWPTextStore *store);
+const gchar   *ghwp_text_store_get_data     (GHWPTextStore *store,
+                                             gsize         *size);
+const gchar   *ghwp_text_store_get_text     (GHWPTextStore *store,
+                                             guint          index,
+                                             gsize         *length);
+GHWPTextFlags  ghwp_text_store_get_flags    (GHWPTextStore *store,
+                                             guint          index);
+guint          ghwp_text_store_get_cell     (GHWPTextStore *store,
+                                             guint          index);
+guint          ghwp_text_store_get_paragraph
+                                            (GHWPTextStore *store,
+                                             guint          index);
+GHWPText      *ghwp_text_store_get_ghwp_text
+                                            (GHWPTextStore *store,
+                                             guint          index);
+/* private */
+gsize          _ghwp_text_store_get_memory_usage
+                                            (GHWPTextStore *store);
+
+G_END_DECLS
+
+#endif /* __GHWP_TEXT_STORE_H__ */
@@ -68,6 +68,8 @@ typedef enum
 
 
 #define GHWP_TAG_BEGIN                    16
+/* 레코드 헤더의 태그 필드는 10 비트다 */
+#define GHWP_N_TAGS                     1024
 typedef enum
 {
     GHWP_TAG_DOCUMENT_PROPERTIES       =  16,
@@ -141,14 +143,42 @@ typedef struct _GHWPFileV3    GHWPFileV3;
 typedef struct _GHWPPage      GHWPPage;
 typedef struct _GHWPRectangle GHWPRectangle;
 
+/**
+ * GHWPProgressCallback:
+ * @document: the #GHWPDocument being loaded
+ * @n_done: number of units loaded so far
+ * @n_total: total number of units
+ * @bytes_done: bytes of the body loaded so far
+ * @bytes_total: size of the body in bytes, or 0 if it is not known
+ * @user_data: user data passed to the callback
+ *
+ * Reports loading progress.  For HWP v5 a unit is a BodyText section and
+ * the bytes are the sizes of the section streams as stored in the file,
+ * before inflating, so sections of very different lengths still give an
+ * even progress bar.  HWP v3 and HWPML documents are loaded as a single
+ * unit and report 0 bytes.  The callback is first called with @n_done
+ * set to 0 before the body is parsed, so that pages of @document can be
+ * used while loading continues.
+ */
+typedef void (*GHWPProgressCallback) (GHWPDocument *document,
+                                      guint         n_done,
+                                      guint         n_total,
+                                      guint64       bytes_done,
+                                      guint64       bytes_total,
+                                      gpointer      user_data);
+
 G_END_DECLS
 
 #define __GHWP_H_INSIDE__
 
+#include "ghwp-doc-info.h"
 #include "ghwp-document.h"
 #include "ghwp-file.h"
 #include "ghwp-models.h"
 #include "ghwp-page.h"
+#include "ghwp-search.h"
+#include "ghwp-stats.h"
+#include "ghwp-text-store.h"
 #include "ghwp-version.h"
 #include "gsf-input-stream.h"
 
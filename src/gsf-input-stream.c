@@ -54,14 +54,25 @@ static gssize gsf_input_stream_read (GInputStream *base,
                                      GError      **error)
 {
     GsfInputStream *gis = GSF_INPUT_STREAM (base);
-    gint64    remaining = gsf_input_remaining (gis->priv->input);
+    gint64    remaining;
+    gssize    n_read;
+
+    if (gis->priv->lock)
+        g_mutex_lock (gis->priv->lock);
+
+    remaining = gsf_input_remaining (gis->priv->input);
 
     if (remaining < (gint64) buffer_len) {
         gsf_input_read (gis->priv->input, (gsize) remaining,  buffer);
     } else {
         gsf_input_read (gis->priv->input, (gsize) buffer_len, buffer);
     }
-    return (gssize) (remaining - gsf_input_remaining (gis->priv->input));
+    n_read = (gssize) (remaining - gsf_input_remaining (gis->priv->input));
+
+    if (gis->priv->lock)
+        g_mutex_unlock (gis->priv->lock);
+
+    return n_read;
 }
 
 static gboolean
@@ -79,6 +90,22 @@ gssize gsf_input_stream_size (GsfInputStream *gsf_input_stream)
     return (gssize) gsf_input_size (gsf_input_stream->priv->input);
 }
 
+/**
+ * gsf_input_stream_set_lock:
+ * @gsf_input_stream: a #GsfInputStream
+ * @lock: (allow-none): a #GMutex, or %NULL
+ *
+ * Holds @lock around every read.  Children of one OLE file share the
+ * parent input, so streams over them must share a lock when they are
+ * read from different threads.  @lock must outlive the stream.
+ */
+void gsf_input_stream_set_lock (GsfInputStream *gsf_input_stream,
+                                GMutex         *lock)
+{
+    g_return_if_fail (GSF_IS_INPUT_STREAM (gsf_input_stream));
+    gsf_input_stream->priv->lock = lock;
+}
+
 static void
 gsf_input_stream_class_init (GsfInputStreamClass *klass)
 {
@@ -47,11 +47,14 @@ struct _GsfInputStreamClass {
 
 struct _GsfInputStreamPrivate {
     GsfInput* input;
+    GMutex*   lock;
 };
 
 GType           gsf_input_stream_get_type (void) G_GNUC_CONST;
 GsfInputStream *gsf_input_stream_new      (GsfInput       *input);
 gssize          gsf_input_stream_size     (GsfInputStream *gsf_input_stream);
+void            gsf_input_stream_set_lock (GsfInputStream *gsf_input_stream,
+                                           GMutex         *lock);
 
 G_END_DECLS
 